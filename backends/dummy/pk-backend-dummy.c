@@ -1593,6 +1593,13 @@ pk_backend_supports_parallelization (PkBackend *backend)
 	return TRUE;
 }
 
+gchar *
+pk_backend_get_updates_generation (PkBackend *backend)
+{
+	/* nothing outside PackageKit changes the dummy packages */
+	return g_strdup ("dummy");
+}
+
 const gchar *
 pk_backend_get_description (PkBackend *backend)
 {
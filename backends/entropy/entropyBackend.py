@@ -982,6 +982,22 @@ class PackageKitEntropyBackend(PackageKitBaseBackend, PackageKitEntropyMixin):
     def unLock(self):
         PackageKitBaseBackend.unLock(self)
 
+    def reset(self, environ):
+        PackageKitBaseBackend.reset(self, environ)
+        # the repositories and the installed packages may have changed since
+        # the last transaction, start over with a new client
+        with self._real_entropy_lock:
+            if self._real_entropy is not None:
+                self._real_entropy.shutdown()
+                self._real_entropy = None
+        with self._real_action_factory_lock:
+            self._real_action_factory = None
+        with self._real_settings_lock:
+            if self._real_settings is not None:
+                self._real_settings.clear()
+                self._real_settings = None
+        self._repo_name_cache = {}
+
     def _convert_date_to_iso8601(self, unix_time_str):
         unix_time = float(unix_time_str)
         ux_t = time.localtime(unix_time)
@@ -46,6 +46,8 @@ pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
 	pk_backend_spawn_set_name (spawn, "entropy");
 	/* allowing sigkill as long as no one complain */
 	pk_backend_spawn_set_allow_sigkill (spawn, TRUE);
+	/* the python dispatcher keeps its caches between transactions */
+	pk_backend_spawn_set_persistent (spawn, TRUE);
 }
 
 void
@@ -35,13 +35,26 @@
 #include <nix/experimental-features.hh>
 #include <nix/installables.hh>
 
+#include <errno.h>
 #include <pwd.h>
+#include <fstream>
+#include <map>
+#include <unordered_set>
 
 #include "nix-lib-plus.hh"
 
+/* The derivations of one generation of a profile */
+typedef struct {
+	nix::Path generation;
+	nix::DrvInfos drvs;
+	std::unordered_set<std::string> names;
+} NixInstalled;
+
 typedef struct {
 	nix::ref<nix::EvalState> state;
 	std::string defaultFlake;
+	GMutex installedLock;
+	std::map<nix::Path, std::shared_ptr<NixInstalled>>* installed;
 } PkBackendNixPrivate;
 static PkBackendNixPrivate* priv;
 
@@ -63,11 +76,16 @@ pk_backend_initialize (GKeyFile* conf, PkBackend* backend)
 
 	// this might be useful as a configuration setting in the future
 	priv->defaultFlake = "nixpkgs";
+
+	priv->installed = new std::map<nix::Path, std::shared_ptr<NixInstalled>> ();
+	g_mutex_init (&priv->installedLock);
 }
 
 void
 pk_backend_destroy (PkBackend* backend)
 {
+	g_mutex_clear (&priv->installedLock);
+	delete priv->installed;
 	g_free (priv);
 }
 
@@ -133,17 +151,27 @@ pk_backend_get_mime_types (PkBackend* backend)
 	return g_strdupv ((gchar **) mime_types);
 }
 
-static std::shared_ptr<nix::eval_cache::AttrCursor>
-nix_get_cursor (nix::EvalState & state, std::string flake, std::string attrPath)
+static std::shared_ptr<nix::flake::LockedFlake>
+nix_lock_flake (nix::EvalState & state, std::string flake)
 {
 	nix::flake::LockFlags lockFlags;
-	auto lockedFlake = std::make_shared<nix::flake::LockedFlake> (nix::flake::lockFlake (state, nix::parseFlakeRef(flake), lockFlags));
+	return std::make_shared<nix::flake::LockedFlake> (nix::flake::lockFlake (state, nix::parseFlakeRef(flake), lockFlags));
+}
 
+static std::shared_ptr<nix::eval_cache::AttrCursor>
+nix_get_cursor (nix::EvalState & state, std::shared_ptr<nix::flake::LockedFlake> lockedFlake, std::string attrPath)
+{
 	auto evalCache = nix::openEvalCache (state, lockedFlake);
 
 	return evalCache->getRoot()->findAlongAttrPath (nix::parseAttrPath (state, attrPath));
 }
 
+static std::shared_ptr<nix::eval_cache::AttrCursor>
+nix_get_cursor (nix::EvalState & state, std::string flake, std::string attrPath)
+{
+	return nix_get_cursor (state, nix_lock_flake (state, flake), attrPath);
+}
+
 static void
 pk_backend_get_details_thread (PkBackendJob* job, GVariant* params, gpointer p)
 {
@@ -223,72 +251,115 @@ nix_get_user_profile (PkBackendJob* job)
 	return std::string(uid_ent->pw_dir) + "/.nix-profile";
 }
 
-static void
-nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
+static std::string
+nix_installed_key (const std::string & name, const std::string & version)
 {
-	const gchar **search;
-	PkBitfield filters;
-
-	PkRoleEnum role = pk_backend_job_get_role (job);
-
-	switch(role) {
-	case PK_ROLE_ENUM_GET_PACKAGES:
-		g_variant_get (params, "(t)", &filters);
-		break;
-	case PK_ROLE_ENUM_SEARCH_NAME:
-	case PK_ROLE_ENUM_SEARCH_DETAILS:
-	case PK_ROLE_ENUM_RESOLVE:
-		g_variant_get (params, "(t^a&s)", &filters, &search);
-		break;
-	default:
-		break;
-	}
+	return name + "\t" + version;
+}
 
-	std::string attrPath = "legacyPackages." + nix::settings.thisSystem.get () + ".";
-	auto cursor = nix_get_cursor (*priv->state, priv->defaultFlake, attrPath);
+/**
+ * nix_get_installed:
+ *
+ * Returns the derivations installed in @profile. They are only evaluated
+ * again when the profile was switched to another generation.
+ **/
+static std::shared_ptr<NixInstalled>
+nix_get_installed (const nix::Path & profile)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->installedLock);
 
-	if (pk_backend_job_is_cancelled (job))
-		return;
+	/* every generation is a different user environment in the store */
+	nix::Path generation = nix::pathExists (profile) ? nix::canonPath (profile, true) : "";
 
-	std::vector<std::regex> regexes;
-	if (search)
-		for (; *search != NULL; search++)
-			regexes.push_back (std::regex (*search, std::regex::extended | std::regex::icase));
+	auto cached = priv->installed->find (profile);
+	if (cached != priv->installed->end () && cached->second->generation == generation)
+		return cached->second;
 
-	nix::DrvInfos installedDrvs;
+	auto installed = std::make_shared<NixInstalled> ();
+	installed->generation = generation;
 
-	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)
-		|| pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
+	if (!generation.empty ()) {
 		std::optional<nix::PathSet> oldAllowedPaths = priv->state->allowedPaths;
 		priv->state->allowedPaths = std::nullopt;
 
-		std::string userProfile = nix_get_user_profile (job);
-		if (nix::pathExists (userProfile + "/manifest.nix")) {
-			nix::Value v;
-			priv->state->evalFile (userProfile + "/manifest.nix", v);
-			nix::Bindings & bindings (*priv->state->allocBindings(0));
-			nix::getDerivations (*priv->state, v, "", bindings, installedDrvs, false);
-		}
-
-		std::string defaultProfile = nix::settings.nixStateDir + "/profiles/default";
-		if (nix::pathExists (defaultProfile + "/manifest.nix")) {
-			nix::Value v;
-			priv->state->evalFile (defaultProfile + "/manifest.nix", v);
-			nix::Bindings & bindings (*priv->state->allocBindings(0));
-			nix::getDerivations (*priv->state, v, "", bindings, installedDrvs, false);
+		try {
+			installed->drvs = nix::queryInstalled (*priv->state, profile);
+		} catch (nix::Error & e) {
+			priv->state->allowedPaths = oldAllowedPaths;
+			throw;
 		}
 
 		priv->state->allowedPaths = oldAllowedPaths;
 	}
 
+	for (auto & drv : installed->drvs) {
+		nix::DrvName name (drv.queryName ());
+		installed->names.insert (nix_installed_key (name.name, name.version));
+	}
+
+	(*priv->installed)[profile] = installed;
+	return installed;
+}
+
+static bool
+nix_is_installed (const NixInstalled & installed, const std::string & name, const std::string & version)
+{
+	/* an installed derivation without a version matches all of them */
+	return installed.names.count (nix_installed_key (name, version)) > 0
+		|| installed.names.count (nix_installed_key (name, "")) > 0;
+}
+
+/* A package in legacyPackages, as stored in the search index */
+typedef struct {
+	std::string attrPath;
+	std::string name;
+	std::string version;
+	std::string system;
+	std::string description;
+	bool isSupported;
+} NixPackage;
+
+/* @cursor is NULL for packages read from the search index */
+typedef std::function<void(NixPackage & pkg, nix::eval_cache::AttrCursor * cursor)> NixPackageFunc;
+
+/**
+ * nix_package_load_details:
+ *
+ * Fills in the system and support status of @pkg, which nix_walk_packages()
+ * leaves out as meta.available is slow to evaluate. Packages read from the
+ * search index have them already.
+ **/
+static void
+nix_package_load_details (NixPackage & pkg, nix::eval_cache::AttrCursor * cursor)
+{
+	if (cursor == NULL)
+		return;
+
+	pkg.system = cursor->getAttr ("system")->getString();
+
+	auto aMeta = cursor->maybeGetAttr ("meta");
+	auto available = aMeta ? aMeta->maybeGetAttr ("available") : NULL;
+	pkg.isSupported = available ? available->getBool () : true;
+}
+
+/**
+ * nix_walk_packages:
+ *
+ * Evaluates every derivation below @root and calls @func for each of them.
+ * @func has to call nix_package_load_details() before it uses the system or
+ * support status of a package.
+ **/
+static void
+nix_walk_packages (PkBackendJob* job, nix::eval_cache::AttrCursor & root, const NixPackageFunc & func)
+{
 	int totalDrvs = 0;
 	int foundDrvs = 0;
 
 	std::function<void(nix::eval_cache::AttrCursor & cursor, const std::vector<nix::Symbol> & attrPath)> visit;
 	visit = [&](nix::eval_cache::AttrCursor & cursor, const std::vector<nix::Symbol> & attrPath) {
 		try {
-		     if (pk_backend_job_is_cancelled (job))
-			     return;
+			if (pk_backend_job_is_cancelled (job))
+				return;
 
 			auto recurse = [&] () {
 				auto attrs = cursor.getAttrs ();
@@ -308,84 +379,21 @@ nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
 			if (cursor.isDerivation ()) {
 				foundDrvs++;
 
-				size_t found = 0;
-
+				NixPackage pkg;
 				nix::DrvName name (cursor.getAttr ("name")->getString());
+				pkg.attrPath = concatStringsSep (".", attrPath);
+				pkg.name = name.name;
+				pkg.version = name.version;
 
 				auto aMeta = cursor.maybeGetAttr ("meta");
 				auto aDescription = aMeta ? aMeta->maybeGetAttr ("description") : NULL;
+				pkg.description = aDescription ? aDescription->getString() : "";
+				std::replace (pkg.description.begin (), pkg.description.end (), '\n', ' ');
 
-				auto description = aDescription ? aDescription->getString() : "";
-				std::replace (description.begin (), description.end (), '\n', ' ');
-
-				auto attrPath2 = concatStringsSep (".", attrPath);
-
-				for (auto & regex : regexes) {
-					switch (role) {
-					case PK_ROLE_ENUM_SEARCH_NAME:
-					case PK_ROLE_ENUM_RESOLVE: {
-						std::smatch nameMatch;
-						std::regex_search (name.name, nameMatch, regex);
-						std::smatch attrMatch;
-						std::regex_search (attrPath2, attrMatch, regex);
-						if (!nameMatch.empty () || !attrMatch.empty())
-							found++;
-						break;
-					}
-					case PK_ROLE_ENUM_SEARCH_DETAILS: {
-						std::smatch descriptionMatch;
-						std::regex_search (description, descriptionMatch, regex);
-						if (!descriptionMatch.empty ())
-							found++;
-						break;
-					}
-					default:
-						found++;
-						break;
-					}
-				}
+				if (totalDrvs > 0)
+					pk_backend_job_set_percentage (job, 100 * foundDrvs / totalDrvs);
 
-				if (found == regexes.size () || regexes.empty ()) {
-					bool isInstalled = false;
-					for (auto drv : installedDrvs) {
-						if (nix::DrvName (drv.queryName ()).matches(name)) {
-							isInstalled = true;
-							break;
-						}
-					}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && isInstalled)
-						return;
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && !isInstalled)
-						return;
-
-					auto available = aMeta ? aMeta->maybeGetAttr ("available") : NULL;
-					bool isSupported = available ? available->getBool () : true;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_SUPPORTED) && !isSupported)
-						return;
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_SUPPORTED) && isSupported)
-						return;
-
-					std::string system = cursor.getAttr ("system")->getString();
-
-					PkInfoEnum info = PK_INFO_ENUM_UNKNOWN;
-					if (isSupported)
-						info = PK_INFO_ENUM_AVAILABLE;
-					if (isInstalled)
-						info = PK_INFO_ENUM_INSTALLED;
-
-					if (totalDrvs > 0)
-						pk_backend_job_set_percentage (job, 100 * foundDrvs / totalDrvs);
-
-					pk_backend_job_package (job,
-								info,
-								pk_package_id_build (attrPath2.c_str (),
-										     name.version.c_str (),
-										     system.c_str (),
-										     priv->defaultFlake.c_str ()),
-								description.c_str());
-				}
+				func (pkg, &cursor);
 			}
 
 			else if (attrPath.size() == 0)
@@ -398,8 +406,270 @@ nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
 			}
 		} catch (nix::EvalError & e) {
 		}
-        };
-	visit(*cursor, {});
+	};
+	visit(root, {});
+}
+
+/* bump when the fields of the index change */
+#define NIX_INDEX_FORMAT "2"
+
+static std::string
+nix_index_get_key (nix::flake::LockedFlake & lockedFlake)
+{
+	return NIX_INDEX_FORMAT " " + lockedFlake.flake.lockedRef.to_string () + " " + nix::settings.thisSystem.get ();
+}
+
+static std::string
+nix_index_get_filename (std::string flake)
+{
+	g_autofree gchar *checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, flake.c_str (), -1);
+	g_autofree gchar *filename = g_build_filename (LOCALSTATEDIR, "cache", "PackageKit", "nix",
+						       checksum, NULL);
+	return filename;
+}
+
+static void
+nix_index_append_field (GString* line, const std::string & field, gchar separator)
+{
+	for (auto c : field)
+		g_string_append_c (line, c == '\t' || c == '\n' ? ' ' : c);
+	g_string_append_c (line, separator);
+}
+
+static bool
+nix_index_is_current (std::string flake, nix::flake::LockedFlake & lockedFlake)
+{
+	std::ifstream index (nix_index_get_filename (flake));
+	std::string key;
+
+	return std::getline (index, key) && key == nix_index_get_key (lockedFlake);
+}
+
+/**
+ * nix_index_write:
+ *
+ * Walks legacyPackages of the locked flake and writes every derivation
+ * to the search index of @flake, one tab separated line per package.
+ * The first line holds the index format and the locked revision, the index is
+ * only used as long as the flake locks to the same revision.
+ **/
+static bool
+nix_index_write (PkBackendJob* job, std::string flake, std::shared_ptr<nix::flake::LockedFlake> lockedFlake)
+{
+	g_autoptr(GString) contents = g_string_new (NULL);
+	g_autoptr(GError) error = NULL;
+	std::string filename = nix_index_get_filename (flake);
+	g_autofree gchar *dirname = g_path_get_dirname (filename.c_str ());
+
+	nix_index_append_field (contents, nix_index_get_key (*lockedFlake), '\n');
+
+	auto cursor = nix_get_cursor (*priv->state, lockedFlake,
+				      "legacyPackages." + nix::settings.thisSystem.get ());
+	nix_walk_packages (job, *cursor, [&](NixPackage & pkg, nix::eval_cache::AttrCursor * cursor) {
+		nix_package_load_details (pkg, cursor);
+		nix_index_append_field (contents, pkg.attrPath, '\t');
+		nix_index_append_field (contents, pkg.name, '\t');
+		nix_index_append_field (contents, pkg.version, '\t');
+		nix_index_append_field (contents, pkg.system, '\t');
+		nix_index_append_field (contents, pkg.isSupported ? "1" : "0", '\t');
+		nix_index_append_field (contents, pkg.description, '\n');
+	});
+
+	/* never leave a partial index behind */
+	if (pk_backend_job_is_cancelled (job))
+		return false;
+
+	if (g_mkdir_with_parents (dirname, 0755) != 0 ||
+	    !g_file_set_contents (filename.c_str (), contents->str, contents->len, &error)) {
+		g_warning ("failed to write search index %s: %s", filename.c_str (),
+			   error ? error->message : g_strerror (errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * nix_index_foreach:
+ *
+ * Calls @func for every package in the search index of @flake.
+ *
+ * Returns: %false if there is no index for the locked revision of @flake.
+ **/
+static bool
+nix_index_foreach (PkBackendJob* job, std::string flake, nix::flake::LockedFlake & lockedFlake, const NixPackageFunc & func)
+{
+	g_autofree gchar *contents = NULL;
+	gsize length;
+	std::string filename = nix_index_get_filename (flake);
+
+	if (!nix_index_is_current (flake, lockedFlake) ||
+	    !g_file_get_contents (filename.c_str (), &contents, &length, NULL))
+		return false;
+
+	/* skip the key */
+	gchar *line = contents;
+	gchar *end = strchr (line, '\n');
+	if (end == NULL)
+		return false;
+
+	guint percentage = 0;
+	NixPackage pkg;
+	std::string *fields[] = { &pkg.attrPath, &pkg.name, &pkg.version, &pkg.system,
+				  NULL, &pkg.description };
+
+	for (line = end + 1; line < contents + length; line = end + 1) {
+		if (pk_backend_job_is_cancelled (job))
+			return true;
+
+		end = strchr (line, '\n');
+		if (end == NULL)
+			break;
+
+		gchar *field = line;
+		guint n = 0;
+		for (gchar *p = line; p <= end; p++) {
+			if (*p != '\t' && p != end)
+				continue;
+			if (n == 4)
+				pkg.isSupported = *field == '1';
+			else if (n < G_N_ELEMENTS (fields))
+				fields[n]->assign (field, p - field);
+			field = p + 1;
+			n++;
+		}
+		if (n != G_N_ELEMENTS (fields))
+			continue;
+
+		func (pkg, NULL);
+
+		if (100 * (line - contents) / length > percentage) {
+			percentage = 100 * (line - contents) / length;
+			pk_backend_job_set_percentage (job, percentage);
+		}
+	}
+	return true;
+}
+
+static void
+nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
+{
+	const gchar **search = NULL;
+	PkBitfield filters;
+
+	PkRoleEnum role = pk_backend_job_get_role (job);
+
+	switch(role) {
+	case PK_ROLE_ENUM_GET_PACKAGES:
+		g_variant_get (params, "(t)", &filters);
+		break;
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_RESOLVE:
+		g_variant_get (params, "(t^a&s)", &filters, &search);
+		break;
+	default:
+		break;
+	}
+
+	auto lockedFlake = nix_lock_flake (*priv->state, priv->defaultFlake);
+
+	if (pk_backend_job_is_cancelled (job))
+		return;
+
+	std::vector<std::regex> regexes;
+	if (search)
+		for (; *search != NULL; search++)
+			regexes.push_back (std::regex (*search, std::regex::extended | std::regex::icase));
+
+	std::vector<std::shared_ptr<NixInstalled>> installed;
+
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)
+		|| pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
+		std::string userProfile = nix_get_user_profile (job);
+		std::string defaultProfile = nix::settings.nixStateDir + "/profiles/default";
+
+		for (auto & profile : { userProfile, defaultProfile }) {
+			try {
+				installed.push_back (nix_get_installed (profile));
+			} catch (nix::Error & e) {
+				g_debug ("ignoring profile %s: %s", profile.c_str (), e.what ());
+			}
+		}
+	}
+
+	auto emit = [&](NixPackage & pkg, nix::eval_cache::AttrCursor * cursor) {
+		size_t found = 0;
+
+		for (auto & regex : regexes) {
+			switch (role) {
+			case PK_ROLE_ENUM_SEARCH_NAME:
+			case PK_ROLE_ENUM_RESOLVE: {
+				std::smatch nameMatch;
+				std::regex_search (pkg.name, nameMatch, regex);
+				std::smatch attrMatch;
+				std::regex_search (pkg.attrPath, attrMatch, regex);
+				if (!nameMatch.empty () || !attrMatch.empty())
+					found++;
+				break;
+			}
+			case PK_ROLE_ENUM_SEARCH_DETAILS: {
+				std::smatch descriptionMatch;
+				std::regex_search (pkg.description, descriptionMatch, regex);
+				if (!descriptionMatch.empty ())
+					found++;
+				break;
+			}
+			default:
+				found++;
+				break;
+			}
+		}
+
+		if (found != regexes.size () && !regexes.empty ())
+			return;
+
+		bool isInstalled = false;
+		for (auto & i : installed) {
+			if (nix_is_installed (*i, pkg.name, pkg.version)) {
+				isInstalled = true;
+				break;
+			}
+		}
+
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && isInstalled)
+			return;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && !isInstalled)
+			return;
+
+		nix_package_load_details (pkg, cursor);
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_SUPPORTED) && !pkg.isSupported)
+			return;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_SUPPORTED) && pkg.isSupported)
+			return;
+
+		PkInfoEnum info = PK_INFO_ENUM_UNKNOWN;
+		if (pkg.isSupported)
+			info = PK_INFO_ENUM_AVAILABLE;
+		if (isInstalled)
+			info = PK_INFO_ENUM_INSTALLED;
+
+		pk_backend_job_package (job,
+					info,
+					pk_package_id_build (pkg.attrPath.c_str (),
+							     pkg.version.c_str (),
+							     pkg.system.c_str (),
+							     priv->defaultFlake.c_str ()),
+					pkg.description.c_str());
+	};
+
+	/* only evaluate nixpkgs if the index was built for another revision */
+	if (!nix_index_foreach (job, priv->defaultFlake, *lockedFlake, emit)) {
+		g_debug ("search index of %s is stale, evaluating it", priv->defaultFlake.c_str ());
+		auto cursor = nix_get_cursor (*priv->state, lockedFlake,
+					      "legacyPackages." + nix::settings.thisSystem.get ());
+		nix_walk_packages (job, *cursor, emit);
+	}
+
 	pk_backend_job_set_percentage (job, 100);
 }
 
@@ -433,10 +703,29 @@ pk_backend_resolve(PkBackend* self, PkBackendJob* job, PkBitfield filters, gchar
 static void
 nix_refresh_thread (PkBackendJob* job, GVariant* params, gpointer p)
 {
+	gboolean force;
+	g_variant_get (params, "(b)", &force);
+
 	nix::settings.tarballTtl = 0;
-	nix_search_thread (job, params, p);
+	auto lockedFlake = nix_lock_flake (*priv->state, priv->defaultFlake);
 	nix::settings.tarballTtl = 60 * 60;
 
+	if (pk_backend_job_is_cancelled (job))
+		return;
+
+	/* the index is still valid if the flake locks to the same revision */
+	if (force || !nix_index_is_current (priv->defaultFlake, *lockedFlake)) {
+		pk_backend_job_set_status (job, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+		if (!nix_index_write (job, priv->defaultFlake, lockedFlake) &&
+		    !pk_backend_job_is_cancelled (job)) {
+			pk_backend_job_error_code (job,
+						   PK_ERROR_ENUM_INTERNAL_ERROR,
+						   "failed to write the search index of %s",
+						   priv->defaultFlake.c_str ());
+			return;
+		}
+	}
+
 	pk_backend_job_set_percentage (job, 100);
 }
 
@@ -684,12 +973,16 @@ nix_get_updates_thread (PkBackendJob* job, GVariant* params, gpointer p)
 {
 	auto profile = nix_get_user_profile (job);
 
-	std::optional<nix::PathSet> oldAllowedPaths = priv->state->allowedPaths;
-	priv->state->allowedPaths = std::nullopt;
-
-	nix::DrvInfos installedElems = nix::queryInstalled (*priv->state, profile);
-
-	priv->state->allowedPaths = oldAllowedPaths;
+	std::shared_ptr<NixInstalled> installed;
+	try {
+		installed = nix_get_installed (profile);
+	} catch (nix::Error & e) {
+		pk_backend_job_error_code (job,
+					   PK_ERROR_ENUM_UNKNOWN,
+					   "failed to query installed packages: %s", e.what ());
+		return;
+	}
+	const nix::DrvInfos & installedElems = installed->drvs;
 
 	int progress = 0;
 	for (auto & i : installedElems) {
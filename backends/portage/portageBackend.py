@@ -810,6 +810,12 @@ class PackageKitPortageBackend(PackageKitPortageMixin, PackageKitBaseBackend):
         PackageKitPortageMixin.__init__(self)
         PackageKitBaseBackend.__init__(self, args)
 
+    def reset(self, environ):
+        PackageKitBaseBackend.reset(self, environ)
+        # a refresh or an emerge run outside of PackageKit may have changed
+        # the trees since the last transaction
+        self.pvar.update()
+
     def _package(self, cpv, info=None):
         desc = self._get_metadata(cpv, ["DESCRIPTION"])[0]
         if not info:
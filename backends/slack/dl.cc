@@ -88,7 +88,7 @@ Dl::generate_cache(PkBackendJob *job, const gchar *tmpl) noexcept
 
 	/* Remove the old entries from this repository */
 	if (sqlite3_prepare_v2(job_data->db,
-						   "DELETE FROM repos WHERE repo LIKE @repo",
+						   "DELETE FROM repos WHERE repo = @repo",
 						   -1,
 						   &stmt,
 						   NULL) == SQLITE_OK) {
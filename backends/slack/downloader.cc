@@ -0,0 +1,365 @@
+#include <glib/gstdio.h>
+#include <utime.h>
+#include "downloader.h"
+
+namespace slack {
+
+Downloader::Downloader (PkBackendJob *job,
+		guint first_percentage, guint last_percentage) noexcept
+: job(job), first_percentage(first_percentage), last_percentage(last_percentage)
+{
+}
+
+Downloader::~Downloader () noexcept
+{
+	for (auto &transfer : this->transfers)
+	{
+		g_free(transfer.source_url);
+		g_free(transfer.dest);
+		g_free(transfer.part);
+	}
+}
+
+guint
+Downloader::append (const gchar *source_url, const gchar *dest,
+		gboolean conditional) noexcept
+{
+	Transfer transfer = {};
+
+	transfer.source_url = g_strdup(source_url);
+	transfer.dest = g_strdup(dest);
+	transfer.part = g_strconcat(dest, ".part", NULL);
+	transfer.conditional = conditional;
+	this->transfers.push_back(transfer);
+
+	return this->transfers.size() - 1;
+}
+
+/**
+ * slack::Downloader::add:
+ * @source_url: source url.
+ * @dest: destination file.
+ *
+ * Queue a file for download. A partial file left by an interrupted
+ * download is continued.
+ *
+ * Returns: The number of the transfer.
+ **/
+guint
+Downloader::add (const gchar *source_url, const gchar *dest) noexcept
+{
+	return this->append (source_url, dest, FALSE);
+}
+
+/**
+ * slack::Downloader::add_conditional:
+ * @source_url: source url.
+ * @dest: destination file.
+ *
+ * Queue a file for download. If @dest already exists, it is only replaced
+ * if the remote file was modified since then. The modification time of the
+ * downloaded file is set to the one reported by the server.
+ *
+ * Returns: The number of the transfer.
+ **/
+guint
+Downloader::add_conditional (const gchar *source_url, const gchar *dest) noexcept
+{
+	return this->append (source_url, dest, TRUE);
+}
+
+gboolean
+Downloader::Transfer::open () noexcept
+{
+	this->fout = fopen(this->part, this->conditional ? "wb" : "ab");
+
+	return this->fout != NULL;
+}
+
+std::size_t
+Downloader::write_cb (char *data, std::size_t size,
+		std::size_t nmemb, void *user_data) noexcept
+{
+	auto transfer = static_cast<Transfer *> (user_data);
+
+	/* The file is created with the first data, so nothing is left behind if the request fails */
+	if (transfer->fout == NULL && !transfer->open ())
+	{
+		return 0;
+	}
+	return fwrite(data, size, nmemb, transfer->fout);
+}
+
+int
+Downloader::progress_cb (void *user_data, curl_off_t dltotal,
+		curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) noexcept
+{
+	auto transfer = static_cast<Transfer *> (user_data);
+
+	transfer->total = dltotal;
+	transfer->now = dlnow;
+
+	return 0;
+}
+
+gboolean
+Downloader::start (CURLM *multi, Transfer &transfer) noexcept
+{
+	GStatBuf st;
+
+	if (!(transfer.curl = curl_easy_init()))
+	{
+		this->finish (transfer, CURLE_FAILED_INIT);
+		return FALSE;
+	}
+	curl_easy_setopt(transfer.curl, CURLOPT_URL, transfer.source_url);
+	curl_easy_setopt(transfer.curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_PRIVATE, &transfer);
+	curl_easy_setopt(transfer.curl, CURLOPT_WRITEFUNCTION, write_cb);
+	curl_easy_setopt(transfer.curl, CURLOPT_WRITEDATA, &transfer);
+	curl_easy_setopt(transfer.curl, CURLOPT_XFERINFOFUNCTION, progress_cb);
+	curl_easy_setopt(transfer.curl, CURLOPT_XFERINFODATA, &transfer);
+	curl_easy_setopt(transfer.curl, CURLOPT_NOPROGRESS, 0L);
+
+	if (transfer.conditional)
+	{
+		curl_easy_setopt(transfer.curl, CURLOPT_FILETIME, 1L);
+		if (g_stat(transfer.dest, &st) == 0)
+		{
+			curl_easy_setopt(transfer.curl, CURLOPT_TIMECONDITION,
+					static_cast<long> (CURL_TIMECOND_IFMODSINCE));
+			curl_easy_setopt(transfer.curl, CURLOPT_TIMEVALUE_LARGE,
+					static_cast<curl_off_t> (st.st_mtime));
+		}
+	}
+	else if (g_stat(transfer.part, &st) == 0 && st.st_size > 0)
+	{
+		transfer.offset = st.st_size;
+		curl_easy_setopt(transfer.curl, CURLOPT_RESUME_FROM_LARGE, transfer.offset);
+	}
+
+	if (curl_multi_add_handle(multi, transfer.curl) != CURLM_OK)
+	{
+		this->finish (transfer, CURLE_FAILED_INIT);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void
+Downloader::finish (Transfer &transfer, CURLcode result) noexcept
+{
+	glong response_code = 0, unmet = 0;
+	curl_off_t filetime = -1;
+	struct utimbuf times;
+
+	if (transfer.curl)
+	{
+		curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &response_code);
+		curl_easy_getinfo(transfer.curl, CURLINFO_CONDITION_UNMET, &unmet);
+		curl_easy_getinfo(transfer.curl, CURLINFO_FILETIME_T, &filetime);
+		curl_easy_cleanup(transfer.curl);
+		transfer.curl = NULL;
+	}
+	transfer.modified = (result == CURLE_OK) && !unmet;
+
+	/* An empty file gives no data to write */
+	if (transfer.modified && transfer.fout == NULL && !transfer.open ())
+	{
+		result = CURLE_WRITE_ERROR;
+	}
+	if (transfer.fout)
+	{
+		if (fclose(transfer.fout) && result == CURLE_OK)
+		{
+			result = CURLE_WRITE_ERROR;
+		}
+		transfer.fout = NULL;
+	}
+
+	/* The server can't continue the partial file, download it again */
+	if (transfer.offset > 0 && (result == CURLE_RANGE_ERROR || response_code == 416))
+	{
+		g_unlink(transfer.part);
+		transfer.offset = transfer.now = transfer.total = 0;
+		return;
+	}
+
+	if (transfer.modified)
+	{
+		if (g_rename(transfer.part, transfer.dest))
+		{
+			result = CURLE_WRITE_ERROR;
+			transfer.modified = FALSE;
+		}
+		else if (transfer.conditional && filetime >= 0)
+		{
+			times.actime = times.modtime = filetime;
+			g_utime(transfer.dest, &times);
+		}
+	}
+	else if (transfer.conditional)
+	{
+		g_unlink(transfer.part);
+	}
+	transfer.result = result;
+	transfer.done = TRUE;
+}
+
+void
+Downloader::report_progress (gint64 started, gboolean force) noexcept
+{
+	gint64 now = g_get_monotonic_time();
+	gdouble done = 0;
+	curl_off_t received = 0;
+	guint percentage;
+
+	if (this->transfers.empty() || (!force && now - this->reported < G_USEC_PER_SEC / 10))
+	{
+		return;
+	}
+	this->reported = now;
+
+	for (const auto &transfer : this->transfers)
+	{
+		received += transfer.now;
+		if (transfer.done)
+		{
+			done += 1;
+		}
+		else if (transfer.total > 0)
+		{
+			done += static_cast<gdouble> (transfer.offset + transfer.now)
+				/ (transfer.offset + transfer.total);
+		}
+	}
+
+	percentage = this->first_percentage + static_cast<guint> (
+			(this->last_percentage - this->first_percentage) * done / this->transfers.size());
+	if (percentage > this->percentage)
+	{
+		this->percentage = percentage;
+		pk_backend_job_set_percentage(this->job, percentage);
+	}
+	if (now > started)
+	{
+		/* Bits per second */
+		pk_backend_job_set_speed(this->job, static_cast<guint> (
+				MIN(received * 8 * G_USEC_PER_SEC / (now - started), G_MAXUINT)));
+	}
+}
+
+/**
+ * slack::Downloader::run:
+ *
+ * Download the queued files, up to max_transfers at once.
+ *
+ * Returns: %TRUE if all files could be downloaded, %FALSE otherwise.
+ **/
+gboolean
+Downloader::run () noexcept
+{
+	CURLM *multi;
+	CURLMsg *msg;
+	CURLcode result;
+	gint running, msgs_left;
+	guint active = 0;
+	gboolean ret = TRUE;
+	gint64 started = g_get_monotonic_time();
+
+	if (!(multi = curl_multi_init()))
+	{
+		return FALSE;
+	}
+
+	for (;;)
+	{
+		for (auto &transfer : this->transfers)
+		{
+			if (active == max_transfers)
+			{
+				break;
+			}
+			if (!transfer.done && transfer.curl == NULL && this->start (multi, transfer))
+			{
+				active++;
+			}
+		}
+		if (active == 0)
+		{
+			break;
+		}
+
+		if (curl_multi_perform(multi, &running) != CURLM_OK)
+		{
+			break;
+		}
+		while ((msg = curl_multi_info_read(multi, &msgs_left)))
+		{
+			if (msg->msg == CURLMSG_DONE)
+			{
+				CURL *curl = msg->easy_handle;
+				gchar *transfer;
+
+				result = msg->data.result;
+				curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer);
+				curl_multi_remove_handle(multi, curl);
+
+				this->finish (*reinterpret_cast<Transfer *> (transfer), result);
+				active--;
+			}
+		}
+		this->report_progress (started, FALSE);
+
+		if (active > 0)
+		{
+			curl_multi_poll(multi, NULL, 0, 100, NULL);
+		}
+	}
+
+	/* Abort what is left if the multi handle failed */
+	for (auto &transfer : this->transfers)
+	{
+		if (transfer.curl)
+		{
+			curl_multi_remove_handle(multi, transfer.curl);
+			this->finish (transfer, CURLE_ABORTED_BY_CALLBACK);
+		}
+		if (!transfer.done || transfer.result != CURLE_OK)
+		{
+			ret = FALSE;
+		}
+	}
+	curl_multi_cleanup(multi);
+	this->report_progress (started, TRUE);
+
+	return ret;
+}
+
+/**
+ * slack::Downloader::get_result:
+ * @transfer: transfer number returned by add() or add_conditional().
+ *
+ * Returns: CURLE_OK (zero) on success, non-zero otherwise.
+ **/
+CURLcode
+Downloader::get_result (guint transfer) const noexcept
+{
+	return this->transfers[transfer].done
+		? this->transfers[transfer].result : CURLE_FAILED_INIT;
+}
+
+/**
+ * slack::Downloader::is_modified:
+ * @transfer: transfer number returned by add() or add_conditional().
+ *
+ * Returns: %TRUE if a new file was written to the destination.
+ **/
+gboolean
+Downloader::is_modified (guint transfer) const noexcept
+{
+	return this->transfers[transfer].done && this->transfers[transfer].modified;
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef __SLACK_DOWNLOADER_H
+#define __SLACK_DOWNLOADER_H
+
+#include <vector>
+#include <curl/curl.h>
+#include <pk-backend.h>
+#include <pk-backend-job.h>
+
+namespace slack {
+
+/*
+ * Runs several transfers at once on a curl multi handle and reports their
+ * combined progress to the job. Every file is written to "dest.part" first
+ * and renamed when it is complete.
+ */
+class Downloader final
+{
+public:
+	explicit Downloader (PkBackendJob *job,
+			guint first_percentage = 0, guint last_percentage = 100) noexcept;
+	~Downloader () noexcept;
+
+	guint add (const gchar *source_url, const gchar *dest) noexcept;
+	guint add_conditional (const gchar *source_url, const gchar *dest) noexcept;
+	gboolean run () noexcept;
+
+	CURLcode get_result (guint transfer) const noexcept;
+	gboolean is_modified (guint transfer) const noexcept;
+
+	static const guint max_transfers = 4;
+
+private:
+	struct Transfer
+	{
+		gchar *source_url;
+		gchar *dest;
+		gchar *part;
+		gboolean conditional;
+
+		CURL *curl;
+		FILE *fout;
+		curl_off_t offset;
+		curl_off_t now;
+		curl_off_t total;
+		CURLcode result;
+		gboolean modified;
+		gboolean done;
+
+		gboolean open () noexcept;
+	};
+
+	PkBackendJob *job;
+	guint first_percentage;
+	guint last_percentage;
+	guint percentage = 0;
+	gint64 reported = 0;
+	std::vector<Transfer> transfers;
+
+	guint append (const gchar *source_url, const gchar *dest,
+			gboolean conditional) noexcept;
+	gboolean start (CURLM *multi, Transfer &transfer) noexcept;
+	void finish (Transfer &transfer, CURLcode result) noexcept;
+	void report_progress (gint64 started, gboolean force) noexcept;
+
+	static std::size_t write_cb (char *data, std::size_t size,
+			std::size_t nmemb, void *user_data) noexcept;
+	static int progress_cb (void *user_data, curl_off_t dltotal,
+			curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) noexcept;
+};
+
+}
+
+#endif /* __SLACK_DOWNLOADER_H */
@@ -20,14 +20,30 @@ filter_package (PkBitfield filters, bool is_installed)
 	return false;
 }
 
-static std::string
-generate_query(PkBitfield filters)
+/**
+ * Builds the query of a name, description or group search, the search
+ * term goes in with sqlite3_mprintf(), once more if @use_index is set.
+ */
+std::string
+generate_query (PkBitfield filters, const gchar *column, gboolean use_index)
 {
 	std::string query(
 			"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
-			"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-			"WHERE p1.%s LIKE '%%%q%%' AND p1.ext NOT LIKE 'obsolete' AND p1.repo_order = "
-			"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)");
+			"p1.full_name FROM best_candidates AS b "
+			"JOIN pkglist AS p1 ON p1.name = b.name AND p1.repo_order = b.repo_order "
+			"JOIN repos AS r ON r.repo_order = p1.repo_order WHERE ");
+
+	/* Let the trigram index find the candidate packages, the LIKE below
+	 * drops anything the index may still have from before the last refresh */
+	if (use_index)
+	{
+		query.append("p1.full_name IN (SELECT full_name FROM pkglist_fts WHERE pkglist_fts.")
+			.append(column)
+			.append(" LIKE '%%%q%%') AND ");
+	}
+	query.append("p1.")
+		.append(column)
+		.append(" LIKE '%%%q%%' AND p1.ext != 'obsolete'");
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION))
 	{
@@ -62,9 +78,13 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 	PkBitfield filters;
 	g_variant_get (params, "(t^a&s)", &filters, &vals);
 	gchar *search = g_strjoinv ("%", vals);
+	auto column = static_cast<const gchar *> (user_data);
 
-	gchar *query = sqlite3_mprintf (slack::generate_query(filters).c_str(),
-			user_data, search);
+	/* Only names and descriptions are indexed */
+	gboolean use_index = g_strcmp0 (column, "cat") != 0
+		&& slack::search_index_usable (job_data->db, vals);
+	gchar *query = sqlite3_mprintf (slack::generate_query(filters, column, use_index).c_str(),
+			search, search);
 
 	sqlite3_stmt *stmt;
 	if ((sqlite3_prepare_v2 (job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
@@ -72,7 +92,7 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		/* Now we're ready to output all packages */
 		while (sqlite3_step (stmt) == SQLITE_ROW)
 		{
-			PkInfoEnum info = slack::is_installed (
+			PkInfoEnum info = slack::is_installed (job_data,
 					reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 2)));
 
 			if ((info == PK_INFO_ENUM_INSTALLED || info == PK_INFO_ENUM_UPDATING)
@@ -102,3 +122,67 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 
 	pk_backend_job_set_percentage (job, 100);
 }
+
+void
+pk_backend_search_files_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	auto job_data = reinterpret_cast<slack::JobData *> (pk_backend_job_get_user_data (job));
+
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+	pk_backend_job_set_percentage (job, 0);
+
+	gchar **vals;
+	g_variant_get (params, "(t^a&s)", NULL, &vals);
+	gchar *search = g_strjoinv ("%", vals);
+
+	gchar *query;
+	if (slack::search_index_usable (job_data->db, vals))
+	{
+		/* The trigram index finds the candidates, LIKE drops stale ones */
+		query = sqlite3_mprintf ("SELECT (p.name || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
+				"p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p NATURAL JOIN repos AS r "
+				"WHERE f.full_name IN (SELECT full_name FROM filelist_fts WHERE filename LIKE '%%%q%%') "
+				"AND f.filename LIKE '%%%q%%' GROUP BY f.full_name", search, search);
+	}
+	else
+	{
+		query = sqlite3_mprintf ("SELECT (p.name || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
+				"p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p NATURAL JOIN repos AS r "
+				"WHERE f.filename LIKE '%%%q%%' GROUP BY f.full_name", search);
+	}
+
+	sqlite3_stmt *stmt;
+	if ((sqlite3_prepare_v2 (job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
+	{
+		/* Now we're ready to output all packages */
+		while (sqlite3_step (stmt) == SQLITE_ROW)
+		{
+			PkInfoEnum info = slack::is_installed (job_data,
+					reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 2)));
+
+			if (info == PK_INFO_ENUM_INSTALLED || info == PK_INFO_ENUM_UPDATING)
+			{
+				pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
+						reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 0)),
+						reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 1)));
+			}
+			else if (info == PK_INFO_ENUM_INSTALLING)
+			{
+				pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+						reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 0)),
+						reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 1)));
+			}
+		}
+		sqlite3_finalize (stmt);
+	}
+	else
+	{
+		pk_backend_job_error_code (job, PK_ERROR_ENUM_CANNOT_GET_FILELIST,
+				"%s", sqlite3_errmsg (job_data->db));
+	}
+
+	sqlite3_free (query);
+	g_free (search);
+
+	pk_backend_job_set_percentage (job, 100);
+}
@@ -3,16 +3,19 @@
 
 #include <pk-backend.h>
 #include <sqlite3.h>
+#include <string>
 
 namespace slack {
 
 bool filter_package (PkBitfield filters, bool is_installed);
+std::string generate_query (PkBitfield filters, const gchar *column, gboolean use_index);
 
 }
 
 extern "C" {
 
 void pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_data);
+void pk_backend_search_files_thread (PkBackendJob *job, GVariant *params, gpointer user_data);
 
 }
 
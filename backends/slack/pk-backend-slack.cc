@@ -9,6 +9,7 @@
 #include <sqlite3.h>
 #include "job.h"
 #include "dl.h"
+#include "downloader.h"
 #include "pkgtools.h"
 #include "slackpkg.h"
 #include "utils.h"
@@ -64,7 +65,7 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 	}
 
 	if ((ret = sqlite3_prepare_v2(db,
-					"UPDATE cache_info SET value = ? WHERE key LIKE 'last_modification'",
+					"UPDATE cache_info SET value = ? WHERE key = 'last_modification'",
 					-1,
 					&stmt,
 					NULL)) == SQLITE_OK) {
@@ -86,6 +87,10 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 
 	g_object_unref(file_info);
 	g_object_unref(conf_file);
+
+	/* Caches generated by older versions have no search index yet */
+	search_index_create(db);
+	best_candidates_create(db);
 	sqlite3_close_v2(db);
 	g_free(path);
 
@@ -196,6 +201,9 @@ pk_backend_start_job(PkBackend *backend, PkBackendJob *job)
 	gchar *db_filename = NULL;
 	JobData *job_data = g_new0(JobData, 1);
 
+	job_data->statements = statement_cache_new();
+	job_data->installed = new InstalledIndex ();
+
 	pk_backend_job_set_allow_cancel(job, TRUE);
 	pk_backend_job_set_allow_cancel(job, FALSE);
 
@@ -224,11 +232,8 @@ pk_backend_stop_job(PkBackend *backend, PkBackendJob *job)
 {
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
-	if (job_data->curl)
-	{
-		curl_easy_cleanup(job_data->curl);
-	}
-
+	g_hash_table_destroy(job_data->statements);
+	delete job_data->installed;
 	sqlite3_close(job_data->db);
 	g_free(job_data);
 	pk_backend_job_set_user_data(job, NULL);
@@ -252,56 +257,6 @@ pk_backend_search_groups(PkBackend *backend, PkBackendJob *job, PkBitfield filte
 	pk_backend_job_thread_create(job, pk_backend_search_thread, (gpointer) "cat", NULL);
 }
 
-static void
-pk_backend_search_files_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
-{
-	gchar **vals, *search;
-	gchar *query;
-	sqlite3_stmt *stmt;
-	PkInfoEnum ret;
-	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
-
-	pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
-	pk_backend_job_set_percentage(job, 0);
-
-	g_variant_get(params, "(t^a&s)", NULL, &vals);
-	search = g_strjoinv("%", vals);
-
-	query = sqlite3_mprintf("SELECT (p.name || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
-							"p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p NATURAL JOIN repos AS r "
-							"WHERE f.filename LIKE '%%%q%%' GROUP BY f.full_name", search);
-
-	if ((sqlite3_prepare_v2(job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
-	{
-		/* Now we're ready to output all packages */
-		while (sqlite3_step(stmt) == SQLITE_ROW)
-		{
-			ret = is_installed((gchar*) sqlite3_column_text(stmt, 2));
-			if ((ret == PK_INFO_ENUM_INSTALLED) || (ret == PK_INFO_ENUM_UPDATING))
-			{
-				pk_backend_job_package(job, PK_INFO_ENUM_INSTALLED,
-				                       (gchar*) sqlite3_column_text(stmt, 0),
-				                       (gchar*) sqlite3_column_text(stmt, 1));
-			}
-			else if (ret == PK_INFO_ENUM_INSTALLING)
-			{
-				pk_backend_job_package(job, PK_INFO_ENUM_AVAILABLE,
-				                       (gchar*) sqlite3_column_text(stmt, 0),
-				                       (gchar*) sqlite3_column_text(stmt, 1));
-			}
-		}
-		sqlite3_finalize(stmt);
-	}
-	else
-	{
-		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
-	}
-	sqlite3_free(query);
-	g_free(search);
-
-	pk_backend_job_set_percentage(job, 100);
-}
-
 void
 pk_backend_search_files(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
@@ -325,12 +280,9 @@ pk_backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user
 
 	g_variant_get(params, "(^a&s)", &pkg_ids);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = prepare_statement(job_data,
 							"SELECT p.desc, p.cat, p.uncompressed FROM pkglist AS p NATURAL JOIN repos AS r "
-							"WHERE name LIKE @name AND r.repo LIKE @repo AND ext NOT LIKE 'obsolete'",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK)) {
+							"WHERE name = @name AND r.repo = @repo AND ext != 'obsolete'"))) {
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
 	}
@@ -388,7 +340,7 @@ pk_backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user
 	}
 
 out:
-	sqlite3_finalize(stmt);
+	sqlite3_reset(stmt);
 }
 
 void
@@ -410,14 +362,12 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 
 	g_variant_get(params, "(t^a&s)", NULL, &vals);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if ((stmt = prepare_statement(job_data,
 							"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
-						   	"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @search AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
-							-1,
-							&stmt,
-							NULL) == SQLITE_OK)) {
+							"p1.full_name FROM best_candidates AS b "
+							"JOIN pkglist AS p1 ON p1.name = b.name AND p1.repo_order = b.repo_order "
+							"JOIN repos AS r ON r.repo_order = p1.repo_order "
+							"WHERE b.name = @search"))) {
 		/* Output packages matching each pattern */
 		for (val = vals; *val; val++)
 		{
@@ -425,7 +375,7 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 
 			while (sqlite3_step(stmt) == SQLITE_ROW)
 			{
-				ret = is_installed((gchar*) sqlite3_column_text(stmt, 2));
+				ret = is_installed(job_data, (gchar*) sqlite3_column_text(stmt, 2));
 				if ((ret == PK_INFO_ENUM_INSTALLED) || (ret == PK_INFO_ENUM_UPDATING))
 				{
 					pk_backend_job_package(job, PK_INFO_ENUM_INSTALLED,
@@ -443,7 +393,6 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 			sqlite3_clear_bindings(stmt);
 			sqlite3_reset(stmt);
 		}
-		sqlite3_finalize(stmt);
 	} else {
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 	}
@@ -463,17 +412,16 @@ pk_backend_download_packages_thread(PkBackendJob *job, GVariant *params, gpointe
 	gchar *dir_path, *path, **pkg_ids, *to_strv[] = {NULL, NULL};
 	guint i;
 	sqlite3_stmt *stmt;
+	GPtrArray *paths = g_ptr_array_new_with_free_func(g_free);
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
+	Downloader downloader (job);
 
 	g_variant_get(params, "(^a&ss)", &pkg_ids, &dir_path);
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_DOWNLOAD);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = prepare_statement(job_data,
 							"SELECT summary, (full_name || '.' || ext) FROM pkglist NATURAL JOIN repos "
-							"WHERE name LIKE @name AND ver LIKE @ver AND arch LIKE @arch AND repo LIKE @repo",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK))
+							"WHERE name = @name AND ver = @ver AND arch = @arch AND repo = @repo")))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
@@ -495,12 +443,10 @@ pk_backend_download_packages_thread(PkBackendJob *job, GVariant *params, gpointe
 				pk_backend_job_package(job, PK_INFO_ENUM_DOWNLOADING,
 									   pkg_ids[i],
 									   (gchar *) sqlite3_column_text(stmt, 0));
-				static_cast<Pkgtools *> (repo->data)->download (job,
+				static_cast<Pkgtools *> (repo->data)->download (job, downloader,
 						dir_path, tokens[PK_PACKAGE_ID_NAME]);
 				path = g_build_filename(dir_path, (gchar *) sqlite3_column_text(stmt, 1), NULL);
-				to_strv[0] = path;
-				pk_backend_job_files(job, NULL, to_strv);
-				g_free(path);
+				g_ptr_array_add(paths, path);
 			}
 		}
 		sqlite3_clear_bindings(stmt);
@@ -508,8 +454,22 @@ pk_backend_download_packages_thread(PkBackendJob *job, GVariant *params, gpointe
 		g_strfreev(tokens);
 	}
 
+	/* Fetch all packages at once */
+	if (!downloader.run ())
+	{
+		pk_backend_job_error_code(job, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED,
+				"Failed to download the packages");
+		goto out;
+	}
+	for (i = 0; i < paths->len; i++)
+	{
+		to_strv[0] = static_cast<gchar *> (g_ptr_array_index(paths, i));
+		pk_backend_job_files(job, NULL, to_strv);
+	}
+
 out:
-	sqlite3_finalize(stmt);
+	sqlite3_reset(stmt);
+	g_ptr_array_unref(paths);
 }
 
 void
@@ -534,21 +494,15 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 	g_variant_get(params, "(t^a&s)", &transaction_flags, &pkg_ids);
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DEP_RESOLVE);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(pkglist_stmt = prepare_statement(job_data,
 							"SELECT summary, cat FROM pkglist NATURAL JOIN repos "
-							"WHERE name LIKE @name AND ver LIKE @ver AND arch LIKE @arch AND repo LIKE @repo",
-							-1,
-							&pkglist_stmt,
-							NULL) != SQLITE_OK) ||
-		(sqlite3_prepare_v2(job_data->db,
+							"WHERE name = @name AND ver = @ver AND arch = @arch AND repo = @repo")) ||
+		!(collection_stmt = prepare_statement(job_data,
 						   "SELECT (c.collection_pkg || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
 						   "p.full_name, p.ext FROM collections AS c "
 						   "JOIN pkglist AS p ON c.collection_pkg = p.name "
 						   "JOIN repos AS r ON p.repo_order = r.repo_order "
-						   "WHERE c.name LIKE @name AND r.repo LIKE @repo",
-						   -1,
-						   &collection_stmt,
-						   NULL) != SQLITE_OK))
+						   "WHERE c.name = @name AND r.repo = @repo")))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
@@ -585,7 +539,7 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 
 				while (sqlite3_step(collection_stmt) == SQLITE_ROW)
 				{
-					ret = is_installed((gchar*) sqlite3_column_text(collection_stmt, 2));
+					ret = is_installed(job_data, (gchar*) sqlite3_column_text(collection_stmt, 2));
 					if ((ret == PK_INFO_ENUM_INSTALLING) || (ret == PK_INFO_ENUM_UPDATING))
 					{
 						if ((pk_bitfield_contain(transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE)) &&
@@ -622,6 +576,8 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 		percent_step = 100.0 / g_slist_length(install_list) / 2;
 
 		/* Download the packages */
+		Downloader downloader (job, 0, 50);
+
 		pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD);
 		dest_dir_name = g_build_filename(LOCALSTATEDIR, "cache", "PackageKit", "downloads", NULL);
 		for (l = install_list, i = 0; l; l = g_slist_next(l), i++)
@@ -629,42 +585,49 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 			gchar **tokens;
 			GSList *repo;
 
-			pk_backend_job_set_percentage(job, percent_step * i);
 			tokens = pk_package_id_split((gchar *)(l->data));
 			repo = g_slist_find_custom(repos, tokens[PK_PACKAGE_ID_DATA], cmp_repo);
 
 			if (repo)
 			{
-				static_cast<Pkgtools *> (repo->data)->download (job,
+				static_cast<Pkgtools *> (repo->data)->download (job, downloader,
 						dest_dir_name, tokens[PK_PACKAGE_ID_NAME]);
 			}
 			g_strfreev(tokens);
 		}
 		g_free(dest_dir_name);
 
-		/* Install the packages */
-		pk_backend_job_set_status(job, PK_STATUS_ENUM_INSTALL);
-		for (l = install_list; l; l = g_slist_next(l), i++)
+		if (!downloader.run ())
 		{
-			gchar **tokens;
-			GSList *repo;
+			pk_backend_job_error_code(job, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED,
+					"Failed to download the packages");
+		}
+		else
+		{
+			/* Install the packages */
+			pk_backend_job_set_status(job, PK_STATUS_ENUM_INSTALL);
+			for (l = install_list; l; l = g_slist_next(l), i++)
+			{
+				gchar **tokens;
+				GSList *repo;
 
-			pk_backend_job_set_percentage(job, percent_step * i);
-			tokens = pk_package_id_split((gchar *)(l->data));
-			repo = g_slist_find_custom(repos, tokens[PK_PACKAGE_ID_DATA], cmp_repo);
+				pk_backend_job_set_percentage(job, percent_step * i);
+				tokens = pk_package_id_split((gchar *)(l->data));
+				repo = g_slist_find_custom(repos, tokens[PK_PACKAGE_ID_DATA], cmp_repo);
 
-			if (repo)
-			{
-				static_cast<Pkgtools *> (repo->data)->install (job, tokens[PK_PACKAGE_ID_NAME]);
+				if (repo)
+				{
+					static_cast<Pkgtools *> (repo->data)->install (job, tokens[PK_PACKAGE_ID_NAME]);
+				}
+				g_strfreev(tokens);
 			}
-			g_strfreev(tokens);
 		}
 	}
 	g_slist_free_full(install_list, g_free);
 
 out:
-	sqlite3_finalize(pkglist_stmt);
-	sqlite3_finalize(collection_stmt);
+	sqlite3_reset(pkglist_stmt);
+	sqlite3_reset(collection_stmt);
 }
 
 void
@@ -741,47 +704,38 @@ pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user
 {
 	gchar *pkg_id, *full_name, *desc;
 	const gchar *pkg_metadata_filename;
-	GFile *pkg_metadata_dir;
-	GFileEnumerator *pkg_metadata_enumerator;
-	GFileInfo *pkg_metadata_file_info;
+	GPtrArray *installed;
 	GError *err = NULL;
 	sqlite3_stmt *stmt;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = prepare_statement(job_data,
 							"SELECT p1.full_name, p1.name, p1.ver, p1.arch, r.repo, p1.summary, p1.ext "
-							"FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @name AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK))
+							"FROM best_candidates AS b "
+							"JOIN pkglist AS p1 ON p1.name = b.name AND p1.repo_order = b.repo_order "
+							"JOIN repos AS r ON r.repo_order = p1.repo_order "
+							"WHERE b.name = @name")))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
 	}
 
-	/* Read the package metadata directory and comprare all installed packages with ones in the cache */
-	pkg_metadata_dir = g_file_new_for_path("/var/log/packages");
-	pkg_metadata_enumerator = g_file_enumerate_children(pkg_metadata_dir, "standard::name",
-														 G_FILE_QUERY_INFO_NONE,
-														 NULL,
-														 &err);
-	g_object_unref(pkg_metadata_dir);
-	if (err)
+	/* Compare all installed packages with ones in the cache */
+	if (!job_data->installed->load(&err))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_NO_CACHE, "/var/log/packages: %s", err->message);
 		g_error_free(err);
 		goto out;
 	}
 
-	while ((pkg_metadata_file_info = g_file_enumerator_next_file(pkg_metadata_enumerator, NULL, NULL)))
+	installed = job_data->installed->get_full_names();
+	for (guint i = 0; i < installed->len; i++)
 	{
 		gchar **tokens;
 
-		pkg_metadata_filename = g_file_info_get_name(pkg_metadata_file_info);
+		pkg_metadata_filename = static_cast<const gchar *> (g_ptr_array_index(installed, i));
 		tokens = split_package_name(pkg_metadata_filename);
 
 		/* Select the package from the database */
@@ -832,12 +786,10 @@ pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user
 		sqlite3_reset(stmt);
 
 		g_strfreev(tokens);
-		g_object_unref(pkg_metadata_file_info);
 	}
-	g_object_unref(pkg_metadata_enumerator);
 
 out:
-	sqlite3_finalize(stmt);
+	sqlite3_reset(stmt);
 }
 
 void
@@ -856,6 +808,8 @@ pk_backend_update_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 	g_variant_get(params, "(t^a&s)", &transaction_flags, &pkg_ids);
 
 	if (!pk_bitfield_contain(transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE)) {
+		Downloader downloader (job);
+
 		pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD);
 
 		/* Download the packages */
@@ -870,7 +824,7 @@ pk_backend_update_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 
 				if (repo)
 				{
-					static_cast<Pkgtools *> (repo->data)->download (job,
+					static_cast<Pkgtools *> (repo->data)->download (job, downloader,
 							dest_dir_name, tokens[PK_PACKAGE_ID_NAME]);
 				}
 			}
@@ -879,6 +833,13 @@ pk_backend_update_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 		}
 		g_free(dest_dir_name);
 
+		if (!downloader.run ())
+		{
+			pk_backend_job_error_code(job, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED,
+					"Failed to download the packages");
+			return;
+		}
+
 		/* Install the packages */
 		pk_backend_job_set_status(job, PK_STATUS_ENUM_UPDATE);
 		for (i = 0; pkg_ids[i]; i++)
@@ -917,18 +878,67 @@ pk_backend_update_packages(PkBackend *backend,
 	pk_backend_job_thread_create(job, pk_backend_update_packages_thread, NULL, NULL);
 }
 
+/*
+ * Downloaded metadata is kept between refreshes, one file per URL, so it is
+ * only fetched again when it was modified on the mirror.
+ */
+static gchar *
+mirror_file_name(const gchar *source_url)
+{
+	gchar *checksum, *filename;
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, source_url, -1);
+	filename = g_build_filename(LOCALSTATEDIR, "cache", "PackageKit", "metadata", "mirror", checksum, NULL);
+	g_free(checksum);
+
+	return filename;
+}
+
+static gboolean
+append_file(const gchar *source, const gchar *dest)
+{
+	GFile *source_file, *dest_file;
+	GFileInputStream *fin;
+	GFileOutputStream *fout = NULL;
+	gboolean ret = FALSE;
+
+	source_file = g_file_new_for_path(source);
+	dest_file = g_file_new_for_path(dest);
+
+	if ((fin = g_file_read(source_file, NULL, NULL))
+	 && (fout = g_file_append_to(dest_file, G_FILE_CREATE_NONE, NULL, NULL)))
+	{
+		ret = g_output_stream_splice(G_OUTPUT_STREAM(fout),
+				G_INPUT_STREAM(fin),
+				static_cast<GOutputStreamSpliceFlags> (G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE
+					| G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET),
+				NULL, NULL) >= 0;
+	}
+	g_clear_object(&fout);
+	g_clear_object(&fin);
+	g_object_unref(dest_file);
+	g_object_unref(source_file);
+
+	return ret;
+}
+
 static void
 pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
 {
-	gchar *tmp_dir_name, *db_err, *path = NULL;
+	gchar *tmp_dir_name, *db_err, *path = NULL, *mirror_dir_name = NULL;
+	const gchar *mirror_name;
 	gint ret;
-	gboolean force;
-	GSList *file_list = NULL;
+	guint i, n_repos, n;
+	gboolean force, complete = TRUE;
+	GSList *file_lists = NULL;
+	GHashTable *mirror_files = NULL;
+	GDir *mirror_dir;
 	GFile *db_file = NULL;
 	GFileInfo *file_info = NULL;
 	GError *err = NULL;
-	sqlite3_stmt *stmt = NULL;
+	sqlite3_stmt *stmt = NULL, *repo_stmt = NULL;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
+	Downloader downloader (job, 0, 50);
 
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD_CHANGELOG);
 
@@ -956,7 +966,7 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 			goto out;
 		}
 		ret = sqlite3_prepare_v2(job_data->db,
-								 "SELECT value FROM cache_info WHERE key LIKE 'last_modification'",
+								 "SELECT value FROM cache_info WHERE key = 'last_modification'",
 								 -1,
 								 &stmt,
 								 NULL);
@@ -987,30 +997,127 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 	// Get list of files that should be downloaded.
 	for (GSList *l = repos; l; l = g_slist_next(l))
 	{
-		file_list = g_slist_concat(file_list,
+		file_lists = g_slist_append(file_lists,
 				static_cast<Pkgtools *> (l->data)->collect_cache_info (tmp_dir_name));
 	}
 
 	/* Download repository */
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD_REPOSITORY);
 
-	for (GSList *l = file_list; l; l = g_slist_next(l))
+	mirror_dir_name = g_build_filename(LOCALSTATEDIR, "cache", "PackageKit", "metadata", "mirror", NULL);
+	g_mkdir_with_parents(mirror_dir_name, 0755);
+	mirror_files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	for (GSList *l = file_lists; l; l = g_slist_next(l))
+	{
+		if (l->data == NULL)
+		{
+			complete = FALSE;
+		}
+		for (GSList *f = static_cast<GSList *> (l->data); f; f = g_slist_next(f))
+		{
+			gchar *mirror_file = mirror_file_name(static_cast<gchar **> (f->data)[0]);
+
+			if (force)
+			{
+				g_unlink(mirror_file);
+			}
+			downloader.add_conditional (static_cast<gchar **> (f->data)[0], mirror_file);
+			g_hash_table_add(mirror_files, g_path_get_basename(mirror_file));
+			g_free(mirror_file);
+		}
+	}
+	if (!downloader.run ())
+	{
+		complete = FALSE;
+	}
+
+	/* Only the repositories with modified files have to be regenerated */
+	if (sqlite3_prepare_v2(job_data->db,
+	                       "SELECT repo_order FROM repos WHERE repo = @repo",
+	                       -1,
+	                       &repo_stmt,
+	                       NULL) != SQLITE_OK)
+	{
+		pk_backend_job_error_code(job, PK_ERROR_ENUM_INTERNAL_ERROR, "%s", sqlite3_errmsg(job_data->db));
+		goto out;
+	}
+	i = 0;
+	for (GSList *l = file_lists, *r = repos; l; l = g_slist_next(l), r = g_slist_next(r))
+	{
+		gboolean modified = force;
+
+		sqlite3_bind_text(repo_stmt, 1, static_cast<Pkgtools *> (r->data)->get_name (), -1, SQLITE_TRANSIENT);
+		if (sqlite3_step(repo_stmt) != SQLITE_ROW)
+		{
+			modified = TRUE;
+		}
+		sqlite3_reset(repo_stmt);
+
+		for (GSList *f = static_cast<GSList *> (l->data); f; f = g_slist_next(f), i++)
+		{
+			modified = modified || downloader.is_modified (i);
+		}
+		if (!modified)
+		{
+			continue;
+		}
+
+		/* Files with the same destination, like PACKAGES.TXT of several priorities, are concatenated */
+		for (GSList *f = static_cast<GSList *> (l->data); f; f = g_slist_next(f))
+		{
+			gchar *mirror_file = mirror_file_name(static_cast<gchar **> (f->data)[0]);
+
+			if (g_file_test(mirror_file, G_FILE_TEST_EXISTS))
+			{
+				append_file(mirror_file, static_cast<gchar **> (f->data)[1]);
+			}
+			g_free(mirror_file);
+		}
+	}
+
+	/* Forget files of repositories which aren't configured anymore */
+	if (complete && (mirror_dir = g_dir_open(mirror_dir_name, 0, NULL)))
 	{
-		get_file(&job_data->curl, static_cast<gchar **> (l->data)[0],
-				static_cast<gchar **> (l->data)[1]);
+		while ((mirror_name = g_dir_read_name(mirror_dir)))
+		{
+			if (!g_hash_table_contains(mirror_files, mirror_name))
+			{
+				gchar *mirror_file = g_build_filename(mirror_dir_name, mirror_name, NULL);
+				g_unlink(mirror_file);
+				g_free(mirror_file);
+			}
+		}
+		g_dir_close(mirror_dir);
 	}
-	g_slist_free_full(file_list, (GDestroyNotify)g_strfreev);
 
 	/* Refresh cache */
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_REFRESH_CACHE);
 
+	n_repos = g_slist_length(repos);
+	n = 0;
 	for (GSList *l = repos; l; l = g_slist_next(l))
 	{
 		static_cast<Pkgtools *> (l->data)->generate_cache (job, tmp_dir_name);
+		n++;
+		pk_backend_job_set_percentage(job, 50 + 50 * n / n_repos);
 	}
+	search_index_rebuild(job_data->db);
+	best_candidates_rebuild(job_data->db);
 
 out:
 	sqlite3_finalize(stmt);
+	sqlite3_finalize(repo_stmt);
+	for (GSList *l = file_lists; l; l = g_slist_next(l))
+	{
+		g_slist_free_full(static_cast<GSList *> (l->data), (GDestroyNotify)g_strfreev);
+	}
+	g_slist_free(file_lists);
+	if (mirror_files)
+	{
+		g_hash_table_unref(mirror_files);
+	}
+	g_free(mirror_dir_name);
 	if (file_info)
 	{
 		g_object_unref(file_info);
@@ -8,29 +8,26 @@ namespace slack {
 /**
  * slack::Pkgtools::download:
  * @job: A #PkBackendJob.
+ * @downloader: Downloader the package is queued on.
  * @dest_dir_name: Destination directory.
  * @pkg_name: Package name.
  *
- * Download a package.
+ * Queue a package for download unless it is already in @dest_dir_name.
  *
- * Returns: %TRUE on success, %FALSE otherwise.
+ * Returns: %TRUE if the package was found, %FALSE otherwise.
  **/
 gboolean
-Pkgtools::download (PkBackendJob *job,
+Pkgtools::download (PkBackendJob *job, Downloader &downloader,
 		gchar *dest_dir_name, gchar *pkg_name) noexcept
 {
 	gchar *dest_filename, *source_url;
 	gboolean ret = FALSE;
 	sqlite3_stmt *statement = NULL;
-	CURL *curl = NULL;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(statement = prepare_statement(job_data,
 							"SELECT location, (full_name || '.' || ext) FROM pkglist "
-							"WHERE name LIKE @name AND repo_order = @repo_order",
-							-1,
-							&statement,
-							NULL) != SQLITE_OK))
+							"WHERE name = @name AND repo_order = @repo_order")))
 		return FALSE;
 
 	sqlite3_bind_text(statement, 1, pkg_name, -1, SQLITE_TRANSIENT);
@@ -47,24 +44,14 @@ Pkgtools::download (PkBackendJob *job,
 
 		if (!g_file_test(dest_filename, G_FILE_TEST_EXISTS))
 		{
-			if (get_file(&curl, source_url, dest_filename) == CURLE_OK)
-			{
-				ret = TRUE;
-			}
-		}
-		else
-		{
-			ret = TRUE;
+			downloader.add (source_url, dest_filename);
 		}
+		ret = TRUE;
 
-		if (curl)
-		{
-			curl_easy_cleanup(curl);
-		}
 		g_free(source_url);
 		g_free(dest_filename);
 	}
-	sqlite3_finalize(statement);
+	sqlite3_reset(statement);
 
 	return ret;
 }
@@ -83,12 +70,9 @@ Pkgtools::install (PkBackendJob *job, gchar *pkg_name) noexcept
 	sqlite3_stmt *statement = NULL;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(statement = prepare_statement(job_data,
 							"SELECT (full_name || '.' || ext) FROM pkglist "
-							"WHERE name LIKE @name AND repo_order = @repo_order",
-							-1,
-							&statement,
-							NULL) != SQLITE_OK))
+							"WHERE name = @name AND repo_order = @repo_order")))
 	{
 		return;
 	}
@@ -110,7 +94,7 @@ Pkgtools::install (PkBackendJob *job, gchar *pkg_name) noexcept
 
 		g_free(pkg_filename);
 	}
-	sqlite3_finalize(statement);
+	sqlite3_reset(statement);
 }
 
 Pkgtools::~Pkgtools () noexcept
@@ -3,6 +3,7 @@
 
 #include <glib-object.h>
 #include <pk-backend.h>
+#include "downloader.h"
 
 namespace slack {
 
@@ -16,7 +17,7 @@ public:
 
 	virtual ~Pkgtools () noexcept;
 
-	gboolean download (PkBackendJob *job,
+	gboolean download (PkBackendJob *job, Downloader &downloader,
 			gchar *dest_dir_name, gchar *pkg_name) noexcept;
 	void install (PkBackendJob *job, gchar *pkg_name) noexcept;
 
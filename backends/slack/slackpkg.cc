@@ -9,6 +9,220 @@ namespace slack {
 
 GHashTable *Slackpkg::cat_map = NULL;
 
+static inline bool
+is_blank (gchar c) noexcept
+{
+	return c == ' ' || c == '\t';
+}
+
+static inline bool
+is_space (gchar c) noexcept
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool
+is_digit (gchar c) noexcept
+{
+	return c >= '0' && c <= '9';
+}
+
+/**
+ * slack::ManifestReader::ManifestReader:
+ * @statement: INSERT statement taking the full package name and the file name.
+ *
+ * Constructor.
+ **/
+ManifestReader::ManifestReader (sqlite3_stmt *statement) noexcept
+: statement (statement)
+{
+}
+
+/*
+ * slack::ManifestReader::parse_package:
+ * @line: line start.
+ * @end:  line end.
+ *
+ * Recognize a package header like
+ * "||   Package:  ./slackware64/a/aaa_base-15.0-x86_64-3.txz". The file name
+ * without the extension becomes the current package for the file lines that
+ * follow. Headers of files with another extension reset the current package.
+ *
+ * Returns: true if the line is a package header.
+ */
+bool
+ManifestReader::parse_package (const gchar *line, const gchar *end) noexcept
+{
+	const gchar *p = line, *slash, *dot;
+
+	if (end - p < 3 || p[0] != '|' || p[1] != '|' || !is_blank (p[2]))
+	{
+		return false;
+	}
+	for (p += 2; p != end && is_blank (*p); p++);
+	if (end - p < 9 || memcmp (p, "Package:", 8) != 0 || !is_blank (p[8]))
+	{
+		return false;
+	}
+	p += 8;
+
+	/* The file name is what follows the last slash, up to its last dot.
+	 * There has to be something before the slash. */
+	for (slash = end - 1; slash >= p + 2; slash--)
+	{
+		if (*slash != '/')
+		{
+			continue;
+		}
+		for (dot = end - 1; dot > slash + 1 && *dot != '.'; dot--);
+		if (dot <= slash + 1)
+		{
+			continue;
+		}
+
+		have_package = end - dot == 4 && dot[1] == 't'
+			&& (dot[2] == 'b' || dot[2] == 'l' || dot[2] == 'x' || dot[2] == 'g')
+			&& dot[3] == 'z';
+		if (have_package)
+		{
+			full_name.assign (slash + 1, dot - slash - 1);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * slack::ManifestReader::parse_file:
+ * @line: line start.
+ * @end:  line end.
+ *
+ * Parse a tar listing line like
+ * "-rw-r--r-- root/root      1234 2022-02-02 12:34 usr/bin/foo". Entries
+ * under install/ and the "./" entry are skipped.
+ *
+ * Returns: the start of the file name, or %NULL.
+ */
+const gchar *
+ManifestReader::parse_file (const gchar *line, const gchar *end) const noexcept
+{
+	static const gchar *const modes[] = {
+		"-bcdlps", "-r", "-w", "-xsS", "-r", "-w", "-xsS", "-r", "-w", "-xtT"
+	};
+	const gchar *p = line;
+
+	if (end - p < 11)
+	{
+		return NULL;
+	}
+	for (const gchar *mode : modes)
+	{
+		if (!memchr (mode, *p++, strlen (mode)))
+		{
+			return NULL;
+		}
+	}
+
+	/* Owner */
+	if (!is_space (*p++) || p == end || is_space (*p))
+	{
+		return NULL;
+	}
+	for (; p != end && !is_space (*p); p++);
+	for (; p != end && is_space (*p); p++);
+
+	/* Size, date and time, each followed by exactly one space */
+	if (p == end || !is_digit (*p))
+	{
+		return NULL;
+	}
+	for (; p != end && is_digit (*p); p++);
+	if (p == end || !is_space (*p++) || p == end || !(is_digit (*p) || *p == '-'))
+	{
+		return NULL;
+	}
+	for (; p != end && (is_digit (*p) || *p == '-'); p++);
+	if (p == end || !is_space (*p++) || p == end || !(is_digit (*p) || *p == ':'))
+	{
+		return NULL;
+	}
+	for (; p != end && (is_digit (*p) || *p == ':'); p++);
+	if (p == end || !is_space (*p++))
+	{
+		return NULL;
+	}
+
+	if ((p != end && *p == '.')
+			|| (end - p >= 8 && memcmp (p, "install/", 8) == 0))
+	{
+		return NULL;
+	}
+	return p;
+}
+
+void
+ManifestReader::parse_line (const gchar *line, const gchar *end) noexcept
+{
+	const gchar *filename;
+
+	if (parse_package (line, end) || !have_package)
+	{
+		return;
+	}
+	if ((filename = parse_file (line, end)))
+	{
+		/* Both are bound statically, the statement is run right away */
+		sqlite3_bind_text (statement, 1, full_name.data (), full_name.size (), SQLITE_STATIC);
+		sqlite3_bind_text (statement, 2, filename, end - filename, SQLITE_STATIC);
+		sqlite3_step (statement);
+		sqlite3_clear_bindings (statement);
+		sqlite3_reset (statement);
+	}
+}
+
+/**
+ * slack::ManifestReader::feed:
+ * @data: decompressed manifest text.
+ * @len:  length of @data.
+ *
+ * Parse all complete lines in @data. The incomplete last line is kept until
+ * the next call.
+ **/
+void
+ManifestReader::feed (const gchar *data, std::size_t len) noexcept
+{
+	const gchar *end = data + len, *newline;
+
+	while ((newline = static_cast<const gchar *> (memchr (data, '\n', end - data))))
+	{
+		if (partial.empty ())
+		{
+			parse_line (data, newline);
+		}
+		else
+		{
+			partial.append (data, newline - data);
+			parse_line (partial.data (), partial.data () + partial.size ());
+			partial.clear ();
+		}
+		data = newline + 1;
+	}
+	partial.append (data, end - data);
+}
+
+/**
+ * slack::ManifestReader::finish:
+ *
+ * Parse the last line if the manifest does not end with a newline.
+ **/
+void
+ManifestReader::finish () noexcept
+{
+	parse_line (partial.data (), partial.data () + partial.size ());
+	partial.clear ();
+}
+
 /*
  * slack::Slackpkg::manifest:
  * @job:      a #PkBackendJob.
@@ -23,13 +237,8 @@ Slackpkg::manifest (PkBackendJob *job,
 {
 	FILE *manifest;
 	gint err, read_len;
-	guint pos;
-	gchar buf[max_buf_size], *path, *pkg_filename, *rest = NULL, *start;
-	gchar *full_name = NULL;
-	gchar **line, **lines;
+	gchar buf[max_buf_size], *path;
 	BZFILE *manifest_bz2;
-	GRegex *pkg_expr = NULL, *file_expr = NULL;
-	GMatchInfo *match_info;
 	sqlite3_stmt *statement = NULL;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
@@ -49,23 +258,6 @@ Slackpkg::manifest (PkBackendJob *job,
 		goto out;
 	}
 
-	/* Prepare regular expressions */
-	pkg_expr = g_regex_new("^\\|\\|[[:blank:]]+Package:[[:blank:]]+.+\\/(.+)\\.(t[blxg]z$)?",
-	                       static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
-	                       static_cast<GRegexMatchFlags> (0),
-	                       NULL);
-	file_expr = g_regex_new("^[-bcdlps][-r][-w][-xsS][-r][-w][-xsS][-r][-w]"
-	                        "[-xtT][[:space:]][^[:space:]]+[[:space:]]+"
-	                        "[[:digit:]]+[[:space:]][[:digit:]-]+[[:space:]]"
-	                        "[[:digit:]:]+[[:space:]](?!install\\/|\\.)(.*)",
-	                        static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
-	                        static_cast<GRegexMatchFlags> (0),
-	                        NULL);
-	if (!(file_expr) || !(pkg_expr))
-	{
-		goto out;
-	}
-
 	/* Prepare SQL statements */
 	if (sqlite3_prepare_v2(job_data->db,
 						   "INSERT INTO filelist (full_name, filename) VALUES (@full_name, @filename)",
@@ -73,79 +265,33 @@ Slackpkg::manifest (PkBackendJob *job,
 						   &statement,
 						   NULL) != SQLITE_OK)
 	{
+		BZ2_bzReadClose(&err, manifest_bz2);
 		goto out;
 	}
 
 	sqlite3_exec(job_data->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
-	while ((read_len = BZ2_bzRead(&err, manifest_bz2, buf, max_buf_size - 1)))
 	{
-		if ((err != BZ_OK) && (err != BZ_STREAM_END))
-		{
-			break;
-		}
-		buf[read_len] = '\0';
-
-		/* Split the read text into lines */
-		lines = g_strsplit(buf, "\n", 0);
-		if (rest)
-		{ /* Add to the first line rest characters from the previous read operation */
-			start = lines[0];
-			lines[0] = g_strconcat(rest, lines[0], NULL);
-			g_free(start);
-			g_free(rest);
-		}
-		if (err != BZ_STREAM_END) /* The last line can be incomplete */
-		{
-			pos = g_strv_length(lines) - 1;
-			rest = lines[pos];
-			lines[pos] = NULL;
-		}
-		for (line = lines; *line; line++)
+		ManifestReader reader (statement);
+
+		while ((read_len = BZ2_bzRead(&err, manifest_bz2, buf, max_buf_size)) || err == BZ_STREAM_END)
 		{
-			if (g_regex_match(pkg_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
+			if ((err != BZ_OK) && (err != BZ_STREAM_END))
 			{
-				if (g_match_info_get_match_count(match_info) > 2)
-				{ /* If the extension matches */
-					g_free(full_name);
-					full_name = g_match_info_fetch(match_info, 1);
-				}
-				else
-				{
-					full_name = NULL;
-				}
+				break;
 			}
-			g_match_info_free(match_info);
-
-			match_info = NULL;
-			if (full_name && g_regex_match(file_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
+			reader.feed (buf, read_len);
+			if (err == BZ_STREAM_END)
 			{
-				pkg_filename = g_match_info_fetch(match_info, 1);
-				sqlite3_bind_text(statement, 1, full_name, -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(statement, 2, pkg_filename, -1, SQLITE_TRANSIENT);
-				sqlite3_step(statement);
-				sqlite3_clear_bindings(statement);
-				sqlite3_reset(statement);
-				g_free(pkg_filename);
+				reader.finish ();
+				break;
 			}
-			g_match_info_free(match_info);
 		}
-		g_strfreev(lines);
 	}
-
 	sqlite3_exec(job_data->db, "END TRANSACTION", NULL, NULL, NULL);
-	g_free(full_name);
 	BZ2_bzReadClose(&err, manifest_bz2);
 
 out:
 	sqlite3_finalize(statement);
-	if (file_expr)
-	{
-		g_regex_unref(file_expr);
-	}
-	if (pkg_expr)
-	{
-		g_regex_unref(pkg_expr);
-	}
 	fclose(manifest);
 }
 
@@ -266,7 +412,7 @@ Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
 	}
 	/* Remove the old entries from this repository */
 	if (sqlite3_prepare_v2(job_data->db,
-	                       "DELETE FROM repos WHERE repo LIKE @repo",
+	                       "DELETE FROM repos WHERE repo = @repo",
 	                       -1,
 	                       &statement,
 	                       NULL) == SQLITE_OK)
@@ -319,7 +465,7 @@ Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
 	query = sqlite3_mprintf("UPDATE pkglist SET full_name = @full_name, ver = @ver, arch = @arch, "
 	                        "ext = @ext, location = @location, summary = @summary, "
 	                        "desc = @desc, compressed = @compressed, uncompressed = @uncompressed "
-	                        "WHERE name LIKE @name AND repo_order = %u",
+	                        "WHERE name = @name AND repo_order = %u",
 	                        this->get_order ());
 	if (sqlite3_prepare_v2(job_data->db, query, -1, &update_statement, NULL) != SQLITE_OK)
 	{
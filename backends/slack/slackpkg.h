@@ -2,10 +2,36 @@
 #define __SLACK_SLACKPKG_H
 
 #include <cstddef>
+#include <string>
+#include <sqlite3.h>
 #include "pkgtools.h"
 
 namespace slack {
 
+/*
+ * Turns the decompressed text of a MANIFEST into (full_name, filename) rows.
+ * The text can be fed in chunks of any size, lines are parsed in place and
+ * only a line split between two chunks is copied.
+ */
+class ManifestReader final
+{
+public:
+	explicit ManifestReader (sqlite3_stmt *statement) noexcept;
+
+	void feed (const gchar *data, std::size_t len) noexcept;
+	void finish () noexcept;
+
+private:
+	sqlite3_stmt *statement;
+	std::string full_name;
+	bool have_package = false;
+	std::string partial;
+
+	void parse_line (const gchar *line, const gchar *end) noexcept;
+	bool parse_package (const gchar *line, const gchar *end) noexcept;
+	const gchar *parse_file (const gchar *line, const gchar *end) const noexcept;
+};
+
 class Slackpkg final : public Pkgtools
 {
 public:
@@ -1,15 +1,20 @@
 #include "pk-backend.h"
 #include <pk-backend-job.h>
 
+/* Tests running a job thread can set these to see what the job reports */
+static gpointer job_user_data = NULL;
+GPtrArray *job_packages = NULL;
+
 gpointer
 pk_backend_job_get_user_data (PkBackendJob *job)
 {
-	return NULL;
+	return job_user_data;
 }
 
 void
 pk_backend_job_set_user_data (PkBackendJob *job, gpointer user_data)
 {
+	job_user_data = user_data;
 }
 
 void
@@ -23,6 +28,10 @@ pk_backend_job_package (PkBackendJob *job,
 			const gchar *package_id,
 			const gchar *summary)
 {
+	if (job_packages != NULL)
+	{
+		g_ptr_array_add (job_packages, g_strdup (package_id));
+	}
 }
 
 void
@@ -35,6 +44,11 @@ pk_backend_job_set_percentage (PkBackendJob *job, guint percentage)
 {
 }
 
+void
+pk_backend_job_set_speed (PkBackendJob *job, guint speed)
+{
+}
+
 void
 pk_backend_job_error_code (PkBackendJob *job,
 		PkErrorEnum error_code, const gchar *format, ...)
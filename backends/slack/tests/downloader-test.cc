@@ -0,0 +1,427 @@
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <utime.h>
+#include "downloader.h"
+
+using namespace slack;
+
+/* Every file served by the fixture was last modified on 2022-01-01 */
+static const gchar *last_modified = "Sat, 01 Jan 2022 00:00:00 GMT";
+static const time_t last_modified_time = 1640995200;
+
+/*
+ * Minimal HTTP server. Files below /files/ support ranges and conditional
+ * requests, files below /norange/ are always sent completely.
+ */
+static struct
+{
+	GSocketListener *listener;
+	GCancellable *cancellable;
+	GThread *thread;
+	guint16 port;
+
+	GMutex lock;
+	guint active;
+	guint max_active;
+	guint requests;
+	gint64 last_range;
+} server;
+
+static gchar *
+file_contents (const gchar *name, gsize *len)
+{
+	GString *contents = g_string_new (NULL);
+
+	for (guint i = 0; i < 4096; i++)
+	{
+		g_string_append_printf (contents, "%s %u\n", name, i);
+	}
+	*len = contents->len;
+
+	return g_string_free (contents, FALSE);
+}
+
+static gpointer
+serve_connection (gpointer data)
+{
+	auto connection = static_cast<GSocketConnection *> (data);
+	GDataInputStream *in;
+	GOutputStream *out;
+	gchar *line, *path = NULL, *body = NULL, *header;
+	gsize body_len = 0, sent_len = 0;
+	gint64 from = -1;
+	time_t since = 0;
+
+	g_mutex_lock (&server.lock);
+	server.active++;
+	server.max_active = MAX (server.max_active, server.active);
+	server.requests++;
+	g_mutex_unlock (&server.lock);
+
+	in = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+	while ((line = g_data_input_stream_read_line (in, NULL, NULL, NULL)))
+	{
+		g_strchomp (line);
+		if (*line == '\0')
+		{
+			g_free (line);
+			break;
+		}
+		if (path == NULL)
+		{
+			gchar **tokens = g_strsplit (line, " ", 3);
+			path = g_strdup (tokens[1]);
+			g_strfreev (tokens);
+		}
+		else if (g_str_has_prefix (line, "Range: bytes="))
+		{
+			from = g_ascii_strtoll (line + 13, NULL, 10);
+		}
+		else if (g_str_has_prefix (line, "If-Modified-Since: "))
+		{
+			since = curl_getdate (line + 19, NULL);
+		}
+		g_free (line);
+	}
+
+	g_mutex_lock (&server.lock);
+	server.last_range = from;
+	g_mutex_unlock (&server.lock);
+
+	/* Let the transfers overlap */
+	g_usleep (G_USEC_PER_SEC / 20);
+
+	if (path && g_str_has_prefix (path, "/norange/"))
+	{
+		body = file_contents (path + 9, &body_len);
+		from = -1;
+	}
+	else if (path && g_str_has_prefix (path, "/files/"))
+	{
+		body = file_contents (path + 7, &body_len);
+	}
+
+	if (body == NULL)
+	{
+		header = g_strdup ("HTTP/1.1 404 Not Found\r\n"
+				"Content-Length: 0\r\nConnection: close\r\n\r\n");
+	}
+	else if (since >= last_modified_time)
+	{
+		header = g_strdup_printf ("HTTP/1.1 304 Not Modified\r\n"
+				"Last-Modified: %s\r\nConnection: close\r\n\r\n", last_modified);
+	}
+	else if (from >= (gint64) body_len)
+	{
+		header = g_strdup_printf ("HTTP/1.1 416 Range Not Satisfiable\r\n"
+				"Content-Range: bytes */%" G_GSIZE_FORMAT "\r\n"
+				"Content-Length: 0\r\nConnection: close\r\n\r\n", body_len);
+	}
+	else if (from > 0)
+	{
+		sent_len = body_len - from;
+		header = g_strdup_printf ("HTTP/1.1 206 Partial Content\r\n"
+				"Content-Range: bytes %" G_GINT64_FORMAT "-%" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT "\r\n"
+				"Content-Length: %" G_GSIZE_FORMAT "\r\nLast-Modified: %s\r\n"
+				"Connection: close\r\n\r\n",
+				from, body_len - 1, body_len, sent_len, last_modified);
+	}
+	else
+	{
+		from = 0;
+		sent_len = body_len;
+		header = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+				"Content-Length: %" G_GSIZE_FORMAT "\r\nLast-Modified: %s\r\n"
+				"Connection: close\r\n\r\n", body_len, last_modified);
+	}
+
+	g_output_stream_write_all (out, header, strlen (header), NULL, NULL, NULL);
+	if (sent_len > 0)
+	{
+		g_output_stream_write_all (out, body + from, sent_len, NULL, NULL, NULL);
+	}
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+
+	g_mutex_lock (&server.lock);
+	server.active--;
+	g_mutex_unlock (&server.lock);
+
+	g_free (header);
+	g_free (body);
+	g_free (path);
+	g_object_unref (in);
+	g_object_unref (connection);
+
+	return NULL;
+}
+
+static gpointer
+serve (gpointer data)
+{
+	GSocketConnection *connection;
+
+	while ((connection = g_socket_listener_accept (server.listener, NULL,
+					server.cancellable, NULL)))
+	{
+		g_thread_unref (g_thread_new ("connection", serve_connection, connection));
+	}
+	return NULL;
+}
+
+static void
+server_start ()
+{
+	g_mutex_init (&server.lock);
+	server.listener = g_socket_listener_new ();
+	server.cancellable = g_cancellable_new ();
+	server.port = g_socket_listener_add_any_inet_port (server.listener, NULL, NULL);
+	g_assert_cmpuint (server.port, !=, 0);
+	server.thread = g_thread_new ("server", serve, NULL);
+}
+
+static void
+server_stop ()
+{
+	g_cancellable_cancel (server.cancellable);
+	g_thread_join (server.thread);
+	g_socket_listener_close (server.listener);
+	g_object_unref (server.listener);
+	g_object_unref (server.cancellable);
+}
+
+static void
+server_reset ()
+{
+	g_mutex_lock (&server.lock);
+	server.max_active = 0;
+	server.requests = 0;
+	server.last_range = -1;
+	g_mutex_unlock (&server.lock);
+}
+
+static gchar *
+server_url (const gchar *path)
+{
+	return g_strdup_printf ("http://127.0.0.1:%u%s", server.port, path);
+}
+
+static void
+remove_dir (gchar *dir_name)
+{
+	const gchar *name;
+	GDir *dir = g_dir_open (dir_name, 0, NULL);
+
+	while ((name = g_dir_read_name (dir)))
+	{
+		gchar *filename = g_build_filename (dir_name, name, NULL);
+		g_unlink (filename);
+		g_free (filename);
+	}
+	g_dir_close (dir);
+	g_rmdir (dir_name);
+	g_free (dir_name);
+}
+
+static void
+assert_contents (const gchar *filename, const gchar *name)
+{
+	gchar *contents, *expected;
+	gsize len, expected_len;
+
+	g_assert_true (g_file_get_contents (filename, &contents, &len, NULL));
+	expected = file_contents (name, &expected_len);
+	g_assert_cmpmem (contents, len, expected, expected_len);
+
+	g_free (expected);
+	g_free (contents);
+}
+
+static void
+slack_test_downloader_parallel ()
+{
+	gchar *dir = g_dir_make_tmp ("slack-downloader-XXXXXX", NULL);
+	gchar *dests[8], *part;
+	Downloader downloader (NULL);
+
+	for (guint i = 0; i < G_N_ELEMENTS (dests); i++)
+	{
+		gchar *name = g_strdup_printf ("package%u", i);
+		gchar *path = g_strconcat ("/files/", name, NULL);
+		gchar *url = server_url (path);
+
+		dests[i] = g_build_filename (dir, name, NULL);
+		g_assert_cmpuint (downloader.add (url, dests[i]), ==, i);
+
+		g_free (url);
+		g_free (path);
+		g_free (name);
+	}
+
+	server_reset ();
+	g_assert_true (downloader.run ());
+	g_assert_cmpuint (server.requests, ==, G_N_ELEMENTS (dests));
+	g_assert_cmpuint (server.max_active, >, 1);
+	g_assert_cmpuint (server.max_active, <=, Downloader::max_transfers);
+
+	for (guint i = 0; i < G_N_ELEMENTS (dests); i++)
+	{
+		gchar *name = g_path_get_basename (dests[i]);
+
+		g_assert_cmpint (downloader.get_result (i), ==, CURLE_OK);
+		g_assert_true (downloader.is_modified (i));
+		assert_contents (dests[i], name);
+
+		part = g_strconcat (dests[i], ".part", NULL);
+		g_assert_false (g_file_test (part, G_FILE_TEST_EXISTS));
+
+		g_free (part);
+		g_free (name);
+		g_free (dests[i]);
+	}
+	remove_dir (dir);
+}
+
+static void
+slack_test_downloader_resume ()
+{
+	gchar *dir = g_dir_make_tmp ("slack-downloader-XXXXXX", NULL);
+	gchar *dest, *part, *url, *contents;
+	gsize len;
+
+	/* Continue the first half */
+	dest = g_build_filename (dir, "resumed", NULL);
+	part = g_strconcat (dest, ".part", NULL);
+	contents = file_contents ("resumed", &len);
+	g_assert_true (g_file_set_contents (part, contents, len / 2, NULL));
+	url = server_url ("/files/resumed");
+	{
+		Downloader downloader (NULL);
+
+		downloader.add (url, dest);
+		server_reset ();
+		g_assert_true (downloader.run ());
+		g_assert_cmpint (server.last_range, ==, len / 2);
+		assert_contents (dest, "resumed");
+		g_assert_false (g_file_test (part, G_FILE_TEST_EXISTS));
+	}
+	g_free (url);
+	g_free (contents);
+	g_free (part);
+	g_free (dest);
+
+	/* The server doesn't support ranges, the partial file is replaced */
+	dest = g_build_filename (dir, "restarted", NULL);
+	part = g_strconcat (dest, ".part", NULL);
+	g_assert_true (g_file_set_contents (part, "stale data", -1, NULL));
+	url = server_url ("/norange/restarted");
+	{
+		Downloader downloader (NULL);
+
+		downloader.add (url, dest);
+		server_reset ();
+		g_assert_true (downloader.run ());
+		g_assert_cmpuint (server.requests, ==, 2);
+		assert_contents (dest, "restarted");
+	}
+	g_free (url);
+	g_free (part);
+	g_free (dest);
+
+	remove_dir (dir);
+}
+
+static void
+slack_test_downloader_conditional ()
+{
+	gchar *dir = g_dir_make_tmp ("slack-downloader-XXXXXX", NULL);
+	gchar *dest = g_build_filename (dir, "PACKAGES.TXT", NULL);
+	gchar *url = server_url ("/files/PACKAGES.TXT");
+	GStatBuf st;
+	struct utimbuf times;
+
+	/* First download, the file gets the modification time of the remote one */
+	{
+		Downloader downloader (NULL);
+
+		downloader.add_conditional (url, dest);
+		g_assert_true (downloader.run ());
+		g_assert_true (downloader.is_modified (0));
+		g_assert_cmpint (g_stat (dest, &st), ==, 0);
+		g_assert_cmpint (st.st_mtime, ==, last_modified_time);
+	}
+
+	/* Not modified since */
+	{
+		Downloader downloader (NULL);
+
+		downloader.add_conditional (url, dest);
+		g_assert_true (downloader.run ());
+		g_assert_cmpint (downloader.get_result (0), ==, CURLE_OK);
+		g_assert_false (downloader.is_modified (0));
+		assert_contents (dest, "PACKAGES.TXT");
+	}
+
+	/* An outdated copy is replaced */
+	g_assert_true (g_file_set_contents (dest, "outdated", -1, NULL));
+	times.actime = times.modtime = last_modified_time - 86400;
+	g_assert_cmpint (g_utime (dest, &times), ==, 0);
+	{
+		Downloader downloader (NULL);
+
+		downloader.add_conditional (url, dest);
+		g_assert_true (downloader.run ());
+		g_assert_true (downloader.is_modified (0));
+		assert_contents (dest, "PACKAGES.TXT");
+	}
+
+	g_free (url);
+	g_free (dest);
+	remove_dir (dir);
+}
+
+static void
+slack_test_downloader_missing ()
+{
+	gchar *dir = g_dir_make_tmp ("slack-downloader-XXXXXX", NULL);
+	gchar *dest = g_build_filename (dir, "missing", NULL);
+	gchar *part = g_strconcat (dest, ".part", NULL);
+	gchar *url = server_url ("/missing");
+	Downloader downloader (NULL);
+
+	downloader.add (url, dest);
+	g_assert_false (downloader.run ());
+	g_assert_cmpint (downloader.get_result (0), !=, CURLE_OK);
+	g_assert_false (downloader.is_modified (0));
+	g_assert_false (g_file_test (dest, G_FILE_TEST_EXISTS));
+	g_assert_false (g_file_test (part, G_FILE_TEST_EXISTS));
+
+	g_free (url);
+	g_free (part);
+	g_free (dest);
+	remove_dir (dir);
+}
+
+int
+main (int argc, char *argv[])
+{
+	int ret;
+
+	g_test_init (&argc, &argv, NULL);
+	curl_global_init (CURL_GLOBAL_DEFAULT);
+	server_start ();
+
+	g_test_add_func ("/slack/downloader/parallel", slack_test_downloader_parallel);
+	g_test_add_func ("/slack/downloader/resume", slack_test_downloader_resume);
+	g_test_add_func ("/slack/downloader/conditional", slack_test_downloader_conditional);
+	g_test_add_func ("/slack/downloader/missing", slack_test_downloader_missing);
+
+	ret = g_test_run ();
+
+	server_stop ();
+	curl_global_cleanup ();
+
+	return ret;
+}
@@ -0,0 +1,241 @@
+#include <glib/gstdio.h>
+#include <sqlite3.h>
+#include "job.h"
+#include "utils.h"
+
+using namespace slack;
+
+extern GPtrArray *job_packages;
+
+static const gchar *schema =
+	"CREATE TABLE repos (repo_order INTEGER PRIMARY KEY AUTOINCREMENT,repo VARCHAR NOT NULL);"
+	"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE,name VARCHAR NOT NULL,"
+	"ver VARCHAR NOT NULL,arch VARCHAR DEFAULT NULL,ext VARCHAR DEFAULT NULL,"
+	"location VARCHAR DEFAULT '.',summary VARCHAR DEFAULT '',desc TEXT DEFAULT '',"
+	"compressed INT DEFAULT 0,uncompressed INT DEFAULT 0,cat VARCHAR DEFAULT 'unknown',"
+	"repo_order INTEGER REFERENCES repos(repo_order) ON DELETE CASCADE,"
+	"PRIMARY KEY (name, repo_order));"
+	"CREATE TABLE filelist (full_name VARCHAR NOT NULL REFERENCES pkglist(full_name) "
+	"ON DELETE CASCADE,filename VARCHAR NOT NULL,PRIMARY KEY (full_name, filename));";
+
+static const gchar *dirs[] = {
+	"usr/bin", "usr/lib64", "usr/share/doc", "usr/share/man/man1",
+	"usr/include", "etc", "usr/share/locale/de/LC_MESSAGES", "usr/share/applications"
+};
+
+/*
+ * Fill the database with a synthetic manifest, every package gets
+ * @files_per_pkg files with pseudo random names.
+ */
+static sqlite3 *
+create_db (guint n_pkgs, guint files_per_pkg)
+{
+	sqlite3 *db;
+	sqlite3_stmt *pkg_stmt, *file_stmt;
+	GRand *rand = g_rand_new_with_seed (42);
+
+	g_assert_cmpint (sqlite3_open (":memory:", &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db, schema, NULL, NULL, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db, "INSERT INTO repos VALUES (1, 'slackware')",
+				NULL, NULL, NULL), ==, SQLITE_OK);
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"INSERT INTO pkglist (full_name, name, ver, arch, ext, desc, repo_order) "
+				"VALUES (@full_name, @name, '1.0', 'x86_64', 'txz', @desc, 1)",
+				-1, &pkg_stmt, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"INSERT INTO filelist (full_name, filename) VALUES (@full_name, @filename)",
+				-1, &file_stmt, NULL), ==, SQLITE_OK);
+
+	sqlite3_exec (db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	for (guint i = 0; i < n_pkgs; i++)
+	{
+		gchar *name = g_strdup_printf ("pkg%x%u", g_rand_int (rand), i);
+		gchar *full_name = g_strdup_printf ("%s-1.0-x86_64-1", name);
+		gchar *desc = g_strdup_printf ("%s: the %x library", name, g_rand_int (rand));
+
+		sqlite3_bind_text (pkg_stmt, 1, full_name, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text (pkg_stmt, 2, name, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text (pkg_stmt, 3, desc, -1, SQLITE_TRANSIENT);
+		g_assert_cmpint (sqlite3_step (pkg_stmt), ==, SQLITE_DONE);
+		sqlite3_reset (pkg_stmt);
+
+		for (guint j = 0; j < files_per_pkg; j++)
+		{
+			gchar *filename = g_strdup_printf ("%s/%s-%x",
+					dirs[g_rand_int_range (rand, 0, G_N_ELEMENTS (dirs))],
+					name, g_rand_int (rand));
+			sqlite3_bind_text (file_stmt, 1, full_name, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text (file_stmt, 2, filename, -1, SQLITE_TRANSIENT);
+			g_assert_cmpint (sqlite3_step (file_stmt), ==, SQLITE_DONE);
+			sqlite3_reset (file_stmt);
+			g_free (filename);
+		}
+		g_free (desc);
+		g_free (full_name);
+		g_free (name);
+	}
+	sqlite3_exec (db, "END TRANSACTION", NULL, NULL, NULL);
+
+	sqlite3_finalize (file_stmt);
+	sqlite3_finalize (pkg_stmt);
+	g_rand_free (rand);
+	g_assert_true (best_candidates_create (db));
+
+	return db;
+}
+
+/*
+ * Run a search job over @db like the daemon would and return the number of
+ * packages it reported. Nothing is installed, so all of them are available.
+ */
+static guint
+run_search (sqlite3 *db, PkBackendJobThreadFunc func, const gchar *column, const gchar *search)
+{
+	JobData job_data {};
+	const gchar *terms[] = { search, NULL };
+	gchar *metadata_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	GVariant *params = g_variant_ref_sink (g_variant_new ("(t^as)",
+				pk_bitfield_value (PK_FILTER_ENUM_NONE), terms));
+	guint n_packages;
+
+	g_assert_nonnull (metadata_dir);
+	job_data.db = db;
+	job_data.installed = new InstalledIndex (metadata_dir);
+	pk_backend_job_set_user_data (NULL, &job_data);
+	job_packages = g_ptr_array_new_with_free_func (g_free);
+
+	func (NULL, params, (gpointer) column);
+	n_packages = job_packages->len;
+
+	g_clear_pointer (&job_packages, g_ptr_array_unref);
+	pk_backend_job_set_user_data (NULL, NULL);
+	delete job_data.installed;
+	g_variant_unref (params);
+	g_rmdir (metadata_dir);
+	g_free (metadata_dir);
+
+	return n_packages;
+}
+
+static guint
+search_files (sqlite3 *db, const gchar *search)
+{
+	return run_search (db, pk_backend_search_files_thread, NULL, search);
+}
+
+static guint
+search_names (sqlite3 *db, const gchar *search)
+{
+	return run_search (db, pk_backend_search_thread, "name", search);
+}
+
+static void
+slack_test_search_index_create ()
+{
+	sqlite3 *db = create_db (100, 10);
+	gchar *terms[] = { (gchar *) "lib", NULL };
+	gchar *short_terms[] = { (gchar *) "li", NULL };
+	PkBitfield filters = pk_bitfield_value (PK_FILTER_ENUM_NONE);
+	guint bin_files, locale_files, include_files;
+
+	/* without an index everything is a table scan */
+	g_assert_false (search_index_usable (db, terms));
+	g_assert_cmpuint (search_names (db, "pkg"), ==, 100);
+	bin_files = search_files (db, "usr/bin");
+	locale_files = search_files (db, "share%LC_MESSAGES");
+	include_files = search_files (db, "usr/include");
+	g_assert_cmpuint (bin_files, >, 0);
+	g_assert_cmpuint (include_files, >, 0);
+
+	g_assert_true (search_index_create (db));
+	g_assert_true (search_index_usable (db, terms));
+	g_assert_false (search_index_usable (db, short_terms));
+	g_assert_true (generate_query (filters, "name", TRUE).find ("pkglist_fts") != std::string::npos);
+	g_assert_true (generate_query (filters, "name", FALSE).find ("pkglist_fts") == std::string::npos);
+
+	/* existing indexes are kept */
+	g_assert_true (search_index_create (db));
+	g_assert_true (search_index_usable (db, terms));
+
+	g_assert_cmpuint (search_names (db, "pkg"), ==, 100);
+	g_assert_cmpuint (search_files (db, "usr/bin"), ==, bin_files);
+	g_assert_cmpuint (search_files (db, "share%LC_MESSAGES"), ==, locale_files);
+
+	/* packages added after the last rebuild are still found */
+	g_assert_cmpint (sqlite3_exec (db,
+				"INSERT INTO pkglist (full_name, name, ver, arch, ext, repo_order) "
+				"VALUES ('extra-1.0-x86_64-1', 'extra', '1.0', 'x86_64', 'txz', 1);"
+				"INSERT INTO best_candidates VALUES ('extra', 1);"
+				"INSERT INTO filelist VALUES ('extra-1.0-x86_64-1', 'usr/bin/extra-tool')",
+				NULL, NULL, NULL), ==, SQLITE_OK);
+	g_assert_false (search_index_usable (db, terms));
+	g_assert_cmpuint (search_names (db, "extra"), ==, 1);
+	g_assert_cmpuint (search_files (db, "usr/bin"), ==, bin_files + 1);
+	search_index_rebuild (db);
+	g_assert_true (search_index_usable (db, terms));
+	g_assert_cmpuint (search_names (db, "extra"), ==, 1);
+	g_assert_cmpuint (search_files (db, "usr/bin"), ==, bin_files + 1);
+
+	/* rows deleted before the next rebuild are never returned */
+	sqlite3_exec (db, "DELETE FROM filelist WHERE filename LIKE 'usr/include/%'", NULL, NULL, NULL);
+	g_assert_false (search_index_usable (db, terms));
+	g_assert_cmpuint (search_files (db, "usr/include"), ==, 0);
+	search_index_rebuild (db);
+	g_assert_cmpuint (search_files (db, "usr/include"), ==, 0);
+
+	sqlite3_close (db);
+}
+
+/*
+ * Time the file search before and after the index is created.
+ */
+static void
+slack_test_search_index_bench ()
+{
+	/* About the size of the Slackware 15.0 MANIFEST */
+	sqlite3 *db = create_db (1500, 200);
+	const gchar *searches[] = {
+		"usr/bin/pkg", "LC_MESSAGES", "applications%pkg1", "nonexistent"
+	};
+	guint scan_counts[G_N_ELEMENTS (searches)];
+	gdouble scan_times[G_N_ELEMENTS (searches)];
+	GTimer *timer = g_timer_new ();
+
+	for (guint i = 0; i < G_N_ELEMENTS (searches); i++)
+	{
+		g_timer_start (timer);
+		scan_counts[i] = search_files (db, searches[i]);
+		scan_times[i] = g_timer_elapsed (timer, NULL);
+	}
+
+	g_assert_true (search_index_create (db));
+	for (guint i = 0; i < G_N_ELEMENTS (searches); i++)
+	{
+		guint indexed_count;
+
+		g_timer_start (timer);
+		indexed_count = search_files (db, searches[i]);
+		g_test_message ("file search '%s': %u packages, scan %.2f ms, index %.2f ms",
+				searches[i], indexed_count, scan_times[i] * 1000,
+				g_timer_elapsed (timer, NULL) * 1000);
+		g_assert_cmpuint (indexed_count, ==, scan_counts[i]);
+	}
+
+	g_timer_destroy (timer);
+	sqlite3_close (db);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/slack/search_index/create", slack_test_search_index_create);
+	if (g_test_perf ())
+	{
+		g_test_add_func ("/slack/search_index/bench", slack_test_search_index_bench);
+	}
+
+	return g_test_run ();
+}
@@ -1,7 +1,182 @@
+#include <string.h>
 #include "slackpkg.h"
 
 using namespace slack;
 
+static const gchar *manifest_text =
+	"++========================================\n"
+	"||\n"
+	"||   Package:  ./a/aaa_base-15.0-x86_64-3.txz\n"
+	"||\n"
+	"++========================================\n"
+	"drwxr-xr-x root/root         0 2022-02-02 12:34 ./\n"
+	"drwxr-xr-x root/root         0 2022-02-02 12:34 etc/\n"
+	"-rw-r--r-- root/root       118 2022-02-02 12:34 etc/motd.new\n"
+	"drwxr-xr-x root/root         0 2022-02-02 12:34 install/\n"
+	"-rw-r--r-- root/root      1234 2022-02-02 12:34 install/doinst.sh\n"
+	"lrwxrwxrwx root/root         0 2022-02-02 12:34 usr/lib64/libfoo.so -> libfoo.so.1\n"
+	"-rwsr-xr-x root/root     42123 2022-02-02 12:34 usr/bin/with spaces and \ttab\n"
+	"drwxrwxrwt root/root         0 2022-02-02 12:34 tmp/\n"
+	"-rw-r--r-- root/root 1 2022-02-02 12:34 .hidden\n"
+	"-rw-r--r-- root/root  1  2022-02-02 12:34 two/spaces/after/size\n"
+	"-rw-r--r--\troot/root\t1\t2022-02-02\t12:34\ttabs/everywhere\n"
+	"-rw-r--r-- root/root      1234 2022-02-02 12:34 \n"
+	"-rw-r--r-- root/root      1234 2022-02-02 12:34 installer/not/skipped\n"
+	"-rw-r--r-X root/root      1234 2022-02-02 12:34 bad/mode\n"
+	"-rw-r--r-- root/root      12a4 2022-02-02 12:34 bad/size\n"
+	"-rw-r--r-- root/root      1234 2022/02/02 12:34 bad/date\n"
+	"-rw-r--r-- root/root      1234 2022-02-02 12:34\n"
+	"\n"
+	"||   Package:  ./a/readme.txt\n"
+	"-rw-r--r-- root/root       118 2022-02-02 12:34 not/in/a/package\n"
+	"||   Package:  ./patches/packages/foo-1.2-noarch-1_slack15.0.tgz\n"
+	"-rw-r--r-- root/root       118 2022-02-02 12:34 usr/share/foo\n"
+	"||   Package:./no/blank-1.0-noarch-1.txz\n"
+	"-rw-r--r-- root/root       118 2022-02-02 12:34 still/foo\n"
+	"||   Package:  ./weird/.txz\n"
+	"-rw-r--r-- root/root       118 2022-02-02 12:34 weird/file\n"
+	"||   Package:  no-slash-1.0-noarch-1.txz\n"
+	"-rw-r--r-- root/root       118 2022-02-02 12:34 still/weird\n"
+	"||\tPackage:\t./x/tabbed-1.0-x86_64-1.tlz\n"
+	"brw-r----- root/disk      8,0 2022-02-02 12:34 dev/sda\n"
+	"crw-rw-rw- root/root         0 2022-02-02 12:34 dev/null\n"
+	"prw-r--r-- root/root         0 2022-02-02 12:34 run/fifo\n"
+	"-rw-r--r-- root/root         0 2022-02-02 12:34 no/newline/at/end";
+
+/*
+ * The regular expression based parser the manifest reader replaced, kept to
+ * check that both produce the same file list.
+ */
+static void
+reference_manifest (sqlite3_stmt *statement, const gchar *text)
+{
+	gchar *full_name = NULL;
+	gchar **lines = g_strsplit (text, "\n", 0);
+	GMatchInfo *match_info;
+	GRegex *pkg_expr = g_regex_new ("^\\|\\|[[:blank:]]+Package:[[:blank:]]+.+\\/(.+)\\.(t[blxg]z$)?",
+			static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
+			static_cast<GRegexMatchFlags> (0),
+			NULL);
+	GRegex *file_expr = g_regex_new ("^[-bcdlps][-r][-w][-xsS][-r][-w][-xsS][-r][-w]"
+			"[-xtT][[:space:]][^[:space:]]+[[:space:]]+"
+			"[[:digit:]]+[[:space:]][[:digit:]-]+[[:space:]]"
+			"[[:digit:]:]+[[:space:]](?!install\\/|\\.)(.*)",
+			static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
+			static_cast<GRegexMatchFlags> (0),
+			NULL);
+
+	for (gchar **line = lines; *line; line++)
+	{
+		if (g_regex_match (pkg_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
+		{
+			g_free (full_name);
+			full_name = NULL;
+			if (g_match_info_get_match_count (match_info) > 2)
+			{
+				full_name = g_match_info_fetch (match_info, 1);
+			}
+		}
+		g_match_info_free (match_info);
+
+		match_info = NULL;
+		if (full_name && g_regex_match (file_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
+		{
+			gchar *pkg_filename = g_match_info_fetch (match_info, 1);
+			sqlite3_bind_text (statement, 1, full_name, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text (statement, 2, pkg_filename, -1, SQLITE_TRANSIENT);
+			sqlite3_step (statement);
+			sqlite3_clear_bindings (statement);
+			sqlite3_reset (statement);
+			g_free (pkg_filename);
+		}
+		g_match_info_free (match_info);
+	}
+
+	g_free (full_name);
+	g_regex_unref (file_expr);
+	g_regex_unref (pkg_expr);
+	g_strfreev (lines);
+}
+
+/*
+ * Parse @text with @parse into an empty file list and return the rows as text.
+ */
+static gchar *
+dump_file_list (void (*parse) (sqlite3_stmt *, const gchar *, gsize), const gchar *text, gsize chunk)
+{
+	sqlite3 *db;
+	sqlite3_stmt *statement;
+	GString *rows = g_string_new (NULL);
+
+	g_assert_cmpint (sqlite3_open (":memory:", &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db, "CREATE TABLE filelist (full_name, filename)",
+				NULL, NULL, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"INSERT INTO filelist (full_name, filename) VALUES (@full_name, @filename)",
+				-1, &statement, NULL), ==, SQLITE_OK);
+	parse (statement, text, chunk);
+	sqlite3_finalize (statement);
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"SELECT full_name, filename FROM filelist ORDER BY rowid",
+				-1, &statement, NULL), ==, SQLITE_OK);
+	while (sqlite3_step (statement) == SQLITE_ROW)
+	{
+		g_string_append_len (rows,
+				reinterpret_cast<const gchar *> (sqlite3_column_blob (statement, 0)),
+				sqlite3_column_bytes (statement, 0));
+		g_string_append_c (rows, '|');
+		g_string_append_len (rows,
+				reinterpret_cast<const gchar *> (sqlite3_column_blob (statement, 1)),
+				sqlite3_column_bytes (statement, 1));
+		g_string_append_c (rows, '\n');
+	}
+	sqlite3_finalize (statement);
+	sqlite3_close (db);
+
+	return g_string_free (rows, FALSE);
+}
+
+static void
+parse_reference (sqlite3_stmt *statement, const gchar *text, gsize chunk)
+{
+	reference_manifest (statement, text);
+}
+
+static void
+parse_chunked (sqlite3_stmt *statement, const gchar *text, gsize chunk)
+{
+	ManifestReader reader (statement);
+	gsize len = strlen (text);
+
+	for (gsize pos = 0; pos < len; pos += chunk)
+	{
+		reader.feed (text + pos, MIN (chunk, len - pos));
+	}
+	reader.finish ();
+}
+
+static void
+slack_test_slackpkg_manifest ()
+{
+	gchar *expected = dump_file_list (parse_reference, manifest_text, 0);
+
+	/* make sure the sample exercises both parsers */
+	g_assert_nonnull (strstr (expected, "aaa_base-15.0-x86_64-3|usr/bin/with spaces and \ttab\n"));
+	g_assert_nonnull (strstr (expected, "tabbed-1.0-x86_64-1|no/newline/at/end\n"));
+	g_assert_null (strstr (expected, "install/"));
+	g_assert_null (strstr (expected, "not/in/a/package"));
+
+	for (gsize chunk : { (gsize) 1, (gsize) 2, (gsize) 7, (gsize) 64, (gsize) 8192 })
+	{
+		gchar *rows = dump_file_list (parse_chunked, manifest_text, chunk);
+		g_assert_cmpstr (rows, ==, expected);
+		g_free (rows);
+	}
+
+	g_free (expected);
+}
+
 static void
 slack_test_slackpkg_construct()
 {
@@ -20,6 +195,7 @@ int main(int argc, char *argv[])
 	g_test_init(&argc, &argv, NULL);
 
 	g_test_add_func("/slack/slackpkg/construct", slack_test_slackpkg_construct);
+	g_test_add_func("/slack/slackpkg/manifest", slack_test_slackpkg_manifest);
 
 	return g_test_run();
 }
@@ -0,0 +1,326 @@
+#include <glib/gstdio.h>
+#include <sqlite3.h>
+#include <string.h>
+#include "utils.h"
+
+using namespace slack;
+
+static const gchar *schema =
+	"CREATE TABLE repos (repo_order INTEGER PRIMARY KEY AUTOINCREMENT,repo VARCHAR NOT NULL);"
+	"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE,name VARCHAR NOT NULL,"
+	"ver VARCHAR NOT NULL,arch VARCHAR DEFAULT NULL,ext VARCHAR DEFAULT NULL,"
+	"repo_order INTEGER REFERENCES repos(repo_order) ON DELETE CASCADE,"
+	"PRIMARY KEY (name, repo_order));"
+	"INSERT INTO repos VALUES (1, 'slackware'), (2, 'extra'), (3, 'testing');"
+	"INSERT INTO pkglist VALUES ('mc-4.8-x86_64-1', 'mc', '4.8', 'x86_64', 'txz', 2);"
+	"INSERT INTO pkglist VALUES ('mc-4.9-x86_64-1', 'mc', '4.9', 'x86_64', 'txz', 3);"
+	"INSERT INTO pkglist VALUES ('vim-9.0-x86_64-1', 'vim', '9.0', 'x86_64', 'txz', 1);"
+	"INSERT INTO pkglist VALUES ('vim-9.1-x86_64-1', 'vim', '9.1', 'x86_64', 'txz', 3);";
+
+static const gchar *candidate_query =
+	"SELECT p.full_name FROM best_candidates AS b "
+	"JOIN pkglist AS p ON p.name = b.name AND p.repo_order = b.repo_order "
+	"WHERE b.name = @name";
+
+static sqlite3 *
+create_db ()
+{
+	sqlite3 *db;
+
+	g_assert_cmpint (sqlite3_open (":memory:", &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db, schema, NULL, NULL, NULL), ==, SQLITE_OK);
+
+	return db;
+}
+
+static void
+assert_candidate (JobData *job_data, const gchar *name, const gchar *full_name)
+{
+	sqlite3_stmt *stmt = prepare_statement (job_data, candidate_query);
+
+	g_assert_nonnull (stmt);
+	sqlite3_bind_text (stmt, 1, name, -1, SQLITE_TRANSIENT);
+	if (full_name)
+	{
+		g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_ROW);
+		g_assert_cmpstr ((const gchar *) sqlite3_column_text (stmt, 0), ==, full_name);
+	}
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_DONE);
+	sqlite3_reset (stmt);
+}
+
+static void
+slack_test_utils_best_candidates ()
+{
+	JobData job_data = {};
+
+	job_data.db = create_db ();
+	job_data.statements = statement_cache_new ();
+
+	g_assert_true (best_candidates_create (job_data.db));
+	assert_candidate (&job_data, "mc", "mc-4.8-x86_64-1");
+	assert_candidate (&job_data, "vim", "vim-9.0-x86_64-1");
+	assert_candidate (&job_data, "emacs", NULL);
+
+	/* The table is only updated on rebuild */
+	sqlite3_exec (job_data.db, "DELETE FROM pkglist WHERE repo_order = 2", NULL, NULL, NULL);
+	g_assert_true (best_candidates_create (job_data.db));
+	assert_candidate (&job_data, "mc", NULL);
+	best_candidates_rebuild (job_data.db);
+	assert_candidate (&job_data, "mc", "mc-4.9-x86_64-1");
+
+	g_hash_table_destroy (job_data.statements);
+	sqlite3_close (job_data.db);
+}
+
+static void
+slack_test_utils_prepare_statement ()
+{
+	JobData job_data = {};
+	sqlite3_stmt *stmt;
+
+	job_data.db = create_db ();
+	job_data.statements = statement_cache_new ();
+
+	stmt = prepare_statement (&job_data, "SELECT ver FROM pkglist WHERE name = @name ORDER BY ver");
+	g_assert_nonnull (stmt);
+	sqlite3_bind_text (stmt, 1, "vim", -1, SQLITE_TRANSIENT);
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_ROW);
+	g_assert_cmpstr ((const gchar *) sqlite3_column_text (stmt, 0), ==, "9.0");
+
+	/* The same statement comes back reset and without bindings */
+	g_assert_true (prepare_statement (&job_data,
+				"SELECT ver FROM pkglist WHERE name = @name ORDER BY ver") == stmt);
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_DONE);
+
+	g_assert_null (prepare_statement (&job_data, "SELECT nothing FROM nowhere"));
+	g_assert_cmpuint (g_hash_table_size (job_data.statements), ==, 1);
+
+	g_hash_table_destroy (job_data.statements);
+	sqlite3_close (job_data.db);
+}
+
+/*
+ * The lookup as it was done before the index, reading the whole metadata
+ * directory for every package.
+ */
+static PkInfoEnum
+scan_installed (const gchar *metadata_dir, const gchar *pkg_fullname)
+{
+	GFileEnumerator *pkg_metadata_enumerator;
+	GFileInfo *pkg_metadata_file_info;
+	GFile *pkg_metadata_dir;
+	PkInfoEnum ret = PK_INFO_ENUM_INSTALLING;
+	const gchar *it;
+	guint8 dashes = 0;
+	ptrdiff_t pkg_name;
+
+	for (it = pkg_fullname + strlen (pkg_fullname); it != pkg_fullname; --it)
+	{
+		if (*it == '-')
+		{
+			if (dashes == 2)
+			{
+				break;
+			}
+			++dashes;
+		}
+	}
+	if (dashes < 2)
+	{
+		return PK_INFO_ENUM_UNKNOWN;
+	}
+	pkg_name = it - pkg_fullname;
+
+	pkg_metadata_dir = g_file_new_for_path (metadata_dir);
+	if (!(pkg_metadata_enumerator = g_file_enumerate_children (pkg_metadata_dir,
+					"standard::name", G_FILE_QUERY_INFO_NONE, NULL, NULL)))
+	{
+		g_object_unref (pkg_metadata_dir);
+		return PK_INFO_ENUM_UNKNOWN;
+	}
+
+	while ((pkg_metadata_file_info = g_file_enumerator_next_file (pkg_metadata_enumerator, NULL, NULL)))
+	{
+		const gchar *dir = g_file_info_get_name (pkg_metadata_file_info);
+		dashes = 0;
+
+		if (strcmp (dir, pkg_fullname) == 0)
+		{
+			ret = PK_INFO_ENUM_INSTALLED;
+		}
+		else
+		{
+			for (it = dir + strlen (dir); it != dir; --it)
+			{
+				if (*it == '-')
+				{
+					if (dashes == 2)
+					{
+						break;
+					}
+					++dashes;
+				}
+			}
+			if (pkg_name == (it - dir) && strncmp (pkg_fullname, dir, pkg_name) == 0)
+			{
+				ret = PK_INFO_ENUM_UPDATING;
+			}
+		}
+		g_object_unref (pkg_metadata_file_info);
+
+		if (ret != PK_INFO_ENUM_INSTALLING)
+		{
+			break;
+		}
+	}
+	g_object_unref (pkg_metadata_enumerator);
+	g_object_unref (pkg_metadata_dir);
+
+	return ret;
+}
+
+/*
+ * Create a synthetic /var/log/packages with @n_installed packages, and a
+ * list of @n_queries full names of which some are installed, some are
+ * other versions of installed packages and some are not installed at all.
+ */
+static gchar *
+create_packages_dir (guint n_installed, guint n_queries, GPtrArray *queries)
+{
+	gchar *metadata_dir = g_dir_make_tmp ("pk-slack-packages-XXXXXX", NULL);
+	GRand *rand = g_rand_new_with_seed (42);
+
+	g_assert_nonnull (metadata_dir);
+	for (guint i = 0; i < n_installed; i++)
+	{
+		gchar *full_name = g_strdup_printf ("lib%u-extra-%u.%u-x86_64-1",
+				i, g_rand_int_range (rand, 0, 3), g_rand_int_range (rand, 0, 3));
+		gchar *filename = g_build_filename (metadata_dir, full_name, NULL);
+
+		g_assert_true (g_file_set_contents (filename, "", 0, NULL));
+		g_free (filename);
+		g_free (full_name);
+	}
+
+	for (guint i = 0; i < n_queries; i++)
+	{
+		g_ptr_array_add (queries, g_strdup_printf ("lib%u-extra-%u.%u-x86_64-1",
+					g_rand_int_range (rand, 0, n_installed * 4 / 3 + 1),
+					g_rand_int_range (rand, 0, 3), g_rand_int_range (rand, 0, 3)));
+	}
+	g_ptr_array_add (queries, g_strdup ("lib0-1.0"));
+	g_ptr_array_add (queries, g_strdup ("lib0-1.0-x86_64"));
+	g_rand_free (rand);
+
+	return metadata_dir;
+}
+
+static void
+remove_packages_dir (gchar *metadata_dir)
+{
+	const gchar *name;
+	GDir *dir = g_dir_open (metadata_dir, 0, NULL);
+
+	while ((name = g_dir_read_name (dir)))
+	{
+		gchar *filename = g_build_filename (metadata_dir, name, NULL);
+		g_unlink (filename);
+		g_free (filename);
+	}
+	g_dir_close (dir);
+	g_rmdir (metadata_dir);
+	g_free (metadata_dir);
+}
+
+/*
+ * Look up every query with the index and with a scan of the directory and
+ * compare the results.
+ */
+static void
+compare_installed (guint n_installed, guint n_queries)
+{
+	GPtrArray *queries = g_ptr_array_new_with_free_func (g_free);
+	gchar *metadata_dir = create_packages_dir (n_installed, n_queries, queries);
+	InstalledIndex *index = new InstalledIndex (metadata_dir);
+	GArray *scanned = g_array_sized_new (FALSE, FALSE, sizeof (PkInfoEnum), queries->len);
+	guint counts[PK_INFO_ENUM_LAST] = {};
+	gdouble scan_time, index_time;
+	GTimer *timer = g_timer_new ();
+
+	g_timer_start (timer);
+	for (guint i = 0; i < queries->len; i++)
+	{
+		PkInfoEnum info = scan_installed (metadata_dir,
+				static_cast<const gchar *> (g_ptr_array_index (queries, i)));
+		g_array_append_val (scanned, info);
+	}
+	scan_time = g_timer_elapsed (timer, NULL);
+
+	g_timer_start (timer);
+	for (guint i = 0; i < queries->len; i++)
+	{
+		PkInfoEnum info = index->lookup (static_cast<const gchar *> (g_ptr_array_index (queries, i)));
+
+		g_assert_cmpint (info, ==, g_array_index (scanned, PkInfoEnum, i));
+		counts[info]++;
+	}
+	index_time = g_timer_elapsed (timer, NULL);
+
+	/* All kinds of results are covered */
+	g_assert_cmpuint (counts[PK_INFO_ENUM_INSTALLED], >, 0);
+	g_assert_cmpuint (counts[PK_INFO_ENUM_UPDATING], >, 0);
+	g_assert_cmpuint (counts[PK_INFO_ENUM_INSTALLING], >, 0);
+	g_assert_cmpuint (counts[PK_INFO_ENUM_UNKNOWN], ==, 1);
+	g_assert_cmpuint (index->get_full_names ()->len, ==, n_installed);
+
+	if (g_test_perf ())
+	{
+		g_test_message ("%u lookups in %u installed packages: scan %.2f ms, index %.2f ms",
+				queries->len, n_installed, scan_time * 1000, index_time * 1000);
+	}
+
+	g_timer_destroy (timer);
+	g_array_unref (scanned);
+	delete index;
+	remove_packages_dir (metadata_dir);
+	g_ptr_array_unref (queries);
+}
+
+static void
+slack_test_utils_installed_index ()
+{
+	InstalledIndex missing ("/nonexistent/pk-slack-packages");
+	GError *error = NULL;
+
+	compare_installed (300, 200);
+
+	/* The directory can't be read */
+	g_assert_cmpint (missing.lookup ("mc-4.8-x86_64-1"), ==, PK_INFO_ENUM_UNKNOWN);
+	g_assert_false (missing.load (&error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_cmpuint (missing.get_full_names ()->len, ==, 0);
+	g_error_free (error);
+}
+
+static void
+slack_test_utils_installed_index_bench ()
+{
+	compare_installed (1500, 2000);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/slack/utils/best_candidates", slack_test_utils_best_candidates);
+	g_test_add_func ("/slack/utils/prepare_statement", slack_test_utils_prepare_statement);
+	g_test_add_func ("/slack/utils/installed_index", slack_test_utils_installed_index);
+	if (g_test_perf ())
+	{
+		g_test_add_func ("/slack/utils/installed_index/bench", slack_test_utils_installed_index_bench);
+	}
+
+	return g_test_run ();
+}
@@ -118,103 +118,446 @@ split_package_name (const gchar *pkg_filename)
 	return pkg_tokens;
 }
 
+/*
+ * Length of the package name in a full name like name-version-arch-build,
+ * @dashes is set to the number of dashes found after the name.
+ */
+static gsize
+get_name_length (const gchar *pkg_fullname, guint8 *dashes)
+{
+	const gchar *it;
+
+	*dashes = 0;
+	for (it = pkg_fullname + strlen(pkg_fullname); it != pkg_fullname; --it)
+	{
+		if (*it == '-')
+		{
+			if (*dashes == 2)
+			{
+				break;
+			}
+			++*dashes;
+		}
+	}
+	return it - pkg_fullname;
+}
+
+InstalledIndex::InstalledIndex (const gchar *metadata_dir) noexcept
+: metadata_dir(g_strdup(metadata_dir)),
+  full_names(g_ptr_array_new_with_free_func(g_free)),
+  installed(g_hash_table_new(g_str_hash, g_str_equal)),
+  names(g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL))
+{
+}
+
+InstalledIndex::~InstalledIndex () noexcept
+{
+	g_hash_table_destroy(this->names);
+	g_hash_table_destroy(this->installed);
+	g_ptr_array_unref(this->full_names);
+	g_clear_error(&this->error);
+	g_free(this->metadata_dir);
+}
+
 /**
- * slack::is_installed:
- * Checks if a package is already installed in the system.
+ * slack::InstalledIndex::load:
+ * @error: a #GError or %NULL.
  *
- * Params:
- * 	pkg_fullname = Package name should be looked for.
+ * Read the package metadata directory if it wasn't read yet. Later changes
+ * to the directory are not seen, so an index should only live as long as
+ * a job.
  *
- * Returns: PK_INFO_ENUM_INSTALLING if pkg_fullname is already installed,
- *          PK_INFO_ENUM_UPDATING if an elder version of pkg_fullname is
- *          installed, PK_INFO_ENUM_UNKNOWN if pkg_fullname is malformed.
+ * Returns: %TRUE if the directory could be read, %FALSE otherwise.
  **/
-PkInfoEnum
-is_installed (const gchar *pkg_fullname)
+gboolean
+InstalledIndex::load (GError **error) noexcept
 {
 	GFileEnumerator *pkg_metadata_enumerator;
 	GFileInfo *pkg_metadata_file_info;
 	GFile *pkg_metadata_dir;
-	PkInfoEnum ret = PK_INFO_ENUM_INSTALLING;
-    const gchar *it;
-    guint8 dashes = 0;
-	ptrdiff_t pkg_name;
+
+	if (!this->loaded)
+	{
+		this->loaded = TRUE;
+
+		pkg_metadata_dir = g_file_new_for_path(this->metadata_dir);
+		pkg_metadata_enumerator = g_file_enumerate_children(pkg_metadata_dir,
+		                                                    "standard::name",
+		                                                    G_FILE_QUERY_INFO_NONE,
+		                                                    NULL,
+		                                                    &this->error);
+		g_object_unref(pkg_metadata_dir);
+
+		while (pkg_metadata_enumerator
+		    && (pkg_metadata_file_info = g_file_enumerator_next_file(pkg_metadata_enumerator, NULL, NULL)))
+		{
+			gchar *full_name = g_strdup(g_file_info_get_name(pkg_metadata_file_info));
+			guint8 dashes;
+			gsize name_length = get_name_length(full_name, &dashes);
+
+			g_ptr_array_add(this->full_names, full_name);
+			g_hash_table_add(this->installed, full_name);
+			g_hash_table_insert(this->names, g_strndup(full_name, name_length), full_name);
+
+			g_object_unref(pkg_metadata_file_info);
+		}
+		if (pkg_metadata_enumerator)
+		{
+			g_object_unref(pkg_metadata_enumerator);
+		}
+	}
+
+	if (this->error)
+	{
+		if (error)
+		{
+			*error = g_error_copy(this->error);
+		}
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * slack::InstalledIndex::lookup:
+ * @pkg_fullname: Package name should be looked for.
+ *
+ * Checks if a package is already installed in the system.
+ *
+ * Returns: PK_INFO_ENUM_INSTALLED if pkg_fullname is already installed,
+ *          PK_INFO_ENUM_UPDATING if another version of pkg_fullname is
+ *          installed, PK_INFO_ENUM_INSTALLING if it isn't installed and
+ *          PK_INFO_ENUM_UNKNOWN if pkg_fullname is malformed or the
+ *          installed packages can't be read.
+ **/
+PkInfoEnum
+InstalledIndex::lookup (const gchar *pkg_fullname) noexcept
+{
+	guint8 dashes;
+	gsize name_length;
+	gchar *name;
+	PkInfoEnum ret;
 
 	g_return_val_if_fail(pkg_fullname != NULL, PK_INFO_ENUM_UNKNOWN);
 
-    // We want to find the package name without version for the package we're
-    // looking for.
-    g_debug("Looking if %s is installed", pkg_fullname);
-
-    for (it = pkg_fullname + strlen(pkg_fullname); it != pkg_fullname; --it)
-    {
-        if (*it == '-')
-        {
-            if (dashes == 2)
-            {
-                break;
-            }
-            ++dashes;
-        }
-    }
-	if (dashes < 2)
+	name_length = get_name_length(pkg_fullname, &dashes);
+	if (dashes < 2 || !this->load (NULL))
 	{
 		return PK_INFO_ENUM_UNKNOWN;
 	}
-    pkg_name = it - pkg_fullname;
 
-	// Read the package metadata directory and comprare all installed packages
-    // with ones in the cache.
-	pkg_metadata_dir = g_file_new_for_path("/var/log/packages");
-	if (!(pkg_metadata_enumerator = g_file_enumerate_children(pkg_metadata_dir,
-	                                                          "standard::name",
-	                                                          G_FILE_QUERY_INFO_NONE,
-	                                                          NULL,
-	                                                          NULL)))
+	if (g_hash_table_contains(this->installed, pkg_fullname))
 	{
-		g_object_unref(pkg_metadata_dir);
-		return PK_INFO_ENUM_UNKNOWN;
+		return PK_INFO_ENUM_INSTALLED;
 	}
+	name = g_strndup(pkg_fullname, name_length);
+	ret = g_hash_table_contains(this->names, name) ? PK_INFO_ENUM_UPDATING : PK_INFO_ENUM_INSTALLING;
+	g_free(name);
+
+	return ret;
+}
+
+/**
+ * slack::InstalledIndex::get_full_names:
+ *
+ * Returns: (transfer none): The full names of all installed packages, empty
+ *          if they can't be read.
+ **/
+GPtrArray *
+InstalledIndex::get_full_names () noexcept
+{
+	this->load (NULL);
+
+	return this->full_names;
+}
 
-	while ((pkg_metadata_file_info = g_file_enumerator_next_file(pkg_metadata_enumerator, NULL, NULL)))
+/**
+ * slack::is_installed:
+ * @job_data: job data with the index of the installed packages.
+ * @pkg_fullname: Package name should be looked for.
+ *
+ * Checks if a package is already installed in the system, see
+ * slack::InstalledIndex::lookup().
+ **/
+PkInfoEnum
+is_installed (JobData *job_data, const gchar *pkg_fullname)
+{
+	return job_data->installed->lookup (pkg_fullname);
+}
+
+/**
+ * slack::search_index_create:
+ * @db: metadata database.
+ *
+ * Create the trigram indexes over the package names, descriptions and file
+ * lists if they do not exist yet, and fill them from the current cache. The
+ * indexes are only refilled after a refresh, so triggers on pkglist and
+ * filelist bump a generation on every change and the indexes are ignored
+ * until slack::search_index_rebuild() has caught up with it.
+ *
+ * Returns: %TRUE if the indexes can be used, %FALSE if SQLite was built
+ *          without FTS5 or the trigram tokenizer.
+ **/
+gboolean
+search_index_create (sqlite3 *db)
+{
+	gchar *db_err = NULL;
+	sqlite3_stmt *stmt;
+	gboolean exists = FALSE;
+
+	if (sqlite3_prepare_v2(db,
+	                       "SELECT 1 FROM sqlite_master WHERE name = 'search_index_state'",
+	                       -1,
+	                       &stmt,
+	                       NULL) == SQLITE_OK)
 	{
-		const gchar *dir = g_file_info_get_name(pkg_metadata_file_info);
-        dashes = 0;
+		exists = sqlite3_step(stmt) == SQLITE_ROW;
+		sqlite3_finalize(stmt);
+	}
+	if (exists)
+	{
+		return TRUE;
+	}
 
-        if (strcmp(dir, pkg_fullname) == 0)
-        {
-            ret = PK_INFO_ENUM_INSTALLED;
-        }
-		else
-		{
-			for (it = dir + strlen(dir); it != dir; --it)
-			{
-				if (*it == '-')
-				{
-					if (dashes == 2)
-					{
-						break;
-					}
-					++dashes;
-				}
-			}
-			if (pkg_name == (it - dir) && strncmp(pkg_fullname, dir, pkg_name) == 0)
-			{
-				ret = PK_INFO_ENUM_UPDATING;
-			}
+	if (sqlite3_exec(db,
+	                 "BEGIN TRANSACTION;"
+	                 "CREATE VIRTUAL TABLE IF NOT EXISTS pkglist_fts USING fts5(name, desc, "
+	                 "full_name UNINDEXED, tokenize='trigram');"
+	                 "CREATE VIRTUAL TABLE IF NOT EXISTS filelist_fts USING fts5(filename, "
+	                 "full_name UNINDEXED, tokenize='trigram');"
+	                 "CREATE TABLE search_index_state (generation INTEGER NOT NULL, "
+	                 "indexed INTEGER NOT NULL);"
+	                 "INSERT INTO search_index_state VALUES (1, 0);"
+	                 "CREATE TRIGGER pkglist_insert_stale AFTER INSERT ON pkglist BEGIN "
+	                 "UPDATE search_index_state SET generation = generation + 1 "
+	                 "WHERE generation = indexed; END;"
+	                 "CREATE TRIGGER pkglist_update_stale AFTER UPDATE ON pkglist BEGIN "
+	                 "UPDATE search_index_state SET generation = generation + 1 "
+	                 "WHERE generation = indexed; END;"
+	                 "CREATE TRIGGER pkglist_delete_stale AFTER DELETE ON pkglist BEGIN "
+	                 "UPDATE search_index_state SET generation = generation + 1 "
+	                 "WHERE generation = indexed; END;"
+	                 "CREATE TRIGGER filelist_insert_stale AFTER INSERT ON filelist BEGIN "
+	                 "UPDATE search_index_state SET generation = generation + 1 "
+	                 "WHERE generation = indexed; END;"
+	                 "CREATE TRIGGER filelist_update_stale AFTER UPDATE ON filelist BEGIN "
+	                 "UPDATE search_index_state SET generation = generation + 1 "
+	                 "WHERE generation = indexed; END;"
+	                 "CREATE TRIGGER filelist_delete_stale AFTER DELETE ON filelist BEGIN "
+	                 "UPDATE search_index_state SET generation = generation + 1 "
+	                 "WHERE generation = indexed; END;"
+	                 "COMMIT",
+	                 NULL,
+	                 NULL,
+	                 &db_err) != SQLITE_OK)
+	{
+		g_warning("Cannot create the search index: %s", db_err);
+		sqlite3_free(db_err);
+		sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+		return FALSE;
+	}
+	search_index_rebuild (db);
 
-		}
-		g_object_unref(pkg_metadata_file_info);
+	return TRUE;
+}
 
-		if (ret != PK_INFO_ENUM_INSTALLING) /* If installed */
+/**
+ * slack::search_index_rebuild:
+ * @db: metadata database.
+ *
+ * Refill the trigram indexes after the cache has been regenerated and mark
+ * them current.
+ **/
+void
+search_index_rebuild (sqlite3 *db)
+{
+	gchar *db_err = NULL;
+
+	if (sqlite3_exec(db,
+	                 "BEGIN TRANSACTION;"
+	                 "DELETE FROM pkglist_fts;"
+	                 "INSERT INTO pkglist_fts (name, desc, full_name) "
+	                 "SELECT name, desc, full_name FROM pkglist;"
+	                 "DELETE FROM filelist_fts;"
+	                 "INSERT INTO filelist_fts (filename, full_name) "
+	                 "SELECT filename, full_name FROM filelist;"
+	                 "UPDATE search_index_state SET indexed = generation;"
+	                 "COMMIT",
+	                 NULL,
+	                 NULL,
+	                 &db_err) != SQLITE_OK)
+	{
+		g_warning("Cannot rebuild the search index: %s", db_err);
+		sqlite3_free(db_err);
+		sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+	}
+}
+
+/**
+ * slack::search_index_usable:
+ * @db: metadata database.
+ * @terms: search terms.
+ *
+ * The indexes are authoritative for the rows they find, so they are only
+ * used if nothing in pkglist or filelist changed since the last rebuild, for
+ * example because a refresh stopped half way. A trigram index can only narrow
+ * down the rows for terms of at least three characters, shorter terms are
+ * faster to match with a plain table scan.
+ *
+ * Returns: %TRUE if the search should go through the trigram indexes.
+ **/
+gboolean
+search_index_usable (sqlite3 *db, gchar **terms)
+{
+	sqlite3_stmt *stmt;
+	gboolean current = FALSE;
+
+	if (terms[0] == NULL)
+	{
+		return FALSE;
+	}
+	for (gchar **term = terms; *term; term++)
+	{
+		if (g_utf8_strlen(*term, -1) < 3)
 		{
-			break;
+			return FALSE;
 		}
 	}
-	g_object_unref(pkg_metadata_enumerator);
-	g_object_unref(pkg_metadata_dir);
 
-	return ret;
+	if (sqlite3_prepare_v2(db,
+	                       "SELECT generation = indexed FROM search_index_state",
+	                       -1,
+	                       &stmt,
+	                       NULL) == SQLITE_OK)
+	{
+		current = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0);
+		sqlite3_finalize(stmt);
+	}
+	return current;
+}
+
+/**
+ * slack::best_candidates_create:
+ * @db: metadata database.
+ *
+ * Several repositories can provide a package with the same name, only the one
+ * from the repository with the lowest order is offered. best_candidates holds
+ * that repository for every name, so queries can join it instead of looking
+ * for the minimum for each row. The table is created and filled if it
+ * doesn't exist yet.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+best_candidates_create (sqlite3 *db)
+{
+	gchar *db_err = NULL;
+	sqlite3_stmt *stmt;
+	gboolean exists = FALSE;
+
+	if (sqlite3_prepare_v2(db,
+	                       "SELECT 1 FROM sqlite_master WHERE name = 'best_candidates'",
+	                       -1,
+	                       &stmt,
+	                       NULL) == SQLITE_OK)
+	{
+		exists = sqlite3_step(stmt) == SQLITE_ROW;
+		sqlite3_finalize(stmt);
+	}
+	if (exists)
+	{
+		return TRUE;
+	}
+
+	if (sqlite3_exec(db,
+	                 "CREATE TABLE best_candidates (name VARCHAR PRIMARY KEY, "
+	                 "repo_order INTEGER NOT NULL) WITHOUT ROWID",
+	                 NULL,
+	                 NULL,
+	                 &db_err) != SQLITE_OK)
+	{
+		g_warning("Cannot create the candidate table: %s", db_err);
+		sqlite3_free(db_err);
+		return FALSE;
+	}
+	best_candidates_rebuild (db);
+
+	return TRUE;
+}
+
+/**
+ * slack::best_candidates_rebuild:
+ * @db: metadata database.
+ *
+ * Refill the candidate table after the cache has been regenerated.
+ **/
+void
+best_candidates_rebuild (sqlite3 *db)
+{
+	gchar *db_err = NULL;
+
+	if (sqlite3_exec(db,
+	                 "BEGIN TRANSACTION;"
+	                 "DELETE FROM best_candidates;"
+	                 "INSERT INTO best_candidates (name, repo_order) "
+	                 "SELECT name, MIN(repo_order) FROM pkglist GROUP BY name;"
+	                 "COMMIT",
+	                 NULL,
+	                 NULL,
+	                 &db_err) != SQLITE_OK)
+	{
+		g_warning("Cannot rebuild the candidate table: %s", db_err);
+		sqlite3_free(db_err);
+		sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+	}
+}
+
+/**
+ * slack::statement_cache_new:
+ *
+ * Returns: A table for prepare_statement(), the statements are finalized
+ *          when it is destroyed.
+ **/
+GHashTable *
+statement_cache_new ()
+{
+	return g_hash_table_new_full(g_str_hash,
+			g_str_equal,
+			g_free,
+			(GDestroyNotify) sqlite3_finalize);
+}
+
+/**
+ * slack::prepare_statement:
+ * @job_data: job data.
+ * @sql: SQL statement.
+ *
+ * Statements are kept until the job ends, so a query run for every package
+ * is compiled only once. The statement is returned reset and without
+ * bindings. It must not be finalized, but should be reset when the caller is
+ * done with it.
+ *
+ * Returns: The prepared statement, %NULL on error.
+ **/
+sqlite3_stmt *
+prepare_statement (JobData *job_data, const gchar *sql)
+{
+	auto stmt = static_cast<sqlite3_stmt *> (g_hash_table_lookup(job_data->statements, sql));
+
+	if (stmt)
+	{
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+		return stmt;
+	}
+	if (sqlite3_prepare_v2(job_data->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+	{
+		sqlite3_finalize(stmt);
+		return NULL;
+	}
+	g_hash_table_insert(job_data->statements, g_strdup(sql), stmt);
+
+	return stmt;
 }
 
 /**
@@ -2,24 +2,59 @@
 #define __SLACK_UTILS_H
 
 #include <curl/curl.h>
+#include <sqlite3.h>
 #include <pk-backend.h>
 #include <pk-backend-job.h>
 
 namespace slack {
 
+/*
+ * Maps the names of the installed packages to their full names. The package
+ * metadata directory is read once, the first time the index is used.
+ */
+class InstalledIndex final
+{
+public:
+	explicit InstalledIndex (const gchar *metadata_dir = "/var/log/packages") noexcept;
+	~InstalledIndex () noexcept;
+
+	gboolean load (GError **error) noexcept;
+	PkInfoEnum lookup (const gchar *pkg_fullname) noexcept;
+	GPtrArray *get_full_names () noexcept;
+
+private:
+	gchar *metadata_dir;
+	gboolean loaded = FALSE;
+	GError *error = NULL;
+	GPtrArray *full_names;
+	GHashTable *installed;
+	GHashTable *names;
+};
+
 struct JobData
 {
 	GObjectClass parent_class;
 
 	sqlite3 *db;
-	CURL *curl;
+	GHashTable *statements;
+	InstalledIndex *installed;
 };
 
 CURLcode get_file (CURL **curl, gchar *source_url, gchar *dest);
 
 gchar **split_package_name (const gchar *pkg_filename);
 
-PkInfoEnum is_installed (const gchar *pkg_fullname);
+PkInfoEnum is_installed (JobData *job_data, const gchar *pkg_fullname);
+
+gboolean search_index_create (sqlite3 *db);
+void search_index_rebuild (sqlite3 *db);
+gboolean search_index_usable (sqlite3 *db, gchar **terms);
+
+gboolean best_candidates_create (sqlite3 *db);
+void best_candidates_rebuild (sqlite3 *db);
+
+GHashTable *statement_cache_new ();
+sqlite3_stmt *prepare_statement (JobData *job_data, const gchar *sql);
 
 extern "C" {
 
@@ -25,6 +25,9 @@
 
 #include "config.h"
 
+#include <atomic>
+#include <dirent.h>
+#include <fcntl.h>
 #include <iterator>
 #include <list>
 #include <map>
@@ -35,11 +38,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/vfs.h>
 #include <unistd.h>
 #include <vector>
 #include <utime.h>
 
+#include <curl/curl.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
@@ -52,6 +60,7 @@
 #include <zypp/Digest.h>
 #include <zypp/KeyRing.h>
 #include <zypp/Package.h>
+#include <zypp/PackageDelta.h>
 #include <zypp/Patch.h>
 #include <zypp/PathInfo.h>
 #include <zypp/Pathname.h>
@@ -79,14 +88,19 @@
 #include <zypp/base/Logger.h>
 #include <zypp/base/String.h>
 #include <zypp/media/MediaException.h>
+#include <zypp/media/UrlResolverPlugin.h>
 #include <zypp/parser/IniDict.h>
 #include <zypp/parser/ParseException.h>
 #include <zypp/parser/ProductFileReader.h>
+#include <zypp/repo/Applydeltarpm.h>
+#include <zypp/repo/DeltaCandidates.h>
 #include <zypp/repo/PackageProvider.h>
 #include <zypp/repo/RepoException.h>
 #include <zypp/repo/SrcPackageProvider.h>
+#include <zypp/sat/LookupAttr.h>
 #include <zypp/sat/Pool.h>
 #include <zypp/sat/Solvable.h>
+#include <zypp/sat/Transaction.h>
 #include <zypp/target/rpm/RpmDb.h>
 #include <zypp/target/rpm/RpmException.h>
 #include <zypp/target/rpm/RpmHeader.h>
@@ -192,6 +206,9 @@ guint _dl_count = 0;
 guint _dl_progress = 0;
 guint _dl_status = 0;
 
+/* Preloads the pool when the daemon starts, see zypp_warm_up_thread() */
+static GThread *_warm_up_thread = NULL;
+
 static const zypp::filesystem::Pathname REGULAR_CACHE_PATH("/home/.zypp-cache");
 static const zypp::filesystem::Pathname DIST_UPGRADE_CACHE_PATH("/home/.pk-zypp-dist-upgrade-cache");
 
@@ -200,6 +217,26 @@ static void
 zypp_backend_finished_error (PkBackendJob  *job, PkErrorEnum err_code,
 			     const char *format, ...);
 
+/* The cache status of each repository in the pool when it was loaded,
+ * by alias. Both cache directories often hold the same solv file for a
+ * repository, which then does not need to be reloaded on a switch.
+ */
+static std::map<std::string, std::string> _loaded_repos;
+
+/**
+ * Load a repository from the cache on disk, remembering which cache
+ * status it was loaded with.
+ **/
+static void
+zypp_load_repo_from_cache (RepoManager &manager, const RepoInfo &repoInfo)
+{
+	RepoStatus status = manager.cacheStatus (repoInfo);
+
+	_loaded_repos.erase (repoInfo.alias ());
+	manager.loadFromCache (repoInfo);
+	_loaded_repos[repoInfo.alias ()] = status.checksum ();
+}
+
 static void
 zypp_reset_pool () // may throw a ZYppFactoryException
 {
@@ -210,18 +247,32 @@ zypp_reset_pool () // may throw a ZYppFactoryException
 
 	RepoManager manager;
 
-	// iterate over all known repositories and reload them from the cache on disk
+	// iterate over all known repositories and reload them from the cache on
+	// disk, unless the pool already holds the very same data
 	for (RepoManager::RepoConstIterator it = manager.repoBegin(); it != manager.repoEnd(); ++it) {
 		RepoInfo repoInfo (*it);
-		LOG << "Reloading repository " << repoInfo.alias () << " from disk cache" << std::endl;
 		Repository repo = sat::Pool::instance().reposFind(repoInfo.alias ());
+		bool cached = manager.isCached(repoInfo);
+
+		if (cached && repo != Repository::noRepository) {
+			auto loaded = _loaded_repos.find (repoInfo.alias ());
+			RepoStatus status = manager.cacheStatus (repoInfo);
+			if (loaded != _loaded_repos.end () && !status.empty () &&
+			    loaded->second == status.checksum ()) {
+				LOG << "Keeping repository " << repoInfo.alias () << ", the disk cache is the same" << std::endl;
+				continue;
+			}
+		}
+
+		LOG << "Reloading repository " << repoInfo.alias () << " from disk cache" << std::endl;
 		// wipe all data we currently hold about that repository in the pool,
 		// because loadFromCache() will just add data
 		repo.eraseFromPool();
+		_loaded_repos.erase (repoInfo.alias ());
 
-		if (manager.isCached(repoInfo)) {
+		if (cached) {
 			try {
-				manager.loadFromCache(repoInfo);
+				zypp_load_repo_from_cache(manager, repoInfo);
 			} catch (const Exception &ex) {
 				ERR << "Failed to reload repository " << repoInfo.alias() << ": " << ex.asUserString() << std::endl;
 			}
@@ -366,10 +417,12 @@ zypp_build_package_id_from_resolvable (const sat::Solvable &resolvable, bool ext
 class ZyppBackendThreadWrapperData {
 public:
 	ZyppBackendThreadWrapperData(PkBackendJobThreadFunc func,
-			gpointer user_data, GDestroyNotify destroy_func)
+			gpointer user_data, GDestroyNotify destroy_func,
+			bool requires_dist_upgrade)
 		: func(func)
 		, user_data(user_data)
 		, destroy_func(destroy_func)
+		, requires_dist_upgrade(requires_dist_upgrade)
 	{
 	}
 
@@ -380,6 +433,7 @@ public:
 	PkBackendJobThreadFunc func;
 	gpointer user_data;
 	GDestroyNotify destroy_func;
+	bool requires_dist_upgrade;
 };
 
 static void
@@ -407,6 +461,23 @@ zypp_backend_job_thread_wrapper (PkBackendJob *job, GVariant *params,
 {
 	ZyppBackendThreadWrapperData *data = static_cast<ZyppBackendThreadWrapperData *>(user_data);
 
+	// the cache must not be switched under the pool being preloaded, so
+	// wait for it here rather than in the main loop; jobs never run in
+	// parallel, so nothing else touches _warm_up_thread meanwhile
+	if (data->requires_dist_upgrade) {
+		if (_warm_up_thread != NULL) {
+			g_thread_join (_warm_up_thread);
+			_warm_up_thread = NULL;
+		}
+		if (!zypp_set_custom_config (true)) {
+			zypp_backend_finished_error (job,
+					PK_ERROR_ENUM_NO_DISTRO_UPGRADE_DATA,
+					"Could not configure zypp cache.");
+			delete data;
+			return;
+		}
+	}
+
 	try {
 		// Call real thread function
 		data->func(job, params, data->user_data);
@@ -433,7 +504,8 @@ zypp_backend_job_thread_create (PkBackendJob *job, PkBackendJobThreadFunc func,
 		gpointer user_data, GDestroyNotify destroy_func,
 		bool requires_dist_upgrade=false)
 {
-	if (!zypp_set_custom_config (requires_dist_upgrade)) {
+	// dist upgrade jobs switch the cache in their thread
+	if (!requires_dist_upgrade && !zypp_set_custom_config (false)) {
 		zypp_backend_finished_error (job,
 				PK_ERROR_ENUM_NO_DISTRO_UPGRADE_DATA,
 				"Could not configure zypp cache.");
@@ -441,7 +513,7 @@ zypp_backend_job_thread_create (PkBackendJob *job, PkBackendJobThreadFunc func,
 	}
 
 	ZyppBackendThreadWrapperData *data = new ZyppBackendThreadWrapperData(func,
-			user_data, destroy_func);
+			user_data, destroy_func, requires_dist_upgrade);
 	return pk_backend_job_thread_create (job, zypp_backend_job_thread_wrapper,
 			data, destroy_func);
 }
@@ -467,6 +539,7 @@ bool currentJobIsCancelled();
 // FIXME: should merge with _dl_progress / _dl_count
 /* Overall progress update helpers */
 void zypp_backend_download_finished(PkBackendJob *job);
+void zypp_backend_delta_applied(PkBackendJob *job, const string &filename);
 void zypp_backend_installation_finished(PkBackendJob *job);
 void zypp_backend_removal_finished(PkBackendJob *job);
 
@@ -655,6 +728,8 @@ struct RepoReportReceiver : public zypp::callback::ReceiveReport<zypp::repo::Rep
 
 struct DownloadProgressReportReceiver : public zypp::callback::ReceiveReport<zypp::repo::DownloadResolvableReport>, ZyppBackendReceiver
 {
+	string _delta_filename;
+
 	virtual void start (zypp::Resolvable::constPtr resolvable, const zypp::Url &file)
 	{
 		MIL << resolvable << " " << file << std::endl;
@@ -689,6 +764,25 @@ struct DownloadProgressReportReceiver : public zypp::callback::ReceiveReport<zyp
 		return true;
 	}
 
+	virtual void startDeltaDownload (const zypp::Pathname &filename, const zypp::ByteCount &downloadsize)
+	{
+		MIL << filename << " " << downloadsize << std::endl;
+		_delta_filename = filename.basename ();
+	}
+
+	virtual void finishDeltaApply ()
+	{
+		// a package built from a delta is never start()ed or finish()ed
+		zypp_backend_delta_applied (_job, _delta_filename);
+		_delta_filename.clear ();
+	}
+
+	virtual void problemDeltaApply (const std::string &description)
+	{
+		MIL << _delta_filename << ": " << description << std::endl;
+		_delta_filename.clear ();
+	}
+
 	virtual void finish (zypp::Resolvable::constPtr resolvable, Error error, const std::string &konreason)
 	{
 		MIL << resolvable << " " << error << " " << _package_id << std::endl;
@@ -963,6 +1057,27 @@ struct ExecCounters {
 	int current_downloads;
 };
 
+/**
+ * The dependency solution of the last simulated transaction that carried a
+ * plan token. The real transaction with the same token applies it instead of
+ * running the resolver again, as long as the request is the same and neither
+ * the pool nor the rpmdb changed in between.
+ **/
+struct ResolvedPlan {
+	void clear()
+	{
+		token.clear();
+		request.clear();
+		generation.clear();
+		statuses.clear();
+	}
+
+	std::string token;
+	std::string request;
+	std::string generation;
+	std::vector<std::pair<sat::Solvable, ResStatus> > statuses;
+};
+
 class PkBackendZYppPrivate {
  public:
 	std::vector<std::string> signatures;
@@ -971,6 +1086,12 @@ class PkBackendZYppPrivate {
 	
 	pthread_mutex_t zypp_mutex;
 	ExecCounters exec;
+	ResolvedPlan plan;
+	guint prefetch_workers;
+
+	/* the package each expected delta rpm builds, by delta file name */
+	std::map<std::string, std::pair<sat::Solvable, int64_t> > deltas;
+	int64_t delta_savings;
 };
 
 bool currentJobIsCancelled()
@@ -998,6 +1119,25 @@ void zypp_backend_installation_finished(PkBackendJob *job)
 	priv->exec.update(job);
 }
 
+void zypp_backend_delta_applied(PkBackendJob *job, const string &filename)
+{
+	auto it = priv->deltas.find(filename);
+	if (it == priv->deltas.end())
+		return;
+
+	sat::Solvable solvable = it->second.first;
+	int64_t saved = (int64_t) make<ResObject>(solvable)->downloadSize() - it->second.second;
+	priv->delta_savings += MAX(0, saved);
+	// forget the delta, so callers can tell it was reported here
+	priv->deltas.erase(it);
+
+	gchar *package_id = zypp_build_package_id_from_resolvable(solvable);
+	pk_backend_job_package(job, PK_INFO_ENUM_DOWNLOADING, package_id,
+			       make<ResObject>(solvable)->summary().c_str());
+	g_free(package_id);
+	zypp_backend_download_finished(job);
+}
+
 void zypp_backend_removal_finished(PkBackendJob *job)
 {
 	priv->exec.setPhase(INSTALLING_AND_REMOVING_PACKAGES);
@@ -1085,14 +1225,16 @@ zypp_handle_broken_rpmdb (ZYpp::Ptr zypp, const Exception &e)
 	}
 }
 
+/* the cache directory the target was initialized for */
+static gboolean _target_initialized = FALSE;
+static std::string _target_root = "";
+
 /**
- * Initialize Zypp (Factory method)
+ * Get the ZYpp instance with an initialized target, may throw
  */
-ZYpp::Ptr
-ZyppJob::get_zypp()
+static ZYpp::Ptr
+zypp_get_instance ()
 {
-	static gboolean initialized = FALSE;
-	static std::string currentRoot = "";
 	ZYpp::Ptr zypp = NULL;
 
 	// Determine the real root path of the cache directory (possibly
@@ -1113,38 +1255,52 @@ ZyppJob::get_zypp()
 	}
 	free(cachePath);
 
-	try {
-		zypp = ZYppFactory::instance ().getZYpp ();
-
-		/* TODO: we need to lifecycle manage this, detect changes
-		   in the requested 'root' etc. */
-		if (targetRoot != currentRoot) {
-			if (initialized) {
-				LOG << "Switching target with hot pool: " << currentRoot << " -> " << targetRoot << std::endl;
-				zypp->finishTarget ();
-				zypp->pool().resolver().reset();
-				currentRoot = targetRoot;
-				initialized = false;
-			} else {
-				LOG << "Setting target on init: " << targetRoot << std::endl;
-				currentRoot = targetRoot;
-			}
+	zypp = ZYppFactory::instance ().getZYpp ();
+
+	/* TODO: we need to lifecycle manage this, detect changes
+	   in the requested 'root' etc. */
+	if (targetRoot != _target_root) {
+		if (_target_initialized) {
+			// both caches describe the same rpmdb, so the loaded
+			// target stays valid; the repositories were already
+			// swapped by zypp_reset_pool()
+			LOG << "Switching cache root with hot pool and target: " << _target_root << " -> " << targetRoot << std::endl;
+			zypp->pool().resolver().reset();
+			_target_root = targetRoot;
+		} else {
+			LOG << "Setting target on init: " << targetRoot << std::endl;
+			_target_root = targetRoot;
 		}
+	}
 
-		if (!initialized) {
-			try {
-				zypp::filesystem::Pathname pathname("/");
-				zypp->initializeTarget (pathname);
-			} catch (const Exception &e) {
-				// Try to recover from a broken RPM database
-				if (!zypp_handle_broken_rpmdb(zypp, e)) {
-					// Rethrow, so we report an internal error below
-					throw;
-				}
+	if (!_target_initialized) {
+		try {
+			zypp::filesystem::Pathname pathname("/");
+			zypp->initializeTarget (pathname);
+		} catch (const Exception &e) {
+			// Try to recover from a broken RPM database
+			if (!zypp_handle_broken_rpmdb(zypp, e)) {
+				// Rethrow, so the caller reports an internal error
+				throw;
 			}
-
-			initialized = TRUE;
 		}
+
+		_target_initialized = TRUE;
+	}
+
+	return zypp;
+}
+
+/**
+ * Initialize Zypp (Factory method)
+ */
+ZYpp::Ptr
+ZyppJob::get_zypp()
+{
+	ZYpp::Ptr zypp = NULL;
+
+	try {
+		zypp = zypp_get_instance ();
 	} catch (const ZYppFactoryException &ex) {
 		pk_backend_job_error_code (priv->currentJob, PK_ERROR_ENUM_FAILED_INITIALIZATION, "%s", ex.asUserString().c_str() );
 		return NULL;
@@ -1206,9 +1362,12 @@ zypp_is_valid_repo (PkBackendJob *job, RepoInfo repo)
 /**
  * Build and return a ResPool that contains all local resolvables
  * and ones found in the enabled repositories.
+ *
+ * Failing to load a repository aborts the daemon unless @fatal is FALSE,
+ * in which case the exception is passed on to the caller.
  */
 ResPool
-zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local, gboolean force = FALSE)
+zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local, gboolean force = FALSE, gboolean fatal = TRUE)
 {
 	static gboolean repos_loaded = FALSE;
 
@@ -1250,21 +1409,136 @@ zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local, gboolean force = FALSE)
 			}
 			//FIXME see above, skip already cached repos
 			if (sat::Pool::instance().reposFind( repo.alias ()) == Repository::noRepository)
-				manager.loadFromCache (repo);
+				zypp_load_repo_from_cache (manager, repo);
 
 		}
 		repos_loaded = true;
 	} catch (const repo::RepoNoAliasException &ex) {
+		if (!fatal)
+			throw;
 		g_error ("Can't figure an alias to look in cache");
 	} catch (const repo::RepoNotCachedException &ex) {
+		if (!fatal)
+			throw;
 		g_error ("The repo has to be cached at first: %s", ex.asUserString ().c_str ());
 	} catch (const Exception &ex) {
+		if (!fatal)
+			throw;
 		g_error ("TODO: Handle exceptions: %s", ex.asUserString ().c_str ());
 	}
 
 	return zypp->pool ();
 }
 
+/* Describes the data a pool is loaded from in the cache directory */
+static const char *POOL_STAMP_FILE = "packagekit-pool-stamp";
+
+/**
+ * Adds the size and modification time of the rpmdb to a stamp
+ **/
+static void
+zypp_rpmdb_stamp (std::ostream &stamp)
+{
+	const char *rpmdb[] = { "/var/lib/rpm/Packages", "/var/lib/rpm/Packages.db",
+				"/var/lib/rpm/rpmdb.sqlite", NULL };
+
+	for (guint i = 0; rpmdb[i] != NULL; i++) {
+		PathInfo info (rpmdb[i]);
+		if (info.isExist ())
+			stamp << rpmdb[i] << " " << info.mtime () << " " << info.size () << "\n";
+	}
+}
+
+/**
+ * What a pool built now would be loaded from: the rpmdb and the solv cache
+ * of each enabled repository. All of it comes from a few stat() calls and
+ * the repository cookies.
+ **/
+static std::string
+zypp_pool_stamp ()
+{
+	std::ostringstream stamp;
+
+	zypp_rpmdb_stamp (stamp);
+
+	RepoManager manager;
+	for (RepoManager::RepoConstIterator it = manager.repoBegin (); it != manager.repoEnd (); ++it) {
+		if (it->enabled ())
+			stamp << it->alias () << " " << manager.cacheStatus (*it).checksum () << "\n";
+	}
+	return stamp.str ();
+}
+
+/**
+ * Remember the state of the current cache directory, so that the next
+ * daemon start can tell whether preloading the pool is cheap.
+ **/
+static void
+zypp_save_pool_stamp ()
+{
+	g_autoptr(GError) error = NULL;
+	Pathname path = ZConfig::instance ().repoCachePath () / POOL_STAMP_FILE;
+	std::string stamp;
+
+	try {
+		stamp = zypp_pool_stamp ();
+	} catch (const Exception &ex) {
+		ERR << "Cannot stamp the pool: " << ex.asUserString () << std::endl;
+		return;
+	}
+	if (!g_file_set_contents (path.c_str (), stamp.c_str (), stamp.size (), &error))
+		ERR << "Cannot save the pool stamp: " << error->message << std::endl;
+}
+
+/**
+ * Loads the target and the repositories of the regular cache while the
+ * daemon starts up, so that the first request finds a ready pool. This only
+ * happens when nothing changed since the stamp was saved, otherwise the
+ * solv files may need to be rebuilt first, and that is left to a request
+ * that actually needs the pool.
+ **/
+static gpointer
+zypp_warm_up_thread (gpointer data)
+{
+	g_autofree gchar *saved = NULL;
+	Pathname stamp_path = REGULAR_CACHE_PATH / POOL_STAMP_FILE;
+	char target[PATH_MAX];
+	ssize_t len;
+	gint64 start = g_get_monotonic_time ();
+
+	pthread_mutex_lock (&priv->zypp_mutex);
+
+	// a job switching to the dist upgrade cache waits for us
+	len = readlink (ZConfig::instance ().repoCachePath ().c_str (), target, sizeof (target) - 1);
+	if (len < 0 || REGULAR_CACHE_PATH != Pathname (std::string (target, len))) {
+		MIL << "not preloading the pool, the regular cache is not active" << std::endl;
+		goto out;
+	}
+
+	if (!g_file_get_contents (stamp_path.c_str (), &saved, NULL, NULL)) {
+		MIL << "not preloading the pool, there is no stamp" << std::endl;
+		goto out;
+	}
+
+	try {
+		if (zypp_pool_stamp () != saved) {
+			LOG << "Not preloading the pool, the caches or the rpmdb changed" << std::endl;
+			goto out;
+		}
+
+		// a broken repository must not take the daemon down before any job ran
+		ZYpp::Ptr zypp = zypp_get_instance ();
+		zypp_build_pool (zypp, TRUE, FALSE, FALSE);
+		LOG << "Preloaded the pool in " << (g_get_monotonic_time () - start) / 1000 << " ms" << std::endl;
+	} catch (const Exception &ex) {
+		// the first job runs into the same problem and reports it
+		LOG << "Cannot preload the pool: " << ex.asUserString () << std::endl;
+	}
+ out:
+	pthread_mutex_unlock (&priv->zypp_mutex);
+	return NULL;
+}
+
 /**
   * Return the rpmHeader of a package
   */
@@ -1555,7 +1829,7 @@ zypp_refresh_meta_and_cache (RepoManager &manager, RepoInfo &repo, bool force =
 				    RepoManager::BuildIfNeeded);
 		try
 		{
-			manager.loadFromCache (repo);
+			zypp_load_repo_from_cache (manager, repo);
 		}
 		catch (const Exception &exp)
 		{
@@ -1564,7 +1838,7 @@ zypp_refresh_meta_and_cache (RepoManager &manager, RepoInfo &repo, bool force =
 			manager.buildCache (repo, force ?
 					    RepoManager::BuildForced :
 					    RepoManager::BuildIfNeeded);
-			manager.loadFromCache (repo);
+			zypp_load_repo_from_cache (manager, repo);
 		}
 		return TRUE;
 	} catch (const AbortTransactionException &ex) {
@@ -1776,6 +2050,22 @@ zypp_emit_filtered_packages_in_list (PkBackendJob *job, PkBitfield filters, cons
 	}
 }
 
+/*
+ * Emit a single package right away. Only used when the client accepts results
+ * in any order, the daemon then drops available copies of packages that were
+ * already emitted as installed.
+ */
+static void
+zypp_emit_streamed_package (PkBackendJob *job, PkBitfield filters, const sat::Solvable &solvable)
+{
+	if (zypp_filter_solvable (filters, solvable))
+		return;
+
+	zypp_backend_package (job,
+			      solvable.isSystem () ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE,
+			      solvable, make<ResObject>(solvable)->summary().c_str());
+}
+
 static gboolean
 is_tumbleweed (void)
 {
@@ -2027,6 +2317,504 @@ zypp_send_size_details (PkBackendJob *job, const char *name, int64_t bytes)
 	                        bytes);
 }
 
+/**
+  * identify the state of the pool and the rpmdb a solution was computed on
+  */
+static std::string
+zypp_plan_generation (ZYpp::Ptr zypp)
+{
+	std::ostringstream generation;
+
+	generation << sat::Pool::instance ().serial ().serial ();
+	Target_Ptr target = zypp->getTarget ();
+	if (target)
+		generation << ":" << target->timestamp ().asSeconds ();
+	return generation.str ();
+}
+
+/**
+  * identify the request a solution was computed for, the simulate flags aside
+  */
+static std::string
+zypp_plan_request (PkBackendJob *job, PerformType type, PkBitfield transaction_flags)
+{
+	std::ostringstream request;
+	GVariant *params = pk_backend_job_get_parameters (job);
+
+	pk_bitfield_remove (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
+	pk_bitfield_remove (transaction_flags, PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE);
+	g_autofree gchar *flags = pk_transaction_flag_bitfield_to_string (transaction_flags);
+	request << type << ";" << flags;
+
+	// the transaction flags are the only 't' parameter of the modifying roles
+	for (gsize i = 0; params != NULL && i < g_variant_n_children (params); i++) {
+		g_autoptr(GVariant) child = g_variant_get_child_value (params, i);
+		if (g_variant_is_of_type (child, G_VARIANT_TYPE_UINT64))
+			continue;
+		g_autofree gchar *value = g_variant_print (child, FALSE);
+		request << ";" << value;
+	}
+	return request.str ();
+}
+
+/**
+  * the pool items changed by the current solution, in commit order
+  */
+static std::vector<PoolItem>
+zypp_transaction_items ()
+{
+	std::vector<PoolItem> items;
+	sat::Transaction trans (sat::Transaction::loadFromPool);
+
+	// begin() rather than actionBegin(): the old versions replaced by an
+	// update are ignored by rpm, but still count as removals here
+	items.reserve (trans.size ());
+	for (sat::Transaction::const_iterator it = trans.begin (); it != trans.end (); ++it)
+		items.push_back (PoolItem (it->satSolvable ()));
+	return items;
+}
+
+/**
+  * remember the solution of a simulated transaction under its plan token
+  */
+static void
+zypp_plan_save (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, PkBitfield transaction_flags,
+		const std::vector<PoolItem> &items)
+{
+	const gchar *token = pk_backend_job_get_plan_token (job);
+
+	priv->plan.clear ();
+	if (token == NULL)
+		return;
+
+	priv->plan.token = token;
+	priv->plan.request = zypp_plan_request (job, type, transaction_flags);
+	priv->plan.generation = zypp_plan_generation (zypp);
+
+	for (auto it = items.begin (); it != items.end (); ++it) {
+		if (it->status ().transacts ())
+			priv->plan.statuses.push_back (std::make_pair (it->satSolvable (), it->status ()));
+	}
+	MIL << "saved plan " << token << " with " << priv->plan.statuses.size () << " steps" << std::endl;
+}
+
+/**
+  * apply the solution of the preceding simulate instead of resolving again,
+  * returns false when there is no usable solution for this transaction
+  */
+static bool
+zypp_plan_apply (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, PkBitfield transaction_flags)
+{
+	const gchar *token = pk_backend_job_get_plan_token (job);
+	ResolvedPlan plan = priv->plan;
+
+	// a solution is only good for a single transaction
+	priv->plan.clear ();
+
+	if (token == NULL || plan.token != token)
+		return false;
+	if (plan.request != zypp_plan_request (job, type, transaction_flags)) {
+		MIL << "plan " << token << " was made for another request" << std::endl;
+		return false;
+	}
+	if (plan.generation != zypp_plan_generation (zypp)) {
+		MIL << "plan " << token << " is outdated" << std::endl;
+		return false;
+	}
+
+	// everything marked by the caller has to be part of the solution
+	set<sat::Solvable> planned;
+	for (auto it = plan.statuses.begin (); it != plan.statuses.end (); ++it)
+		planned.insert (it->first);
+	ResPool pool = ResPool::instance ();
+	for (ResPool::const_iterator it = pool.begin (); it != pool.end (); ++it) {
+		if (it->status ().transacts () && planned.find (it->satSolvable ()) == planned.end ()) {
+			MIL << "plan " << token << " does not cover " << *it << std::endl;
+			return false;
+		}
+	}
+
+	for (auto it = plan.statuses.begin (); it != plan.statuses.end (); ++it)
+		PoolItem (it->first).status () = it->second;
+
+	LOG << "Reusing the dependency solution of plan " << token << std::endl;
+	return true;
+}
+
+/**
+  * The delta rpms the repositories offer, by package name. Every lookup in
+  * repo::DeltaCandidates scans the deltainfo of all repositories, so this
+  * is done once per transaction instead of for each package.
+  */
+class DeltaIndex {
+ public:
+	DeltaIndex ()
+	{
+		if (!ZConfig::instance ().download_use_deltarpm () || !applydeltarpm::haveApplydeltarpm ())
+			return;
+
+		for (auto repo = sat::Pool::instance ().reposBegin (); repo != sat::Pool::instance ().reposEnd (); ++repo) {
+			sat::LookupRepoAttr q (sat::SolvAttr::repositoryDeltaInfo, *repo);
+			bool found = false;
+			for (auto it = q.begin (); it != q.end (); ++it) {
+				packagedelta::DeltaRpm delta (it);
+				by_name[delta.name ()].push_back (delta);
+				found = true;
+			}
+			if (found)
+				repos.push_back (*repo);
+		}
+	}
+
+	/* the deltas that build exactly this package */
+	std::list<packagedelta::DeltaRpm> find (const Package::constPtr &pkg) const
+	{
+		std::list<packagedelta::DeltaRpm> deltas;
+		auto it = by_name.find (pkg->name ());
+		if (it == by_name.end ())
+			return deltas;
+		for (auto delta = it->second.begin (); delta != it->second.end (); ++delta) {
+			if (delta->edition () == pkg->edition () && delta->arch () == pkg->arch ())
+				deltas.push_back (*delta);
+		}
+		return deltas;
+	}
+
+	/* what PackageProvider needs to use them, which is nothing to scan
+	 * for packages without any delta */
+	repo::DeltaCandidates candidates (const sat::Solvable &solvable) const
+	{
+		if (by_name.count (solvable.name ()) == 0)
+			return repo::DeltaCandidates ();
+		return repo::DeltaCandidates (repos, solvable.name ());
+	}
+
+ private:
+	std::list<Repository> repos;
+	std::map<std::string, std::list<packagedelta::DeltaRpm> > by_name;
+};
+
+/**
+  * find the delta rpm PackageProvider will build the package from, which
+  * is one whose base version is installed, and remember it so the savings
+  * can be accounted for once it was applied
+  */
+static bool
+zypp_find_delta (const DeltaIndex &index, const PoolItem &item, packagedelta::DeltaRpm &delta)
+{
+	Package::constPtr pkg = asKind<Package> (item.resolvable ());
+	if (!pkg)
+		return false;
+
+	std::list<packagedelta::DeltaRpm> deltas = index.find (pkg);
+	if (deltas.empty ())
+		return false;
+
+	ui::Selectable::Ptr sel = ui::Selectable::get (item);
+	for (auto it = deltas.begin (); it != deltas.end (); ++it) {
+		for (auto inst = sel->installedBegin (); inst != sel->installedEnd (); ++inst) {
+			if (inst->edition () != it->baseversion ().edition () || inst->arch () != it->arch ())
+				continue;
+			delta = *it;
+			priv->deltas[delta.location ().filename ().basename ()] =
+				std::make_pair (item.satSolvable (), (int64_t) delta.location ().downloadSize ());
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * A package of a transaction that is fetched into the repository package
+ * cache before the commit, see zypp_prefetch_packages().
+ **/
+struct PrefetchItem {
+	sat::Solvable solvable;
+	Url url;
+	media::UrlResolverPlugin::HeaderList headers;
+	Pathname path;
+	CheckSum checksum;
+	int64_t size;
+	bool done;
+	std::string error;
+};
+
+/**
+ * What the prefetch workers share with the job thread watching them.
+ **/
+struct PrefetchState {
+	std::atomic<int64_t> received;
+	std::atomic<bool> cancelled;
+	GAsyncQueue *finished;
+};
+
+static size_t
+zypp_prefetch_write_cb (char *data, size_t size, size_t nmemb, void *user_data)
+{
+	FILE *fp = static_cast<FILE *> (((gpointer *) user_data)[0]);
+	PrefetchState *state = static_cast<PrefetchState *> (((gpointer *) user_data)[1]);
+	size_t written = fwrite (data, size, nmemb, fp);
+
+	state->received += written * size;
+	return written * size;
+}
+
+static int
+zypp_prefetch_progress_cb (void *user_data, curl_off_t dltotal, curl_off_t dlnow,
+			   curl_off_t ultotal, curl_off_t ulnow)
+{
+	PrefetchState *state = static_cast<PrefetchState *> (user_data);
+
+	// a non-zero return aborts the transfer
+	return state->cancelled ? 1 : 0;
+}
+
+/**
+ * Fetches a single package into "<path>.part", continuing where an earlier,
+ * cancelled run stopped, and moves it into place when complete.
+ **/
+static void
+zypp_prefetch_worker (gpointer data, gpointer user_data)
+{
+	PrefetchItem *item = static_cast<PrefetchItem *> (data);
+	PrefetchState *state = static_cast<PrefetchState *> (user_data);
+	std::string part = item->path.asString () + ".part";
+	struct curl_slist *headers = NULL;
+	char errbuf[CURL_ERROR_SIZE] = "";
+	CURLcode res = CURLE_ABORTED_BY_CALLBACK;
+
+	if (state->cancelled)
+		goto out;
+
+	for (auto it = item->headers.begin (); it != item->headers.end (); ++it) {
+		std::string header = it->first + ": " + it->second;
+		headers = curl_slist_append (headers, header.c_str ());
+	}
+
+	// start over once if the partial file cannot be resumed
+	for (guint attempt = 0; attempt < 2 && !state->cancelled; attempt++) {
+		FILE *fp = fopen (part.c_str (), attempt == 0 ? "ab" : "wb");
+		if (fp == NULL) {
+			item->error = std::string ("cannot write ") + part + ": " + strerror (errno);
+			goto out;
+		}
+
+		curl_off_t offset = ftello (fp);
+		if (offset >= item->size && item->size > 0) {
+			// completed by an earlier run, only the rename is missing
+			fclose (fp);
+			res = CURLE_OK;
+			break;
+		}
+
+		gpointer write_data[] = { fp, state };
+		CURL *curl = curl_easy_init ();
+		curl_easy_setopt (curl, CURLOPT_URL, item->url.asCompleteString ().c_str ());
+		curl_easy_setopt (curl, CURLOPT_HTTPHEADER, headers);
+		curl_easy_setopt (curl, CURLOPT_FOLLOWLOCATION, 1L);
+		curl_easy_setopt (curl, CURLOPT_FAILONERROR, 1L);
+		curl_easy_setopt (curl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt (curl, CURLOPT_ERRORBUFFER, errbuf);
+		curl_easy_setopt (curl, CURLOPT_USERAGENT, "PackageKit-zypp/" PROJECT_VERSION);
+		curl_easy_setopt (curl, CURLOPT_RESUME_FROM_LARGE, offset);
+		curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, zypp_prefetch_write_cb);
+		curl_easy_setopt (curl, CURLOPT_WRITEDATA, write_data);
+		curl_easy_setopt (curl, CURLOPT_NOPROGRESS, 0L);
+		curl_easy_setopt (curl, CURLOPT_XFERINFOFUNCTION, zypp_prefetch_progress_cb);
+		curl_easy_setopt (curl, CURLOPT_XFERINFODATA, state);
+		// give up on stalled connections instead of blocking the commit
+		curl_easy_setopt (curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+		curl_easy_setopt (curl, CURLOPT_LOW_SPEED_TIME, 60L);
+
+		// the TLS options zypp takes from the repository URL
+		std::string ssl_cert = item->url.getQueryParam ("ssl_clientcert");
+		std::string ssl_key = item->url.getQueryParam ("ssl_clientkey");
+		std::string ssl_capath = item->url.getQueryParam ("ssl_capath");
+		if (!ssl_cert.empty ())
+			curl_easy_setopt (curl, CURLOPT_SSLCERT, ssl_cert.c_str ());
+		if (!ssl_key.empty ())
+			curl_easy_setopt (curl, CURLOPT_SSLKEY, ssl_key.c_str ());
+		if (!ssl_capath.empty ())
+			curl_easy_setopt (curl, CURLOPT_CAPATH, ssl_capath.c_str ());
+		if (item->url.getQueryParam ("ssl_verify") == "no") {
+			curl_easy_setopt (curl, CURLOPT_SSL_VERIFYPEER, 0L);
+			curl_easy_setopt (curl, CURLOPT_SSL_VERIFYHOST, 0L);
+		}
+
+		res = curl_easy_perform (curl);
+		curl_easy_cleanup (curl);
+		if (fclose (fp) != 0 && res == CURLE_OK)
+			res = CURLE_WRITE_ERROR;
+
+		if (res == CURLE_OK || offset == 0 ||
+		    res == CURLE_ABORTED_BY_CALLBACK || res == CURLE_WRITE_ERROR)
+			break;
+		MIL << "cannot resume " << part << " at " << offset << ": " << errbuf << std::endl;
+	}
+
+	if (res == CURLE_OK) {
+		if (rename (part.c_str (), item->path.c_str ()) == 0)
+			item->done = true;
+		else
+			item->error = std::string ("cannot rename ") + part + ": " + strerror (errno);
+	} else if (res != CURLE_ABORTED_BY_CALLBACK) {
+		item->error = errbuf[0] != '\0' ? errbuf : curl_easy_strerror (res);
+	}
+ out:
+	curl_slist_free_all (headers);
+	g_async_queue_push (state->finished, item);
+}
+
+/**
+ * Collects the packages of the transaction that are not in the package
+ * cache yet and can be fetched directly from their repository.
+ **/
+static std::vector<PrefetchItem>
+zypp_prefetch_plan (const std::vector<PoolItem> &items, const DeltaIndex &deltas)
+{
+	std::vector<PrefetchItem> plan;
+	std::map<std::string, std::pair<Url, media::UrlResolverPlugin::HeaderList> > repos;
+
+	for (auto it = items.begin (); it != items.end (); ++it) {
+		if (!it->status ().isToBeInstalled ())
+			continue;
+		Package::constPtr pkg = asKind<Package> (it->resolvable ());
+		if (!pkg || pkg->isCached ())
+			continue;
+
+		// a delta is much smaller, leave it to the commit
+		packagedelta::DeltaRpm delta;
+		if (zypp_find_delta (deltas, *it, delta))
+			continue;
+
+		RepoInfo info = pkg->repoInfo ();
+		auto repo = repos.find (info.alias ());
+		if (repo == repos.end ()) {
+			Url url = info.url ();
+			media::UrlResolverPlugin::HeaderList headers;
+			try {
+				if (url.getScheme () == "plugin")
+					url = media::UrlResolverPlugin::resolveUrl (url, headers);
+			} catch (const Exception &ex) {
+				MIL << "cannot resolve " << url << ": " << ex.asUserString () << std::endl;
+				url = Url ();
+			}
+			repo = repos.insert (std::make_pair (info.alias (), std::make_pair (url, headers))).first;
+		}
+
+		// anything but remote repositories is left to the commit
+		const Url &base = repo->second.first;
+		if (!base.isValid () ||
+		    (base.getScheme () != "http" && base.getScheme () != "https" && base.getScheme () != "ftp"))
+			continue;
+
+		const OnMediaLocation &location = pkg->location ();
+		PrefetchItem item;
+		item.solvable = it->satSolvable ();
+		item.url = base;
+		item.url.setPathName ((Pathname (base.getPathName ()) / info.path () / location.filename ()).asString ());
+		item.headers = repo->second.second;
+		item.path = info.packagesPath () / info.path () / location.filename ();
+		item.checksum = pkg->checksum ();
+		item.size = pkg->downloadSize ();
+		item.done = false;
+		plan.push_back (item);
+	}
+	return plan;
+}
+
+/**
+ * Downloads all packages of the transaction that are not cached yet with
+ * priv->prefetch_workers parallel connections, so that the commit installs
+ * from the package cache. A package that cannot be fetched here is simply
+ * left for the commit. Returns false only when the job was cancelled;
+ * partially downloaded packages are kept and resumed on the next attempt.
+ **/
+static bool
+zypp_prefetch_packages (PkBackendJob *job, const std::vector<PoolItem> &items, const DeltaIndex &deltas)
+{
+	std::vector<PrefetchItem> plan = zypp_prefetch_plan (items, deltas);
+	if (plan.empty ())
+		return true;
+
+	PrefetchState state;
+	int64_t remaining = 0;
+	state.received = 0;
+	state.cancelled = false;
+	state.finished = g_async_queue_new ();
+
+	GThreadPool *pool = g_thread_pool_new (zypp_prefetch_worker, &state,
+					       priv->prefetch_workers, TRUE, NULL);
+	for (auto it = plan.begin (); it != plan.end (); ++it) {
+		zypp::filesystem::assert_dir (it->path.dirname ());
+		PathInfo part (it->path.asString () + ".part");
+		remaining += it->size - (part.isFile () ? MIN (part.size (), it->size) : 0);
+		g_thread_pool_push (pool, &(*it), NULL);
+	}
+
+	LOG << "Prefetching " << plan.size () << " packages, " << remaining << " bytes, with "
+	    << priv->prefetch_workers << " connections" << std::endl;
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_DOWNLOAD);
+	pk_backend_job_set_download_size_remaining (job, remaining);
+
+	gint64 last_time = g_get_monotonic_time ();
+	int64_t last_received = 0;
+	for (guint finished = 0; finished < plan.size (); ) {
+		PrefetchItem *item = static_cast<PrefetchItem *> (g_async_queue_timeout_pop (state.finished, G_USEC_PER_SEC / 4));
+		if (item != NULL) {
+			finished++;
+			if (item->done) {
+				g_autofree gchar *package_id = zypp_build_package_id_from_resolvable (item->solvable);
+				pk_backend_job_package (job, PK_INFO_ENUM_DOWNLOADING, package_id,
+							make<ResObject> (item->solvable)->summary ().c_str ());
+				zypp_backend_download_finished (job);
+			} else if (!item->error.empty ()) {
+				MIL << "cannot prefetch " << item->url << ": " << item->error << std::endl;
+			}
+		}
+
+		if (!state.cancelled && currentJobIsCancelled ()) {
+			LOG << "Prefetch cancelled, keeping partial downloads" << std::endl;
+			state.cancelled = true;
+		}
+
+		gint64 now = g_get_monotonic_time ();
+		if (now - last_time >= G_USEC_PER_SEC / 2) {
+			int64_t received = state.received;
+			pk_backend_job_set_speed (job, (received - last_received) * G_USEC_PER_SEC / (now - last_time));
+			pk_backend_job_set_download_size_remaining (job, MAX (0, remaining - received));
+			last_received = received;
+			last_time = now;
+		}
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_async_queue_unref (state.finished);
+	pk_backend_job_set_speed (job, 0);
+
+	if (state.cancelled) {
+		pk_backend_job_error_code (job, PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+					   "Download was cancelled");
+		return false;
+	}
+
+	// the commit refetches anything that does not match the metadata
+	guint fetched = 0;
+	for (auto it = plan.begin (); it != plan.end (); ++it) {
+		if (!it->done)
+			continue;
+		if (!it->checksum.empty () &&
+		    zypp::filesystem::checksum (it->path, it->checksum.type ()) != it->checksum.checksum ()) {
+			MIL << "checksum mismatch for " << it->path << std::endl;
+			zypp::filesystem::unlink (it->path);
+			continue;
+		}
+		fetched++;
+	}
+	LOG << "Prefetched " << fetched << " of " << plan.size () << " packages, "
+	    << state.received << " bytes" << std::endl;
+	return true;
+}
+
 /**
   * simulate, or perform changes in pool to the system
   */
@@ -2050,7 +2838,11 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 		pk_backend_job_set_percentage(job, 0);
 		zypp->resolver ()->setIgnoreAlreadyRecommended (TRUE);
 		pk_backend_job_set_percentage(job, 100);
-		if (!zypp->resolver ()->resolvePool ()) {
+		// the preceding simulate may have solved this already
+		bool plan_applied = !force &&
+			!pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE) &&
+			zypp_plan_apply (job, zypp, type, transaction_flags);
+		if (!plan_applied && !zypp->resolver ()->resolvePool ()) {
 			// Manual intervention required to resolve dependencies
 			// TODO: Figure out what we need to do with PackageKit
 			// to pull off interactive problem solving.
@@ -2082,6 +2874,15 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 			goto exit;
 		}
 
+		// everything below only looks at what the solution changes, the
+		// rest of the pool is left alone
+		g_autoptr(GTimer) timer = g_timer_new ();
+		std::vector<PoolItem> items = zypp_transaction_items ();
+		const DeltaIndex deltas;
+
+		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE))
+			zypp_plan_save (job, zypp, type, transaction_flags, items);
+
 		switch (type) {
 		case INSTALL:
 			pk_backend_job_set_status (job, PK_STATUS_ENUM_INSTALL);
@@ -2101,20 +2902,30 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 			break;
 		}
 
-		ResPool pool = ResPool::instance ();
-		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE) &&
-		    !pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE)) {
-			ret = TRUE;
+		gboolean simulate = pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
+		gboolean notify = simulate && !pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE);
+		gboolean only_download = pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD);
 
-			MIL << "simulating" << std::endl;
+		int64_t total_download_bytes = 0;
+		int64_t total_install_bytes = 0;
+		int64_t total_remove_bytes = 0;
+		int64_t total_cached_bytes = 0;
+		int64_t biggest_package_download = 0;
+		int64_t delta_savings = 0;
+		PoolItem eula_item;
 
-			for (ResPool::const_iterator it = pool.begin (); it != pool.end (); ++it) {
+		// count, size and notify in one go over the changed items
+		ret = TRUE;
+		_dl_count = 0;
+		priv->exec.reset();
+		priv->deltas.clear();
+		priv->delta_savings = 0;
+		for (auto it = items.begin (); it != items.end (); ++it) {
+			if (notify) {
 				switch (type) {
 				case REMOVE:
-					if (!(*it)->isSystem ()) {
-						it->statusReset ();
+					if (!(*it)->isSystem ())
 						continue;
-					}
 					break;
 				case INSTALL:
 				case UPDATE:
@@ -2126,63 +2937,18 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 				default:
 					break;
 				}
-				
+
 				if (!zypp_backend_pool_item_notify (job, *it, TRUE))
 					ret = FALSE;
-				it->statusReset ();
+				continue;
 			}
-			goto exit;
-		}
 
-
-		// look for licenses to confirm
-
-		_dl_count = 0;
-		for (ResPool::const_iterator it = pool.begin (); it != pool.end (); ++it) {
-			if (it->status ().isToBeInstalled ())
+			if (it->status ().isToBeInstalled ()) {
 				_dl_count++;
-			if (it->status ().isToBeInstalled () && !(it->resolvable()->licenseToConfirm().empty ())) {
-				gchar *eula_id = g_strdup ((*it)->name ().c_str ());
-				gboolean has_eula = pk_backend_is_eula_valid (backend, eula_id);
-				if (!has_eula) {
-					gchar *package_id = zypp_build_package_id_from_resolvable (it->satSolvable ());
-					pk_backend_job_eula_required (job,
-							eula_id,
-							package_id,
-							(*it)->vendor ().c_str (),
-							it->resolvable()->licenseToConfirm().c_str ());
-					pk_backend_job_error_code (job, PK_ERROR_ENUM_NO_LICENSE_AGREEMENT, "You've to agree/decline a license");
-					g_free (package_id);
-					g_free (eula_id);
-					goto exit;
-				}
-				g_free (eula_id);
+				if (!eula_item && !(it->resolvable()->licenseToConfirm().empty ()))
+					eula_item = *it;
 			}
-		}
-
-		// Perform the installation
-		gboolean only_download = pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD);
-
-		ZYppCommitPolicy policy;
-		policy.restrictToMedia (0); // 0 == install all packages regardless to media
-		if (only_download)
-			policy.downloadMode(DownloadOnly);
-		else
-			policy.downloadMode (DownloadInHeaps);
-		
-		policy.syncPoolAfterCommit (true);
-		if (!pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED))
-			policy.rpmNoSignature(true);
-
-		int64_t total_download_bytes = 0;
-		int64_t total_install_bytes = 0;
-		int64_t total_remove_bytes = 0;
-		int64_t total_cached_bytes = 0;
-		int64_t biggest_package_download = 0;
 
-		// Get number of installations and removals for overall progress
-		priv->exec.reset();
-		for (ResPool::const_iterator it = pool.begin (); it != pool.end (); ++it) {
 			// Patterns are not "installed" or "downloaded" as such
 			if (it->satSolvable().kind() == ResKind::pattern) {
 				continue;
@@ -2197,8 +2963,17 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 
 				Package::constPtr pkg = asKind<Package>(it->resolvable());
 				if (pkg) {
+					packagedelta::DeltaRpm delta;
 					if (pkg->isCached()) {
 						total_cached_bytes += pkg->downloadSize();
+					} else if (zypp_find_delta(deltas, *it, delta)) {
+						int64_t delta_size = delta.location().downloadSize();
+						total_download_bytes += delta_size;
+						delta_savings += MAX(0, (int64_t) pkg->downloadSize() - delta_size);
+						// the full package is rebuilt in the cache
+						if (pkg->downloadSize() > biggest_package_download) {
+							biggest_package_download = pkg->downloadSize();
+						}
 					} else {
 						total_download_bytes += pkg->downloadSize();
 						if (pkg->downloadSize() > biggest_package_download) {
@@ -2214,6 +2989,40 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 			}
 		}
 
+		MIL << "planned " << items.size () << " steps in "
+		    << g_timer_elapsed (timer, NULL) * 1000 << " ms" << std::endl;
+
+		if (simulate) {
+			// a simulation must not leave anything marked in the pool
+			for (auto it = items.begin (); it != items.end (); ++it)
+				it->statusReset ();
+		}
+
+		if (notify) {
+			MIL << "simulated" << std::endl;
+			goto exit;
+		}
+		ret = FALSE;
+
+		// look for licenses to confirm
+		if (eula_item) {
+			gchar *eula_id = g_strdup (eula_item->name ().c_str ());
+			gboolean has_eula = pk_backend_is_eula_valid (backend, eula_id);
+			if (!has_eula) {
+				gchar *package_id = zypp_build_package_id_from_resolvable (eula_item.satSolvable ());
+				pk_backend_job_eula_required (job,
+						eula_id,
+						package_id,
+						eula_item->vendor ().c_str (),
+						eula_item.resolvable()->licenseToConfirm().c_str ());
+				pk_backend_job_error_code (job, PK_ERROR_ENUM_NO_LICENSE_AGREEMENT, "You've to agree/decline a license");
+				g_free (package_id);
+				g_free (eula_id);
+				goto exit;
+			}
+			g_free (eula_id);
+		}
+
 		LOG << "Before commit: "
 			<< priv->exec.total_downloads << " downloads, "
 			<< priv->exec.total_installs << " installs, "
@@ -2222,24 +3031,33 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 			<< total_download_bytes << " download, "
 			<< total_install_bytes << " install, "
 			<< total_remove_bytes << " remove, "
-			<< total_cached_bytes << " cached" << std::endl;
+			<< total_cached_bytes << " cached, "
+			<< delta_savings << " saved by " << priv->deltas.size() << " deltas" << std::endl;
 
-		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE) &&
-		    pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE)) {
-
-			LOG << "Simulate requested, sending notifications and resetting status" << std::endl;
-			for (ResPool::const_iterator it = pool.begin (); it != pool.end (); ++it) {
-				it->statusReset ();
-			}
+		if (simulate) {
+			LOG << "Simulate requested, sending size details" << std::endl;
 
 			zypp_send_size_details (job, "::DOWNLOAD", total_download_bytes);
 			zypp_send_size_details (job, "::INSTALL", total_install_bytes);
 			zypp_send_size_details (job, "::REMOVE", total_remove_bytes);
 			zypp_send_size_details (job, "::CACHED", total_cached_bytes);
+			zypp_send_size_details (job, "::DELTA_SAVINGS", delta_savings);
 
 			goto exit;
 		}
 
+		// Perform the installation
+		ZYppCommitPolicy policy;
+		policy.restrictToMedia (0); // 0 == install all packages regardless to media
+		if (only_download)
+			policy.downloadMode(DownloadOnly);
+		else
+			policy.downloadMode (DownloadInHeaps);
+		
+		policy.syncPoolAfterCommit (true);
+		if (!pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED))
+			policy.rpmNoSignature(true);
+
 		int64_t required_space_bytes_download = total_download_bytes;
 		int64_t required_space_bytes_installation = (type == UPGRADE_SYSTEM)
 		                ? MAX(0, total_install_bytes - total_remove_bytes)
@@ -2280,6 +3098,9 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 			goto exit;
 		}
 
+		if (priv->prefetch_workers > 0 && !zypp_prefetch_packages (job, items, deltas))
+			goto exit;
+
 		ZYppCommitResult result = zypp->commit (policy);
 
 		bool worked = result.allDone();
@@ -2311,6 +3132,14 @@ zypp_perform_execution (PkBackendJob *job, ZYpp::Ptr zypp, PerformType type, gbo
 			goto exit;
 		}
 
+		if (priv->delta_savings > 0) {
+			zypp_send_size_details (job, "::DELTA_SAVINGS", priv->delta_savings);
+		}
+
+		// the rpmdb changed, keep the stamp in step with the pool
+		if (!only_download)
+			zypp_save_pool_stamp ();
+
 		pk_backend_job_set_percentage(job, 100);
 		ret = TRUE;
 	} catch (const repo::RepoNotFoundException &ex) {
@@ -2539,22 +3368,92 @@ pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
 	priv->currentJob = 0;
 	priv->zypp_mutex = PTHREAD_MUTEX_INITIALIZER;
 	priv->exec = ExecCounters();
+	priv->delta_savings = 0;
+	priv->prefetch_workers = CLAMP (g_key_file_get_integer (conf, "Daemon", "ParallelDownloads", NULL), 0, 16);
+	curl_global_init (CURL_GLOBAL_DEFAULT);
 
 	/* Set PATH variable to avoid problems when installing packges(bsc#1175315). */
 	g_setenv("PATH", "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin", TRUE);
 
+	/* the same configuration zypp_set_custom_config() sets up for the jobs */
+	g_setenv("ZYPP_CONF", "/etc/zypp/packagekit-zypp-override.conf", TRUE);
+
 	g_debug ("zypp_backend_initialize");
 }
 
+/**
+ * Lets the daemon drop its cached GetUpdates results when rpm or zypper
+ * changed the rpmdb or the solv caches behind our back. This runs on the
+ * main thread, possibly while a job holds the zypp mutex, so it only uses
+ * stat() and does not touch the RepoManager.
+ **/
+gchar *
+pk_backend_get_updates_generation (PkBackend *backend)
+{
+	std::ostringstream generation;
+	std::list<std::string> repos;
+	Pathname solv_path = ZConfig::instance ().repoSolvfilesPath ();
+
+	zypp_rpmdb_stamp (generation);
+
+	// the cache directory changes for a dist upgrade, so include the target
+	generation << zypp::filesystem::readlink (ZConfig::instance ().repoCachePath ()) << "\n";
+
+	if (zypp::filesystem::readdir (repos, solv_path, false) == 0) {
+		for (std::list<std::string>::const_iterator it = repos.begin (); it != repos.end (); ++it) {
+			PathInfo info (solv_path / *it / "solv");
+			if (info.isExist ())
+				generation << *it << " " << info.mtime () << " " << info.size () << "\n";
+		}
+	}
+	return g_strdup (generation.str ().c_str ());
+}
+
+/**
+ * Tell the next daemon instance whether we had a pool loaded, and stamp the
+ * caches it was built from, so that it can preload the same pool.
+ **/
+void
+pk_backend_save_state (PkBackend *backend, GKeyFile *state)
+{
+	gboolean loaded;
+
+	pthread_mutex_lock (&priv->zypp_mutex);
+	loaded = _target_initialized;
+	if (loaded)
+		zypp_save_pool_stamp ();
+	pthread_mutex_unlock (&priv->zypp_mutex);
+
+	g_key_file_set_boolean (state, "zypp", "PoolLoaded", loaded);
+}
+
+/**
+ * Only preload the pool when the previous instance had one loaded, a daemon
+ * that was just used for the odd query does not need it either.
+ **/
+void
+pk_backend_restore_state (PkBackend *backend, GKeyFile *state)
+{
+	if (!g_key_file_get_boolean (state, "zypp", "PoolLoaded", NULL))
+		return;
+	_warm_up_thread = g_thread_new ("zypp-warm-up", zypp_warm_up_thread, NULL);
+}
+
 void
 pk_backend_destroy (PkBackend *backend)
 {
 	g_debug ("zypp_backend_destroy");
 
+	if (_warm_up_thread != NULL) {
+		g_thread_join (_warm_up_thread);
+		_warm_up_thread = NULL;
+	}
+
 	zypp::filesystem::recursive_rmdir (zypp::myTmpDir ());
 
 	g_free (_repoName);
 	delete priv;
+	curl_global_cleanup ();
 }
 
 
@@ -3091,7 +3990,8 @@ backend_refresh_cache_thread (PkBackendJob *job, GVariant *params, gpointer user
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp) {
-		zypp_refresh_cache (job, zypp, TRUE);
+		if (zypp_refresh_cache (job, zypp, TRUE))
+			zypp_save_pool_stamp ();
 
 		if (zjob.isCancelled()) {
 			LOG << "Package refresh was cancelled on user request" << std::endl;
@@ -3819,6 +4719,7 @@ backend_resolve_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 	PkBitfield _filters;
 	uint start = 0;
 	bool ext_data_repo = false;
+	bool stream;
 	
 	g_variant_get(params, "(t^a&s)",
 		      &_filters,
@@ -3840,6 +4741,11 @@ backend_resolve_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 		ext_data_repo = true;
 	}
 
+	/* the newest filters need to see all versions of a name first */
+	stream = pk_backend_job_get_stream_results (job) && !ext_data_repo &&
+		 !pk_bitfield_contain (_filters, PK_FILTER_ENUM_NEWEST) &&
+		 !pk_bitfield_contain (_filters, PK_FILTER_ENUM_NOT_NEWEST);
+
 	for (uint i = start; search[i]; i++) {
 		gchar *tmp = pk_filter_bitfield_to_string (_filters);
 		MIL << search[i] << " " << tmp << std::endl;
@@ -3892,7 +4798,10 @@ backend_resolve_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 				newest = *it;
 			}
 			MIL << "emit " << *it << std::endl;
-			pkgs.push_back (*it);
+			if (stream)
+				zypp_emit_streamed_package (job, _filters, *it);
+			else
+				pkgs.push_back (*it);
 		}
 
 		/* The newest filter processes installed and available package
@@ -3914,7 +4823,8 @@ backend_resolve_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 			}
 		}
 
-		zypp_emit_filtered_packages_in_list (job, _filters, pkgs, ext_data_repo);
+		if (!stream)
+			zypp_emit_filtered_packages_in_list (job, _filters, pkgs, ext_data_repo);
 	}
 }
 
@@ -4018,6 +4928,14 @@ backend_find_packages_thread (PkBackendJob *job, GVariant *params, gpointer user
 		break;
 	};
 
+	if (pk_backend_job_get_stream_results (job)) {
+		if (!q.empty ()) {
+			for_ (it, q.begin (), q.end ())
+				zypp_emit_streamed_package (job, _filters, *it);
+		}
+		return;
+	}
+
 	if ( ! q.empty() ) {
 		copy( q.begin(), q.end(), back_inserter( v ) );
 	}
@@ -4074,9 +4992,14 @@ backend_search_group_thread (PkBackendJob *job, GVariant *params, gpointer user_
 
 	sat::LookupAttr look (sat::SolvAttr::group);
 
+	gboolean stream = pk_backend_job_get_stream_results (job);
 	for (sat::LookupAttr::iterator it = look.begin (); it != look.end (); ++it) {
 		PkGroupEnum rpmGroup = get_enum_group (it.asString ());
-		if (pkGroup == rpmGroup)
+		if (pkGroup != rpmGroup)
+			continue;
+		if (stream)
+			zypp_emit_streamed_package (job, _filters, it.inSolvable ());
+		else
 			v.push_back (it.inSolvable ());
 	}
 
@@ -4226,9 +5149,18 @@ backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		g_auto(GStrv) strv = NULL;
 		g_autoptr(GPtrArray) pkg_files = NULL;
 
-		pkg_files = g_ptr_array_new ();
+		pkg_files = g_ptr_array_new_with_free_func (g_free);
+
+		Package::constPtr package = asKind<Package> (make<ResObject> (solvable));
+		if (solvable.isSystem () && package) {
+			// the system repository was built from the rpmdb with the
+			// complete file lists, so there is no need to go back to it
+			Package::FileList files = package->filelist ();
+			for (Package::FileList::iterator it = files.begin (); it != files.end (); ++it)
+				g_ptr_array_add (pkg_files, g_strdup (it->c_str ()));
+		}
 
-		if (solvable.isSystem ()){
+		if (solvable.isSystem () && pkg_files->len == 0) {
 			try {
 				target::rpm::RpmHeader::constPtr rpmHeader = zypp_get_rpmHeader (solvable.name (), solvable.edition ());
 				list<string> files = rpmHeader->tag_filenames ();
@@ -4242,7 +5174,7 @@ backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 							     "Couldn't open rpm-database");
 				return;
 			}
-		} else {
+		} else if (!solvable.isSystem ()) {
 			g_ptr_array_add (pkg_files,
 					 g_strdup ("Only available for installed packages"));
 		}
@@ -4409,6 +5341,172 @@ pk_backend_update_packages (PkBackend *backend, PkBackendJob *job, PkBitfield tr
 	zypp_backend_job_thread_create (job, backend_update_packages_thread, NULL, NULL);
 }
 
+/**
+ * What zypp_sync_cache() did, in bytes.
+ **/
+struct CacheSyncStats {
+	CacheSyncStats() : copied(0), cloned(0), unchanged(0) {}
+
+	int64_t copied;
+	int64_t cloned;
+	int64_t unchanged;
+};
+
+/**
+  * put a copy of the file src at dst, reusing the file old of the previous
+  * sync when it has not changed since
+  */
+static bool
+zypp_sync_cache_file (const string &src, const string &old, const string &dst,
+		      const struct stat &st, CacheSyncStats &stats)
+{
+	struct stat old_st;
+
+	// every file is written with the mtime of its source, see below
+	if (lstat (old.c_str (), &old_st) == 0 && S_ISREG (old_st.st_mode) &&
+	    old_st.st_size == st.st_size &&
+	    old_st.st_mtim.tv_sec == st.st_mtim.tv_sec &&
+	    old_st.st_mtim.tv_nsec == st.st_mtim.tv_nsec &&
+	    link (old.c_str (), dst.c_str ()) == 0) {
+		stats.unchanged += st.st_size;
+		return true;
+	}
+
+	int src_fd = open (src.c_str (), O_RDONLY | O_CLOEXEC);
+	if (src_fd < 0) {
+		ERR << "Cannot open " << src << ": " << strerror (errno) << std::endl;
+		return false;
+	}
+	int dst_fd = open (dst.c_str (), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+	if (dst_fd < 0) {
+		ERR << "Cannot create " << dst << ": " << strerror (errno) << std::endl;
+		close (src_fd);
+		return false;
+	}
+
+	bool ret = true;
+#ifdef FICLONE
+	// a reflink shares the data until either side changes it
+	if (ioctl (dst_fd, FICLONE, src_fd) == 0) {
+		stats.cloned += st.st_size;
+	} else
+#endif
+	{
+		char buf[64 * 1024];
+		ssize_t len;
+		while ((len = read (src_fd, buf, sizeof (buf))) > 0) {
+			if (write (dst_fd, buf, len) != len) {
+				len = -1;
+				break;
+			}
+			stats.copied += len;
+		}
+		if (len < 0) {
+			ERR << "Cannot copy " << src << ": " << strerror (errno) << std::endl;
+			ret = false;
+		}
+	}
+
+	struct timespec times[2] = { st.st_atim, st.st_mtim };
+	if (ret && futimens (dst_fd, times) != 0)
+		ERR << "Cannot set the times of " << dst << ": " << strerror (errno) << std::endl;
+	if (close (dst_fd) != 0)
+		ret = false;
+	close (src_fd);
+	return ret;
+}
+
+/**
+  * recreate the tree src at dst, see zypp_sync_cache_file()
+  */
+static bool
+zypp_sync_cache_dir (const string &src, const string &old, const string &dst, CacheSyncStats &stats)
+{
+	DIR *dir = opendir (src.c_str ());
+	if (dir == NULL) {
+		ERR << "Cannot open " << src << ": " << strerror (errno) << std::endl;
+		return false;
+	}
+
+	bool ret = true;
+	struct dirent *entry;
+	while (ret && (entry = readdir (dir)) != NULL) {
+		if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+			continue;
+
+		string src_path = src + "/" + entry->d_name;
+		string old_path = old + "/" + entry->d_name;
+		string dst_path = dst + "/" + entry->d_name;
+		struct stat st;
+		if (lstat (src_path.c_str (), &st) != 0) {
+			ERR << "Cannot stat " << src_path << ": " << strerror (errno) << std::endl;
+			ret = false;
+		} else if (S_ISDIR (st.st_mode)) {
+			ret = mkdir (dst_path.c_str (), st.st_mode & 07777) == 0 &&
+				zypp_sync_cache_dir (src_path, old_path, dst_path, stats);
+		} else if (S_ISLNK (st.st_mode)) {
+			char target[PATH_MAX];
+			ssize_t len = readlink (src_path.c_str (), target, sizeof (target) - 1);
+			if (len >= 0) {
+				target[len] = '\0';
+				ret = symlink (target, dst_path.c_str ()) == 0;
+			} else {
+				ret = false;
+			}
+		} else if (S_ISREG (st.st_mode)) {
+			ret = zypp_sync_cache_file (src_path, old_path, dst_path, st, stats);
+		}
+	}
+	closedir (dir);
+	return ret;
+}
+
+/**
+  * make the cache dst a copy of src without writing what is already there:
+  * the copy is built next to dst from hardlinks to the unchanged files of
+  * dst, reflinks or copies of the others, and then swapped with dst
+  */
+static bool
+zypp_sync_cache (const Pathname &src, const Pathname &dst)
+{
+	CacheSyncStats stats;
+	string staging = dst.asString () + ".sync";
+	struct stat st;
+
+	// left behind by an interrupted sync
+	zypp::filesystem::recursive_rmdir (staging);
+
+	if (stat (src.c_str (), &st) != 0 ||
+	    mkdir (staging.c_str (), st.st_mode & 07777) != 0 ||
+	    !zypp_sync_cache_dir (src.asString (), dst.asString (), staging, stats)) {
+		zypp::filesystem::recursive_rmdir (staging);
+		return false;
+	}
+
+#if defined(SYS_renameat2) && defined(RENAME_EXCHANGE)
+	if (syscall (SYS_renameat2, AT_FDCWD, staging.c_str (), AT_FDCWD, dst.c_str (), RENAME_EXCHANGE) != 0)
+#endif
+	{
+		// no atomic exchange, there is a short moment without dst
+		string previous = dst.asString () + ".old";
+		zypp::filesystem::recursive_rmdir (previous);
+		if ((rename (dst.c_str (), previous.c_str ()) != 0 && errno != ENOENT) ||
+		    rename (staging.c_str (), dst.c_str ()) != 0) {
+			ERR << "Cannot replace " << dst << ": " << strerror (errno) << std::endl;
+			zypp::filesystem::recursive_rmdir (staging);
+			return false;
+		}
+		staging = previous;
+	}
+	zypp::filesystem::recursive_rmdir (staging);
+
+	LOG << "Synced " << src << " to " << dst << ": "
+	    << stats.copied << " bytes copied, "
+	    << stats.cloned << " bytes reflinked, "
+	    << stats.unchanged << " bytes unchanged" << std::endl;
+	return true;
+}
+
 static void
 backend_upgrade_system_thread (PkBackendJob *job,
 			       GVariant *params,
@@ -4542,9 +5640,7 @@ backend_upgrade_system_thread (PkBackendJob *job,
 	if (sync_cache) {
 		LOG  << "Updating regular zypp cache" << std::endl;
 		// Copy, not move, because it may be called repeatedly!
-		if (zypp::filesystem::erase(REGULAR_CACHE_PATH) != 0
-		    || zypp::filesystem::mkdir(REGULAR_CACHE_PATH) != 0
-		    || zypp::filesystem::copy_dir_content(DIST_UPGRADE_CACHE_PATH, REGULAR_CACHE_PATH) != 0) {
+		if (!zypp_sync_cache (DIST_UPGRADE_CACHE_PATH, REGULAR_CACHE_PATH)) {
 			LOG << "Failed to update the regular zypp cache" << std::endl;
 		}
 	}
@@ -4862,8 +5958,15 @@ backend_download_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 
 	try
 	{
-		ResPool pool = zypp_build_pool (zypp, FALSE);
+		// the installed packages are the base versions of the deltas
+		ResPool pool = zypp_build_pool (zypp, TRUE);
+		const DeltaIndex deltas;
 
+		// the download report and the applied deltas count against these
+		priv->exec.reset ();
+		priv->exec.total_downloads = g_strv_length (package_ids);
+		priv->deltas.clear ();
+		priv->delta_savings = 0;
 		pk_backend_job_set_status (job, PK_STATUS_ENUM_DOWNLOAD);
 		for (guint i = 0; package_ids[i]; i++) {
 			sat::Solvable solvable = zypp_get_package_by_id (package_ids[i]);
@@ -4885,7 +5988,8 @@ backend_download_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 
 			PoolItem item(solvable);
 			repo::RepoMediaAccess access;
-			repo::DeltaCandidates deltas;
+			packagedelta::DeltaRpm delta;
+			bool use_delta = false;
 			ManagedFile tmp_file;
 			if (isKind<SrcPackage>(solvable)) {
 				SrcPackage::constPtr package = asKind<SrcPackage>(item.resolvable());
@@ -4893,7 +5997,9 @@ backend_download_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 				tmp_file = pkgProvider.provideSrcPackage(package);
 			} else {
 				Package::constPtr package = asKind<Package>(item.resolvable());
-				repo::PackageProvider pkgProvider(access, package, deltas);
+				use_delta = zypp_find_delta (deltas, item, delta);
+				repo::DeltaCandidates candidates = deltas.candidates (solvable);
+				repo::PackageProvider pkgProvider(access, package, candidates);
 				tmp_file = pkgProvider.providePackage();
 			}
 			string target = tmpDir;
@@ -4904,7 +6010,13 @@ backend_download_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 			const gchar *to_strv[] = { NULL, NULL };
 			to_strv[0] =  target.c_str();
 			pk_backend_job_files (job, package_ids[i],(gchar **) to_strv);
-			pk_backend_job_package (job, PK_INFO_ENUM_DOWNLOADING, package_ids[i], item->summary ().c_str());
+			// a package built from a delta was already reported when it was applied
+			if (!use_delta || priv->deltas.count (delta.location ().filename ().basename ()) > 0)
+				pk_backend_job_package (job, PK_INFO_ENUM_DOWNLOADING, package_ids[i], item->summary ().c_str());
+		}
+
+		if (priv->delta_savings > 0) {
+			zypp_send_size_details (job, "::DELTA_SAVINGS", priv->delta_savings);
 		}
 	} catch (const Exception &ex) {
 		zypp_backend_finished_error (
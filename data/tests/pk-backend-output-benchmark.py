@@ -0,0 +1,74 @@
+#!/usr/bin/python3
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+# Micro-benchmark for the output of the python backends: emits 100k
+# packages into a pipe, once writing every line on its own and once
+# batched, and counts how often the reading end (the daemon) wakes up.
+
+import sys
+import os
+import threading
+import time
+
+sys.path.insert(0,os.path.join(os.getcwd(), 'lib', 'python'))
+
+from packagekit.backend import *
+
+PACKAGES = 100000
+
+class BenchmarkBackend(PackageKitBaseBackend):
+    def get_packages(self, filters):
+        for i in range(PACKAGES):
+            if i % 1000 == 0:
+                self.percentage(i * 100 // PACKAGES)
+            self.package("bench%i;1.0-1;x86_64;data" % i, INFO_AVAILABLE, "Benchmark package %i" % i)
+
+def drain(fd, stats):
+    while True:
+        data = os.read(fd, 65536)
+        if not data:
+            break
+        stats['reads'] += 1
+        stats['bytes'] += len(data)
+
+def run(max_size):
+    rfd, wfd = os.pipe()
+    stats = {'reads': 0, 'bytes': 0}
+    reader = threading.Thread(target=drain, args=(rfd, stats))
+    reader.start()
+
+    stream = os.fdopen(wfd, 'w')
+    backend = BenchmarkBackend('')
+    backend._output = BufferedOutput(stream, max_size=max_size)
+
+    start = time.monotonic()
+    backend.get_packages([FILTER_NONE])
+    backend.finished()
+    elapsed = time.monotonic() - start
+
+    stream.close()
+    reader.join()
+    os.close(rfd)
+    print("%-10s %8.1f ms %8i reads %10i bytes" % (
+        "unbuffered" if max_size == 0 else "buffered",
+        elapsed * 1000, stats['reads'], stats['bytes']))
+
+def main():
+    os.environ.setdefault('LANG', 'C')
+    os.environ.setdefault('NETWORK', 'FALSE')
+    os.environ.setdefault('UID', str(os.getuid()))
+    os.environ.setdefault('BACKGROUND', 'FALSE')
+    os.environ.setdefault('INTERACTIVE', 'FALSE')
+    run(0)
+    run(16384)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/python3
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+# Compares the latency of a Resolve on a newly started dispatcher with one
+# on a persistent dispatcher that is reset to the environment of the next
+# transaction, like the daemon does for backends with persistent workers.
+# Only the cost of the interpreter and packagekit.backend is measured here,
+# a real backend adds the import of its package manager on top.
+
+import sys
+import os
+import subprocess
+import time
+
+sys.path.insert(0,os.path.join(os.getcwd(), 'lib', 'python'))
+
+RUNS = 20
+
+def environment(uid):
+    return {'LANG': 'C', 'NETWORK': 'TRUE', 'BACKGROUND': 'FALSE',
+            'INTERACTIVE': 'FALSE', 'UID': str(uid)}
+
+def worker():
+    from packagekit.backend import PackageKitBaseBackend, INFO_AVAILABLE
+
+    class WorkerBackend(PackageKitBaseBackend):
+        def resolve(self, filters, values):
+            for value in values:
+                self.package("%s;1.0-1;x86_64;data" % value, INFO_AVAILABLE, value)
+
+    WorkerBackend('').dispatcher(sys.argv[2:])
+
+def wait_finished(proc):
+    for line in proc.stdout:
+        if line == 'finished\n':
+            return
+    raise RuntimeError('dispatcher exited')
+
+def start(args, uid):
+    return subprocess.Popen([sys.executable, __file__, '--worker'] + args,
+                            env=environment(uid), cwd=os.getcwd(),
+                            stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            universal_newlines=True, bufsize=1)
+
+def cold():
+    start_time = time.monotonic()
+    proc = start(['resolve', 'none', 'bash'], 0)
+    wait_finished(proc)
+    elapsed = time.monotonic() - start_time
+    proc.communicate('exit\n')
+    return elapsed
+
+def warm(proc, uid):
+    env = '\t'.join('%s=%s' % item for item in sorted(environment(uid).items()))
+    start_time = time.monotonic()
+    proc.stdin.write('reset\t%s\nresolve\tnone\tbash\n' % env)
+    proc.stdin.flush()
+    wait_finished(proc)
+    return time.monotonic() - start_time
+
+def report(name, samples):
+    samples = sorted(samples)
+    print("%-5s median %7.2f ms  min %7.2f ms  max %7.2f ms" % (
+        name, samples[len(samples) // 2] * 1000, samples[0] * 1000, samples[-1] * 1000))
+
+def main():
+    report('cold', [cold() for i in range(RUNS)])
+
+    proc = start(['resolve', 'none', 'bash'], 0)
+    wait_finished(proc)
+    report('warm', [warm(proc, 1000 + i) for i in range(RUNS)])
+    proc.communicate('exit\n')
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1 and sys.argv[1] == '--worker':
+        worker()
+    else:
+        main()
@@ -0,0 +1,183 @@
+#!/usr/bin/python3
+# Licensed under the GNU General Public License Version 2
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+# Checks PackagekitFilter against the per-package implementation it
+# replaced, on randomized package lists and filter combinations.
+
+import sys
+import os
+import collections
+import random
+import unittest
+
+sys.path.insert(0,os.path.join(os.getcwd(), 'lib', 'python'))
+
+from packagekit.enums import *
+from packagekit.filter import PackagekitFilter
+
+FILTERS = [FILTER_INSTALLED, FILTER_NOT_INSTALLED, FILTER_GUI, FILTER_NOT_GUI,
+           FILTER_DEVELOPMENT, FILTER_NOT_DEVELOPMENT, FILTER_FREE,
+           FILTER_NOT_FREE, FILTER_ARCH, FILTER_NOT_ARCH, FILTER_NEWEST]
+
+class TestFilter(PackagekitFilter):
+    ''' packages are package ids, with the properties kept in the data '''
+
+    def _pkg_compare(self, pkg1, pkg2):
+        ver1 = int(pkg1.split(';')[1])
+        ver2 = int(pkg2.split(';')[1])
+        if ver1 == ver2:
+            return 0
+        return 1 if ver1 > ver2 else -1
+
+    def _pkg_get_name(self, pkg):
+        return pkg.split(';')[0]
+
+    def _pkg_is_installed(self, pkg):
+        return pkg.split(';')[3].startswith('installed')
+
+    def _pkg_is_devel(self, pkg):
+        return pkg.split(';')[0].endswith('-devel')
+
+    def _pkg_is_gui(self, pkg):
+        return 'gui' in pkg.split(';')[3]
+
+    def _pkg_is_free(self, pkg):
+        return 'nonfree' not in pkg.split(';')[3]
+
+    def _pkg_is_arch(self, pkg):
+        return pkg.split(';')[2] == 'x86_64'
+
+class ReferenceFilter(TestFilter):
+    ''' the filtering as it was done one package and filter at a time '''
+
+    def _filter_base(self, pkg):
+        for flt in self.fltlist:
+            if flt in (FILTER_GUI, FILTER_NOT_GUI):
+                if not self._do_gui_filtering(flt, pkg):
+                    return False
+            elif flt in (FILTER_DEVELOPMENT, FILTER_NOT_DEVELOPMENT):
+                if not self._do_devel_filtering(flt, pkg):
+                    return False
+            elif flt in (FILTER_FREE, FILTER_NOT_FREE):
+                if not self._do_free_filtering(flt, pkg):
+                    return False
+            elif flt in (FILTER_ARCH, FILTER_NOT_ARCH):
+                if not self._do_arch_filtering(flt, pkg):
+                    return False
+        return True
+
+    def _filter_installed(self, pkg):
+        for flt in self.fltlist:
+            if flt in (FILTER_INSTALLED, FILTER_NOT_INSTALLED):
+                if not self._do_installed_filtering(flt, pkg):
+                    return False
+        return True
+
+    def get_package_list(self):
+        package_list = self.package_list
+        self.package_list = []
+        for pkg, state in package_list:
+            if self._filter_base(pkg):
+                self.package_list.append((pkg, state))
+
+        installed_dict = collections.defaultdict(list)
+        for pkg, state in self.package_list:
+            if state is INFO_INSTALLED:
+                installed_dict[self._pkg_get_name(pkg)].append(pkg)
+
+        package_list = self.package_list
+        self.package_list = []
+        for pkg, state in package_list:
+            add = True
+            if state is INFO_AVAILABLE:
+                for pkg_tmp in installed_dict[self._pkg_get_name(pkg)]:
+                    rc = self._pkg_compare(pkg, pkg_tmp)
+                    if rc == 0 or rc == -1:
+                        add = False
+                        break
+            if add:
+                self.package_list.append((pkg, state))
+
+        package_list = self.package_list
+        self.package_list = []
+        for pkg, state in package_list:
+            if self._filter_installed(pkg):
+                self.package_list.append((pkg, state))
+
+        return self.post_process()
+
+def random_package(rand, installed):
+    name = 'pkg%i' % rand.randrange(50)
+    if rand.random() < 0.2:
+        name += '-devel'
+    data = ['installed' if installed else 'repo']
+    if rand.random() < 0.3:
+        data.append('gui')
+    if rand.random() < 0.2:
+        data.append('nonfree')
+    return '%s;%i;%s;%s' % (name, rand.randrange(5),
+                            rand.choice(['x86_64', 'noarch', 'i686']), ':'.join(data))
+
+def run_filter(cls, fltlist, installed, available, custom):
+    flt = cls(fltlist)
+    flt.add_installed(installed)
+    flt.add_available(available)
+    for pkg, info in custom:
+        flt.add_custom(pkg, info)
+    return flt.get_package_list()
+
+class FilterTest(unittest.TestCase):
+
+    def compare(self, rand, fltlist):
+        installed = [random_package(rand, True) for i in range(rand.randrange(100))]
+        available = [random_package(rand, False) for i in range(rand.randrange(200))]
+        custom = [(random_package(rand, False), INFO_UPDATING) for i in range(rand.randrange(10))]
+        self.assertEqual(run_filter(PackagekitFilter, fltlist, installed, available, custom),
+                         run_filter(PackagekitFilter, fltlist, installed, available, custom))
+        self.assertEqual(run_filter(TestFilter, fltlist, installed, available, custom),
+                         run_filter(ReferenceFilter, fltlist, installed, available, custom),
+                         'filters %s' % ';'.join(fltlist))
+
+    def test_randomized(self):
+        rand = random.Random(4242)
+        for i in range(500):
+            self.compare(rand, rand.sample(FILTERS, rand.randrange(len(FILTERS))))
+
+    def test_no_filter(self):
+        rand = random.Random(1)
+        for fltlist in ([FILTER_NONE], "none", []):
+            self.compare(rand, fltlist)
+
+    def test_conflicting_filters(self):
+        rand = random.Random(2)
+        for fltlist in ([FILTER_INSTALLED, FILTER_NOT_INSTALLED],
+                        [FILTER_GUI, FILTER_ARCH, FILTER_NOT_GUI],
+                        [FILTER_FREE, FILTER_FREE, FILTER_NOT_DEVELOPMENT]):
+            self.compare(rand, fltlist)
+
+    def test_downgrades(self):
+        flt = TestFilter([FILTER_NONE])
+        flt.add_installed(['foo;2;x86_64;installed'])
+        flt.add_available(['foo;1;x86_64;repo', 'foo;2;x86_64;repo',
+                           'foo;3;x86_64;repo', 'bar;1;x86_64;repo'])
+        self.assertEqual(flt.get_package_list(),
+                         [('foo;2;x86_64;installed', INFO_INSTALLED),
+                          ('foo;3;x86_64;repo', INFO_AVAILABLE),
+                          ('bar;1;x86_64;repo', INFO_AVAILABLE)])
+
+if __name__ == "__main__":
+    unittest.main()
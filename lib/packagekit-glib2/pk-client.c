@@ -38,12 +38,14 @@
 
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-client-helper.h>
+#include <packagekit-glib2/pk-client-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-control.h>
 #include <packagekit-glib2/pk-debug.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
+#include <packagekit-glib2/pk-source-private.h>
 
 static void     pk_client_finalize	(GObject     *object);
 
@@ -66,6 +68,8 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	guint			 cache_age;
+	gboolean		 stream_results;
+	gchar			*plan_token;
 };
 
 enum {
@@ -75,6 +79,7 @@ enum {
 	PROP_INTERACTIVE,
 	PROP_IDLE,
 	PROP_CACHE_AGE,
+	PROP_STREAM_RESULTS,
 	PROP_LAST
 };
 
@@ -174,6 +179,7 @@ struct _PkClientState
 	PkClientHelper			*client_helper;
 	gboolean			 waiting_for_finished;
 	gchar				*key_file;
+	gchar				*plan_token;
 };
 
 G_DEFINE_TYPE (PkClientState, pk_client_state, G_TYPE_OBJECT)
@@ -283,6 +289,7 @@ pk_client_state_finalize (GObject *object)
 	g_free (state->tid);
 	g_free (state->distro_id);
 	g_free (state->transaction_id);
+	g_free (state->plan_token);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
 	/* results will not exist if the CreateTransaction fails */
@@ -379,6 +386,7 @@ pk_client_state_new (PkClient *client,
 	state->res = g_simple_async_result_new (G_OBJECT (client), callback_ready, user_data, source_tag);
 	state->client = g_object_ref (client);
 	state->cancellable = g_cancellable_new ();
+	state->plan_token = g_strdup (client->priv->plan_token);
 
 	if (cancellable != NULL) {
 		state->cancellable_client = g_object_ref (cancellable);
@@ -427,6 +435,9 @@ pk_client_get_property (GObject *object, guint prop_id, GValue *value, GParamSpe
 	case PROP_CACHE_AGE:
 		g_value_set_uint (value, priv->cache_age);
 		break;
+	case PROP_STREAM_RESULTS:
+		g_value_set_boolean (value, priv->stream_results);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -456,6 +467,9 @@ pk_client_set_property (GObject *object, guint prop_id, const GValue *value, GPa
 	case PROP_CACHE_AGE:
 		priv->cache_age = g_value_get_uint (value);
 		break;
+	case PROP_STREAM_RESULTS:
+		priv->stream_results = g_value_get_boolean (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -876,13 +890,11 @@ pk_client_signal_package (PkClientState *state,
 		g_warning ("failed to set package id for %s", package_id);
 		return;
 	}
-	g_object_set (package,
-		      "info", info_enum,
-		      "summary", summary,
-		      "update-severity", update_severity,
-		      "role", state->role,
-		      "transaction-id", state->transaction_id,
-		      NULL);
+	pk_package_set_info (package, info_enum);
+	pk_package_set_summary (package, summary);
+	pk_package_set_update_severity (package, update_severity);
+	pk_source_set_role (PK_SOURCE (package), state->role);
+	pk_source_set_transaction_id (PK_SOURCE (package), state->transaction_id);
 
 	/* add to results */
 	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
@@ -2225,6 +2237,18 @@ pk_client_get_proxy_cb (GObject *object,
 		g_ptr_array_add (array, hint);
 	}
 
+	/* stream-results */
+	if (state->client->priv->stream_results) {
+		hint = g_strdup ("stream-results=true");
+		g_ptr_array_add (array, hint);
+	}
+
+	/* plan-token */
+	if (state->plan_token != NULL) {
+		hint = g_strdup_printf ("plan-token=%s", state->plan_token);
+		g_ptr_array_add (array, hint);
+	}
+
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
 	    state->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
@@ -4566,6 +4590,64 @@ pk_client_get_cache_age (PkClient *client)
 	return client->priv->cache_age;
 }
 
+/**
+ * pk_client_set_stream_results:
+ * @client: a valid #PkClient instance
+ * @stream_results: the value to set
+ *
+ * Sets if query results may arrive in any order. The backend can then send
+ * packages as soon as it finds them rather than sending all installed
+ * packages first. An available package may then be followed by the same
+ * package as installed, and the installed one should be preferred.
+ *
+ * Since: 1.2.6
+ **/
+void
+pk_client_set_stream_results (PkClient *client, gboolean stream_results)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	if (client->priv->stream_results == stream_results)
+		return;
+
+	client->priv->stream_results = stream_results;
+	g_object_notify (G_OBJECT (client), "stream-results");
+}
+
+/**
+ * pk_client_get_stream_results:
+ * @client: a valid #PkClient instance
+ *
+ * Gets if query results may arrive in any order.
+ *
+ * Return value: %TRUE if results are streamed
+ *
+ * Since: 1.2.6
+ **/
+gboolean
+pk_client_get_stream_results (PkClient *client)
+{
+	g_return_val_if_fail (PK_IS_CLIENT (client), FALSE);
+	return client->priv->stream_results;
+}
+
+/*
+ * pk_client_set_plan_token:
+ * @client: a valid #PkClient instance
+ * @plan_token: an opaque token, or %NULL
+ *
+ * Sets the plan token sent as a hint with transactions created from now on.
+ * The token is captured when the async method is called, so it can be
+ * cleared again straight after without affecting the in-flight request.
+ **/
+void
+pk_client_set_plan_token (PkClient *client, const gchar *plan_token)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+	g_free (client->priv->plan_token);
+	client->priv->plan_token = g_strdup (plan_token);
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4629,6 +4711,16 @@ pk_client_class_init (PkClientClass *klass)
 				   0, G_MAXUINT, 0,
 				   G_PARAM_READWRITE);
 	g_object_class_install_property (object_class, PROP_CACHE_AGE, pspec);
+
+	/**
+	 * PkClient:stream-results:
+	 *
+	 * Since: 1.2.6
+	 */
+	pspec = g_param_spec_boolean ("stream-results", NULL, NULL,
+				      FALSE,
+				      G_PARAM_READWRITE);
+	g_object_class_install_property (object_class, PROP_STREAM_RESULTS, pspec);
 }
 
 /*
@@ -4664,6 +4756,7 @@ pk_client_finalize (GObject *object)
 	pk_client_cancel_all_dbus_methods (client);
 
 	g_free (client->priv->locale);
+	g_free (client->priv->plan_token);
 	g_object_unref (priv->control);
 	g_ptr_array_unref (priv->calls);
 
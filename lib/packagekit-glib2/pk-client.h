@@ -431,6 +431,9 @@ gboolean	 pk_client_get_idle			(PkClient		*client);
 void		 pk_client_set_cache_age		(PkClient		*client,
 							 guint			 cache_age);
 guint		 pk_client_get_cache_age		(PkClient		*client);
+void		 pk_client_set_stream_results		(PkClient		*client,
+							 gboolean		 stream_results);
+gboolean	 pk_client_get_stream_results		(PkClient		*client);
 
 G_END_DECLS
 
@@ -32,6 +32,11 @@ G_BEGIN_DECLS
 
 gchar		*pk_get_distro_name			(GError		**error);
 gchar		*pk_get_distro_version_id		(GError		**error);
+void		 pk_sort_array				(gpointer	 array,
+							 gsize		 n_elements,
+							 gsize		 element_size,
+							 GCompareDataFunc compare_func,
+							 gpointer	 user_data);
 
 G_END_DECLS
 
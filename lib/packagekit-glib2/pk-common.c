@@ -362,3 +362,28 @@ pk_get_distro_version_id (GError **error)
 
 	return version_id;
 }
+
+/**
+ * pk_sort_array:
+ * @array: the array to sort
+ * @n_elements: the number of elements in @array
+ * @element_size: the size of one element
+ * @compare_func: the function to compare two elements
+ * @user_data: data to pass to @compare_func
+ *
+ * Sorts @array in place, keeping the order of equal elements. This is
+ * g_sort_array() where GLib has it, g_qsort_with_data() is deprecated there.
+ **/
+void
+pk_sort_array (gpointer array,
+	       gsize n_elements,
+	       gsize element_size,
+	       GCompareDataFunc compare_func,
+	       gpointer user_data)
+{
+#if GLIB_CHECK_VERSION(2, 82, 0)
+	g_sort_array (array, n_elements, element_size, compare_func, user_data);
+#else
+	g_qsort_with_data (array, n_elements, element_size, compare_func, user_data);
+#endif
+}
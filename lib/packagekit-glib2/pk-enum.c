@@ -34,8 +34,20 @@
 #include <glib/gi18n.h>
 
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-enum.h>
 
+/* lookup tables built once from a PkEnumMatch table */
+typedef struct {
+	guint			*by_string;	/* table indexes sorted by string */
+	guint			 n_strings;
+	guint			*by_value;	/* table index for each value */
+	guint			 n_values;
+} PkEnumIndex;
+
+/* values beyond this are looked up by scanning the table */
+#define PK_ENUM_INDEX_MAX_VALUE		1024
+
 static const PkEnumMatch enum_exit[] = {
 	{PK_EXIT_ENUM_UNKNOWN,			"unknown"},	/* fall though value */
 	{PK_EXIT_ENUM_SUCCESS,			"success"},
@@ -51,6 +63,7 @@ static const PkEnumMatch enum_exit[] = {
 	{PK_EXIT_ENUM_REPAIR_REQUIRED,		"repair-required"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_exit_index = NULL;
 
 static const PkEnumMatch enum_status[] = {
 	{PK_STATUS_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -92,6 +105,7 @@ static const PkEnumMatch enum_status[] = {
 	{PK_STATUS_ENUM_RUN_HOOK,		"run-hook"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_status_index = NULL;
 
 static const PkEnumMatch enum_role[] = {
 	{PK_ROLE_ENUM_UNKNOWN,				"unknown"},	/* fall though value */
@@ -132,6 +146,7 @@ static const PkEnumMatch enum_role[] = {
 	{PK_ROLE_ENUM_REMOVE_PUBKEY,			"remove-pubkey"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_role_index = NULL;
 
 static const PkEnumMatch enum_error[] = {
 	{PK_ERROR_ENUM_UNKNOWN,			"unknown"},	/* fall though value */
@@ -205,6 +220,7 @@ static const PkEnumMatch enum_error[] = {
 	{PK_ERROR_ENUM_REPO_ALREADY_SET,	"repo-already-set"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_error_index = NULL;
 
 static const PkEnumMatch enum_restart[] = {
 	{PK_RESTART_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -216,6 +232,7 @@ static const PkEnumMatch enum_restart[] = {
 	{PK_RESTART_ENUM_SECURITY_SESSION,	"security-session"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_restart_index = NULL;
 
 static const PkEnumMatch enum_filter[] = {
 	{PK_FILTER_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -248,6 +265,7 @@ static const PkEnumMatch enum_filter[] = {
 	{PK_FILTER_ENUM_NOT_DOWNLOADED,		"~downloaded"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_filter_index = NULL;
 
 static const PkEnumMatch enum_group[] = {
 	{PK_GROUP_ENUM_UNKNOWN,			"unknown"},	/* fall though value */
@@ -287,6 +305,7 @@ static const PkEnumMatch enum_group[] = {
 	{PK_GROUP_ENUM_NEWEST,			"newest"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_group_index = NULL;
 
 static const PkEnumMatch enum_update_state[] = {
 	{PK_UPDATE_STATE_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -295,6 +314,7 @@ static const PkEnumMatch enum_update_state[] = {
 	{PK_UPDATE_STATE_ENUM_STABLE,		"stable"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_update_state_index = NULL;
 
 static const PkEnumMatch enum_info[] = {
 	{PK_INFO_ENUM_UNKNOWN,			"unknown"},	/* fall though value */
@@ -326,12 +346,14 @@ static const PkEnumMatch enum_info[] = {
 	{PK_INFO_ENUM_CRITICAL,			"critical"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_info_index = NULL;
 
 static const PkEnumMatch enum_sig_type[] = {
 	{PK_SIGTYPE_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
 	{PK_SIGTYPE_ENUM_GPG,			"gpg"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_sig_type_index = NULL;
 
 static const PkEnumMatch enum_upgrade[] = {
 	{PK_DISTRO_UPGRADE_ENUM_UNKNOWN,	"unknown"},	/* fall though value */
@@ -339,6 +361,7 @@ static const PkEnumMatch enum_upgrade[] = {
 	{PK_DISTRO_UPGRADE_ENUM_UNSTABLE,		"unstable"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_upgrade_index = NULL;
 
 static const PkEnumMatch enum_network[] = {
 	{PK_NETWORK_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -349,6 +372,7 @@ static const PkEnumMatch enum_network[] = {
 	{PK_NETWORK_ENUM_MOBILE,		"mobile"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_network_index = NULL;
 
 static const PkEnumMatch enum_media_type[] = {
 	{PK_MEDIA_TYPE_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -357,6 +381,7 @@ static const PkEnumMatch enum_media_type[] = {
 	{PK_MEDIA_TYPE_ENUM_DISC,		"disc"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_media_type_index = NULL;
 
 static const PkEnumMatch enum_authorize_type[] = {
 	{PK_AUTHORIZE_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -365,6 +390,7 @@ static const PkEnumMatch enum_authorize_type[] = {
 	{PK_AUTHORIZE_ENUM_INTERACTIVE,		"interactive"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_authorize_type_index = NULL;
 
 static const PkEnumMatch enum_upgrade_kind[] = {
 	{PK_UPGRADE_KIND_ENUM_UNKNOWN,		"unknown"},	/* fall though value */
@@ -373,6 +399,7 @@ static const PkEnumMatch enum_upgrade_kind[] = {
 	{PK_UPGRADE_KIND_ENUM_COMPLETE,		"complete"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_upgrade_kind_index = NULL;
 
 static const PkEnumMatch enum_transaction_flag[] = {
 	{PK_TRANSACTION_FLAG_ENUM_NONE,			"none"},	/* fall though value */
@@ -385,6 +412,7 @@ static const PkEnumMatch enum_transaction_flag[] = {
 	{PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE,    "download-size"},
 	{0, NULL}
 };
+static PkEnumIndex *enum_transaction_flag_index = NULL;
 
 /**
  * pk_enum_find_value:
@@ -443,6 +471,108 @@ pk_enum_find_string (const PkEnumMatch *table, guint value)
 	return table[0].string;
 }
 
+/*
+ * pk_enum_index_compare_cb:
+ **/
+static gint
+pk_enum_index_compare_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const PkEnumMatch *table = user_data;
+	return strcmp (table[*(const guint *) a].string,
+		       table[*(const guint *) b].string);
+}
+
+/*
+ * pk_enum_index_ensure:
+ *
+ * Builds the index for @table the first time it is needed. The string
+ * index is sorted with a stable sort and the value index keeps the first
+ * entry for each value, so both return what a scan of the table would.
+ **/
+static const PkEnumIndex *
+pk_enum_index_ensure (PkEnumIndex **index_ptr, const PkEnumMatch *table)
+{
+	PkEnumIndex *index;
+	guint i;
+
+	if (g_once_init_enter (index_ptr)) {
+		index = g_new0 (PkEnumIndex, 1);
+		while (table[index->n_strings].string != NULL) {
+			if (table[index->n_strings].value < PK_ENUM_INDEX_MAX_VALUE)
+				index->n_values = MAX (index->n_values, table[index->n_strings].value + 1);
+			index->n_strings++;
+		}
+
+		index->by_string = g_new (guint, index->n_strings);
+		for (i = 0; i < index->n_strings; i++)
+			index->by_string[i] = i;
+		pk_sort_array (index->by_string, index->n_strings, sizeof (guint),
+			       pk_enum_index_compare_cb, (gpointer) table);
+
+		/* G_MAXUINT means the value is not in the table */
+		index->by_value = g_new (guint, index->n_values);
+		for (i = 0; i < index->n_values; i++)
+			index->by_value[i] = G_MAXUINT;
+		for (i = index->n_strings; i > 0; i--) {
+			if (table[i - 1].value < index->n_values)
+				index->by_value[table[i - 1].value] = i - 1;
+		}
+		g_once_init_leave (index_ptr, index);
+	}
+	return *index_ptr;
+}
+
+/*
+ * pk_enum_index_find_value:
+ *
+ * Like pk_enum_find_value() but using a binary search.
+ **/
+static guint
+pk_enum_index_find_value (PkEnumIndex **index_ptr, const PkEnumMatch *table, const gchar *string)
+{
+	const PkEnumIndex *index;
+	guint lower = 0;
+	guint upper;
+
+	/* return the first entry on non-found or error */
+	if (string == NULL)
+		return table[0].value;
+
+	/* find the first entry that is not less than the string */
+	index = pk_enum_index_ensure (index_ptr, table);
+	upper = index->n_strings;
+	while (lower < upper) {
+		guint middle = lower + (upper - lower) / 2;
+		if (strcmp (table[index->by_string[middle]].string, string) < 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	if (lower < index->n_strings &&
+	    strcmp (table[index->by_string[lower]].string, string) == 0)
+		return table[index->by_string[lower]].value;
+	return table[0].value;
+}
+
+/*
+ * pk_enum_index_find_string:
+ *
+ * Like pk_enum_find_string() but indexed by value.
+ **/
+static const gchar *
+pk_enum_index_find_string (PkEnumIndex **index_ptr, const PkEnumMatch *table, guint value)
+{
+	const PkEnumIndex *index;
+
+	index = pk_enum_index_ensure (index_ptr, table);
+	if (value < index->n_values) {
+		if (index->by_value[value] == G_MAXUINT)
+			return table[0].string;
+		return table[index->by_value[value]].string;
+	}
+	return pk_enum_find_string (table, value);
+}
+
 /**
  * pk_sig_type_enum_from_string:
  * @sig_type: Text describing the enumerated type
@@ -454,7 +584,7 @@ pk_enum_find_string (const PkEnumMatch *table, guint value)
 PkSigTypeEnum
 pk_sig_type_enum_from_string (const gchar *sig_type)
 {
-	return pk_enum_find_value (enum_sig_type, sig_type);
+	return pk_enum_index_find_value (&enum_sig_type_index, enum_sig_type, sig_type);
 }
 
 /**
@@ -470,7 +600,7 @@ pk_sig_type_enum_from_string (const gchar *sig_type)
 const gchar *
 pk_sig_type_enum_to_string (PkSigTypeEnum sig_type)
 {
-	return pk_enum_find_string (enum_sig_type, sig_type);
+	return pk_enum_index_find_string (&enum_sig_type_index, enum_sig_type, sig_type);
 }
 
 /**
@@ -486,7 +616,7 @@ pk_sig_type_enum_to_string (PkSigTypeEnum sig_type)
 PkDistroUpgradeEnum
 pk_distro_upgrade_enum_from_string (const gchar *upgrade)
 {
-	return pk_enum_find_value (enum_upgrade, upgrade);
+	return pk_enum_index_find_value (&enum_upgrade_index, enum_upgrade, upgrade);
 }
 
 /**
@@ -502,7 +632,7 @@ pk_distro_upgrade_enum_from_string (const gchar *upgrade)
 const gchar *
 pk_distro_upgrade_enum_to_string (PkDistroUpgradeEnum upgrade)
 {
-	return pk_enum_find_string (enum_upgrade, upgrade);
+	return pk_enum_index_find_string (&enum_upgrade_index, enum_upgrade, upgrade);
 }
 
 /**
@@ -518,7 +648,7 @@ pk_distro_upgrade_enum_to_string (PkDistroUpgradeEnum upgrade)
 PkInfoEnum
 pk_info_enum_from_string (const gchar *info)
 {
-	return pk_enum_find_value (enum_info, info);
+	return pk_enum_index_find_value (&enum_info_index, enum_info, info);
 }
 
 /**
@@ -534,7 +664,7 @@ pk_info_enum_from_string (const gchar *info)
 const gchar *
 pk_info_enum_to_string (PkInfoEnum info)
 {
-	return pk_enum_find_string (enum_info, info);
+	return pk_enum_index_find_string (&enum_info_index, enum_info, info);
 }
 
 /**
@@ -550,7 +680,7 @@ pk_info_enum_to_string (PkInfoEnum info)
 PkExitEnum
 pk_exit_enum_from_string (const gchar *exit_text)
 {
-	return pk_enum_find_value (enum_exit, exit_text);
+	return pk_enum_index_find_value (&enum_exit_index, enum_exit, exit_text);
 }
 
 /**
@@ -566,7 +696,7 @@ pk_exit_enum_from_string (const gchar *exit_text)
 const gchar *
 pk_exit_enum_to_string (PkExitEnum exit_enum)
 {
-	return pk_enum_find_string (enum_exit, exit_enum);
+	return pk_enum_index_find_string (&enum_exit_index, enum_exit, exit_enum);
 }
 
 /**
@@ -582,7 +712,7 @@ pk_exit_enum_to_string (PkExitEnum exit_enum)
 PkNetworkEnum
 pk_network_enum_from_string (const gchar *network)
 {
-	return pk_enum_find_value (enum_network, network);
+	return pk_enum_index_find_value (&enum_network_index, enum_network, network);
 }
 
 /**
@@ -598,7 +728,7 @@ pk_network_enum_from_string (const gchar *network)
 const gchar *
 pk_network_enum_to_string (PkNetworkEnum network)
 {
-	return pk_enum_find_string (enum_network, network);
+	return pk_enum_index_find_string (&enum_network_index, enum_network, network);
 }
 
 /**
@@ -614,7 +744,7 @@ pk_network_enum_to_string (PkNetworkEnum network)
 PkStatusEnum
 pk_status_enum_from_string (const gchar *status)
 {
-	return pk_enum_find_value (enum_status, status);
+	return pk_enum_index_find_value (&enum_status_index, enum_status, status);
 }
 
 /**
@@ -630,7 +760,7 @@ pk_status_enum_from_string (const gchar *status)
 const gchar *
 pk_status_enum_to_string (PkStatusEnum status)
 {
-	return pk_enum_find_string (enum_status, status);
+	return pk_enum_index_find_string (&enum_status_index, enum_status, status);
 }
 
 /**
@@ -646,7 +776,7 @@ pk_status_enum_to_string (PkStatusEnum status)
 PkRoleEnum
 pk_role_enum_from_string (const gchar *role)
 {
-	return pk_enum_find_value (enum_role, role);
+	return pk_enum_index_find_value (&enum_role_index, enum_role, role);
 }
 
 /**
@@ -662,7 +792,7 @@ pk_role_enum_from_string (const gchar *role)
 const gchar *
 pk_role_enum_to_string (PkRoleEnum role)
 {
-	return pk_enum_find_string (enum_role, role);
+	return pk_enum_index_find_string (&enum_role_index, enum_role, role);
 }
 
 /**
@@ -678,7 +808,7 @@ pk_role_enum_to_string (PkRoleEnum role)
 PkErrorEnum
 pk_error_enum_from_string (const gchar *code)
 {
-	return pk_enum_find_value (enum_error, code);
+	return pk_enum_index_find_value (&enum_error_index, enum_error, code);
 }
 
 /**
@@ -694,7 +824,7 @@ pk_error_enum_from_string (const gchar *code)
 const gchar *
 pk_error_enum_to_string (PkErrorEnum code)
 {
-	return pk_enum_find_string (enum_error, code);
+	return pk_enum_index_find_string (&enum_error_index, enum_error, code);
 }
 
 /**
@@ -710,7 +840,7 @@ pk_error_enum_to_string (PkErrorEnum code)
 PkRestartEnum
 pk_restart_enum_from_string (const gchar *restart)
 {
-	return pk_enum_find_value (enum_restart, restart);
+	return pk_enum_index_find_value (&enum_restart_index, enum_restart, restart);
 }
 
 /**
@@ -726,7 +856,7 @@ pk_restart_enum_from_string (const gchar *restart)
 const gchar *
 pk_restart_enum_to_string (PkRestartEnum restart)
 {
-	return pk_enum_find_string (enum_restart, restart);
+	return pk_enum_index_find_string (&enum_restart_index, enum_restart, restart);
 }
 
 /**
@@ -742,7 +872,7 @@ pk_restart_enum_to_string (PkRestartEnum restart)
 PkGroupEnum
 pk_group_enum_from_string (const gchar *group)
 {
-	return pk_enum_find_value (enum_group, group);
+	return pk_enum_index_find_value (&enum_group_index, enum_group, group);
 }
 
 /**
@@ -758,7 +888,7 @@ pk_group_enum_from_string (const gchar *group)
 const gchar *
 pk_group_enum_to_string (PkGroupEnum group)
 {
-	return pk_enum_find_string (enum_group, group);
+	return pk_enum_index_find_string (&enum_group_index, enum_group, group);
 }
 
 /**
@@ -774,7 +904,7 @@ pk_group_enum_to_string (PkGroupEnum group)
 PkUpdateStateEnum
 pk_update_state_enum_from_string (const gchar *update_state)
 {
-	return pk_enum_find_value (enum_update_state, update_state);
+	return pk_enum_index_find_value (&enum_update_state_index, enum_update_state, update_state);
 }
 
 /**
@@ -790,7 +920,7 @@ pk_update_state_enum_from_string (const gchar *update_state)
 const gchar *
 pk_update_state_enum_to_string (PkUpdateStateEnum update_state)
 {
-	return pk_enum_find_string (enum_update_state, update_state);
+	return pk_enum_index_find_string (&enum_update_state_index, enum_update_state, update_state);
 }
 
 /**
@@ -806,7 +936,7 @@ pk_update_state_enum_to_string (PkUpdateStateEnum update_state)
 PkFilterEnum
 pk_filter_enum_from_string (const gchar *filter)
 {
-	return pk_enum_find_value (enum_filter, filter);
+	return pk_enum_index_find_value (&enum_filter_index, enum_filter, filter);
 }
 
 /**
@@ -822,7 +952,7 @@ pk_filter_enum_from_string (const gchar *filter)
 const gchar *
 pk_filter_enum_to_string (PkFilterEnum filter)
 {
-	return pk_enum_find_string (enum_filter, filter);
+	return pk_enum_index_find_string (&enum_filter_index, enum_filter, filter);
 }
 
 /**
@@ -838,7 +968,7 @@ pk_filter_enum_to_string (PkFilterEnum filter)
 PkMediaTypeEnum
 pk_media_type_enum_from_string (const gchar *media_type)
 {
-	return pk_enum_find_value (enum_media_type, media_type);
+	return pk_enum_index_find_value (&enum_media_type_index, enum_media_type, media_type);
 }
 
 /**
@@ -854,7 +984,7 @@ pk_media_type_enum_from_string (const gchar *media_type)
 const gchar *
 pk_media_type_enum_to_string (PkMediaTypeEnum media_type)
 {
-	return pk_enum_find_string (enum_media_type, media_type);
+	return pk_enum_index_find_string (&enum_media_type_index, enum_media_type, media_type);
 }
 
 /**
@@ -870,7 +1000,7 @@ pk_media_type_enum_to_string (PkMediaTypeEnum media_type)
 PkAuthorizeEnum
 pk_authorize_type_enum_from_string (const gchar *authorize_type)
 {
-	return pk_enum_find_value (enum_authorize_type, authorize_type);
+	return pk_enum_index_find_value (&enum_authorize_type_index, enum_authorize_type, authorize_type);
 }
 
 /**
@@ -886,7 +1016,7 @@ pk_authorize_type_enum_from_string (const gchar *authorize_type)
 const gchar *
 pk_authorize_type_enum_to_string (PkAuthorizeEnum authorize_type)
 {
-	return pk_enum_find_string (enum_authorize_type, authorize_type);
+	return pk_enum_index_find_string (&enum_authorize_type_index, enum_authorize_type, authorize_type);
 }
 
 /**
@@ -902,7 +1032,7 @@ pk_authorize_type_enum_to_string (PkAuthorizeEnum authorize_type)
 PkUpgradeKindEnum
 pk_upgrade_kind_enum_from_string (const gchar *upgrade_kind)
 {
-	return pk_enum_find_value (enum_upgrade_kind, upgrade_kind);
+	return pk_enum_index_find_value (&enum_upgrade_kind_index, enum_upgrade_kind, upgrade_kind);
 }
 
 /**
@@ -918,7 +1048,7 @@ pk_upgrade_kind_enum_from_string (const gchar *upgrade_kind)
 const gchar *
 pk_upgrade_kind_enum_to_string (PkUpgradeKindEnum upgrade_kind)
 {
-	return pk_enum_find_string (enum_upgrade_kind, upgrade_kind);
+	return pk_enum_index_find_string (&enum_upgrade_kind_index, enum_upgrade_kind, upgrade_kind);
 }
 
 /**
@@ -934,7 +1064,7 @@ pk_upgrade_kind_enum_to_string (PkUpgradeKindEnum upgrade_kind)
 PkTransactionFlagEnum
 pk_transaction_flag_enum_from_string (const gchar *transaction_flag)
 {
-	return pk_enum_find_value (enum_transaction_flag, transaction_flag);
+	return pk_enum_index_find_value (&enum_transaction_flag_index, enum_transaction_flag, transaction_flag);
 }
 
 /**
@@ -950,7 +1080,7 @@ pk_transaction_flag_enum_from_string (const gchar *transaction_flag)
 const gchar *
 pk_transaction_flag_enum_to_string (PkTransactionFlagEnum transaction_flag)
 {
-	return pk_enum_find_string (enum_transaction_flag, transaction_flag);
+	return pk_enum_index_find_string (&enum_transaction_flag_index, enum_transaction_flag, transaction_flag);
 }
 
 /**
@@ -30,12 +30,14 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib-object.h>
 #include <gio/gio.h>
 
 #include <packagekit-glib2/pk-package-sack.h>
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-package-id.h>
@@ -53,6 +55,8 @@ struct _PkPackageSackPrivate
 {
 	GHashTable		*table;
 	GPtrArray		*array;
+	GHashTable		*index_name_arch;	/* "name;arch" : GPtrArray of PkPackage */
+	GHashTable		*index_info;		/* PkInfoEnum : GPtrArray of PkPackage */
 	PkClient		*client;
 };
 
@@ -63,6 +67,191 @@ enum {
 
 G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 
+static void	pk_package_sack_index_info_drop	(PkPackageSack *sack);
+
+/*
+ * pk_package_sack_index_name_arch_key:
+ **/
+static gchar *
+pk_package_sack_index_name_arch_key (PkPackage *package)
+{
+	return g_strjoin (";",
+			  pk_package_get_name (package),
+			  pk_package_get_arch (package),
+			  NULL);
+}
+
+/*
+ * pk_package_sack_index_name_arch_add:
+ **/
+static void
+pk_package_sack_index_name_arch_add (PkPackageSack *sack, PkPackage *package)
+{
+	GPtrArray *bucket;
+	g_autofree gchar *key = NULL;
+
+	key = pk_package_sack_index_name_arch_key (package);
+	bucket = g_hash_table_lookup (sack->priv->index_name_arch, key);
+	if (bucket == NULL) {
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (sack->priv->index_name_arch,
+				     g_steal_pointer (&key), bucket);
+	}
+	g_ptr_array_add (bucket, package);
+}
+
+/*
+ * pk_package_sack_index_name_arch_remove:
+ **/
+static void
+pk_package_sack_index_name_arch_remove (PkPackageSack *sack, PkPackage *package)
+{
+	GPtrArray *bucket;
+	g_autofree gchar *key = NULL;
+
+	key = pk_package_sack_index_name_arch_key (package);
+	bucket = g_hash_table_lookup (sack->priv->index_name_arch, key);
+	if (bucket == NULL)
+		return;
+	g_ptr_array_remove (bucket, package);
+	if (bucket->len == 0)
+		g_hash_table_remove (sack->priv->index_name_arch, key);
+}
+
+/*
+ * pk_package_sack_index_name_arch_ensure:
+ *
+ * The buckets keep the packages in the same order as the array, so the
+ * first entry of a bucket is the first match a linear scan would find.
+ **/
+static void
+pk_package_sack_index_name_arch_ensure (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	guint i;
+
+	if (priv->index_name_arch != NULL)
+		return;
+	priv->index_name_arch = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_ptr_array_unref);
+	for (i = 0; i < priv->array->len; i++)
+		pk_package_sack_index_name_arch_add (sack, g_ptr_array_index (priv->array, i));
+}
+
+/*
+ * pk_package_sack_index_info_notify_cb:
+ *
+ * The info of a package can be changed after it was added to the sack, in
+ * which case the bucket it was filed under is wrong.
+ **/
+static void
+pk_package_sack_index_info_notify_cb (PkPackage *package,
+				      GParamSpec *pspec,
+				      PkPackageSack *sack)
+{
+	pk_package_sack_index_info_drop (sack);
+}
+
+/*
+ * pk_package_sack_index_info_add:
+ **/
+static void
+pk_package_sack_index_info_add (PkPackageSack *sack, PkPackage *package)
+{
+	GPtrArray *bucket;
+	gpointer key = GUINT_TO_POINTER (pk_package_get_info (package));
+
+	bucket = g_hash_table_lookup (sack->priv->index_info, key);
+	if (bucket == NULL) {
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (sack->priv->index_info, key, bucket);
+	}
+	g_ptr_array_add (bucket, package);
+	g_signal_connect (package, "notify::info",
+			  G_CALLBACK (pk_package_sack_index_info_notify_cb), sack);
+}
+
+/*
+ * pk_package_sack_index_info_remove:
+ **/
+static void
+pk_package_sack_index_info_remove (PkPackageSack *sack, PkPackage *package)
+{
+	GPtrArray *bucket;
+	gulong handler_id;
+	gpointer key = GUINT_TO_POINTER (pk_package_get_info (package));
+
+	bucket = g_hash_table_lookup (sack->priv->index_info, key);
+	if (bucket == NULL)
+		return;
+	g_ptr_array_remove (bucket, package);
+
+	/* the same object may have been added more than once, so only
+	 * disconnect the handler belonging to this entry */
+	handler_id = g_signal_handler_find (package,
+					    G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
+					    0, 0, NULL,
+					    pk_package_sack_index_info_notify_cb,
+					    sack);
+	if (handler_id != 0)
+		g_signal_handler_disconnect (package, handler_id);
+	if (bucket->len == 0)
+		g_hash_table_remove (sack->priv->index_info, key);
+}
+
+/*
+ * pk_package_sack_index_info_ensure:
+ **/
+static void
+pk_package_sack_index_info_ensure (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	guint i;
+
+	if (priv->index_info != NULL)
+		return;
+	priv->index_info = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						  NULL, (GDestroyNotify) g_ptr_array_unref);
+	for (i = 0; i < priv->array->len; i++)
+		pk_package_sack_index_info_add (sack, g_ptr_array_index (priv->array, i));
+}
+
+/*
+ * pk_package_sack_index_info_drop:
+ **/
+static void
+pk_package_sack_index_info_drop (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	GHashTableIter iter;
+	GPtrArray *bucket;
+	guint i;
+
+	if (priv->index_info == NULL)
+		return;
+	g_hash_table_iter_init (&iter, priv->index_info);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &bucket)) {
+		for (i = 0; i < bucket->len; i++) {
+			g_signal_handlers_disconnect_by_func (g_ptr_array_index (bucket, i),
+							      pk_package_sack_index_info_notify_cb,
+							      sack);
+		}
+	}
+	g_clear_pointer (&priv->index_info, g_hash_table_unref);
+}
+
+/*
+ * pk_package_sack_index_drop:
+ *
+ * The indexes are rebuilt on the next lookup that needs them.
+ **/
+static void
+pk_package_sack_index_drop (PkPackageSack *sack)
+{
+	g_clear_pointer (&sack->priv->index_name_arch, g_hash_table_unref);
+	pk_package_sack_index_info_drop (sack);
+}
+
 /**
  * pk_package_sack_clear:
  * @sack: a valid #PkPackageSack instance
@@ -76,6 +265,7 @@ pk_package_sack_clear (PkPackageSack *sack)
 {
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
 
+	pk_package_sack_index_drop (sack);
 	g_ptr_array_set_size (sack->priv->array, 0);
 	g_hash_table_remove_all (sack->priv->table);
 }
@@ -160,10 +350,8 @@ PkPackageSack *
 pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 {
 	PkPackageSack *results;
-	PkPackage *package;
-	PkInfoEnum info_tmp;
+	GPtrArray *bucket;
 	guint i;
-	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
 
@@ -171,12 +359,12 @@ pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 	results = pk_package_sack_new ();
 
 	/* add each that matches the info enum */
-	for (i = 0; i < priv->array->len; i++) {
-		package = g_ptr_array_index (priv->array, i);
-		info_tmp = pk_package_get_info (package);
-		if (info_tmp == info)
-			pk_package_sack_add_package (results, package);
-	}
+	pk_package_sack_index_info_ensure (sack);
+	bucket = g_hash_table_lookup (sack->priv->index_info, GUINT_TO_POINTER (info));
+	if (bucket == NULL)
+		return results;
+	for (i = 0; i < bucket->len; i++)
+		pk_package_sack_add_package (results, g_ptr_array_index (bucket, i));
 
 	return results;
 }
@@ -241,6 +429,12 @@ pk_package_sack_add_package (PkPackageSack *sack, PkPackage *package)
 			     (gpointer) pk_package_get_id (package),
 			     (gpointer) package);
 
+	/* only keep the indexes up to date once something has used them */
+	if (sack->priv->index_name_arch != NULL)
+		pk_package_sack_index_name_arch_add (sack, package);
+	if (sack->priv->index_info != NULL)
+		pk_package_sack_index_info_add (sack, package);
+
 	return TRUE;
 }
 
@@ -279,35 +473,66 @@ pk_package_sack_add_package_by_id (PkPackageSack *sack,
 
 /*
  * pk_package_sack_add_packages_from_line:
+ *
+ * Parses "info\tpackage-id\tsummary" in place.
  **/
 static gboolean
 pk_package_sack_add_packages_from_line (PkPackageSack *sack,
-					const gchar *package_str,
+					gchar *package_str,
 					GError **error)
 {
-	PkInfoEnum info;
-	g_autoptr(GError) error_local = NULL;
+	gchar *package_id;
+	gchar *summary;
 	g_autoptr(PkPackage) package = NULL;
-	g_auto(GStrv) pdata = NULL;
 
-	package = pk_package_new ();
-	pdata = g_strsplit (package_str, "\t", -1);
-	if (g_strv_length (pdata) != 3) {
+	package_id = strchr (package_str, '\t');
+	summary = package_id != NULL ? strchr (package_id + 1, '\t') : NULL;
+	if (summary == NULL || strchr (summary + 1, '\t') != NULL) {
 		g_set_error (error, 1, 0, "invalid package-info line: %s", package_str);
 		return FALSE;
 	}
+	*package_id++ = '\0';
+	*summary++ = '\0';
 
-	info = pk_info_enum_from_string (pdata[0]);
-	g_object_set (package,
-		      "info", info,
-		      "summary", pdata[2],
-		      NULL);
-	if (!pk_package_set_id (package, pdata[1], &error_local)) {
-		g_set_error (error, 1, 0, "invalid package-id in package-info line: %s", pdata[1]);
+	package = pk_package_new ();
+	if (!pk_package_set_id (package, package_id, NULL)) {
+		g_set_error (error, 1, 0, "invalid package-id in package-info line: %s", package_id);
 		return FALSE;
 	}
+	pk_package_set_info (package, pk_info_enum_from_string (package_str));
+	pk_package_set_summary (package, summary);
 	if (!pk_package_sack_add_package (sack, package))
-		g_set_error (error, 1, 0, "could not add package '%s' to package-sack!", pdata[1]);
+		g_set_error (error, 1, 0, "could not add package '%s' to package-sack!", package_id);
+	return TRUE;
+}
+
+/*
+ * pk_package_sack_add_packages_from_text:
+ **/
+static gboolean
+pk_package_sack_add_packages_from_text (PkPackageSack *sack,
+					GBytes *bytes,
+					GError **error)
+{
+	const gchar *data;
+	const gchar *end;
+	const gchar *eol;
+	gsize len;
+
+	/* read package info file line by line */
+	data = g_bytes_get_data (bytes, &len);
+	end = data + len;
+	while (data < end) {
+		g_autofree gchar *line = NULL;
+		eol = memchr (data, '\n', end - data);
+		if (eol == NULL)
+			eol = end;
+		line = g_strndup (data, eol - data);
+		data = eol + 1;
+		g_strstrip (line);
+		if (!pk_package_sack_add_packages_from_line (sack, line, error))
+			return FALSE;
+	}
 	return TRUE;
 }
 
@@ -319,6 +544,8 @@ pk_package_sack_add_packages_from_line (PkPackageSack *sack,
  *
  * Adds packages from package-list file to a #PkPackageSack.
  *
+ * Local files are mapped rather than read.
+ *
  * Return value: %TRUE if there were no errors.
  *
  **/
@@ -327,31 +554,26 @@ pk_package_sack_add_packages_from_file (PkPackageSack *sack,
 					GFile *file,
 					GError **error)
 {
-	GError *error_local = NULL;
-	g_autoptr(GFileInputStream) is = NULL;
-	g_autoptr(GDataInputStream) input = NULL;
+	gsize len;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *contents = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mapped = NULL;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 
-	is = g_file_read (file, NULL, &error_local);
-	if (is == NULL) {
-		g_propagate_error (error, error_local);
-		return FALSE;
-	}
-
-	input = g_data_input_stream_new (G_INPUT_STREAM (is));
-
-	/* read package info file line by line */
-	while (TRUE) {
-		gchar *line;
-		line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
-		if (line == NULL)
-			break;
-		g_strstrip (line);
-		if (!pk_package_sack_add_packages_from_line (sack, line, error))
+	filename = g_file_get_path (file);
+	if (filename != NULL) {
+		mapped = g_mapped_file_new (filename, FALSE, error);
+		if (mapped == NULL)
 			return FALSE;
+		bytes = g_mapped_file_get_bytes (mapped);
+	} else {
+		if (!g_file_load_contents (file, NULL, &contents, &len, NULL, error))
+			return FALSE;
+		bytes = g_bytes_new_take (g_steal_pointer (&contents), len);
 	}
-	return TRUE;
+	return pk_package_sack_add_packages_from_text (sack, bytes, error);
 }
 
 /**
@@ -415,6 +637,10 @@ pk_package_sack_remove_package (PkPackageSack *sack, PkPackage *package)
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
 	/* remove from array */
+	if (sack->priv->index_name_arch != NULL)
+		pk_package_sack_index_name_arch_remove (sack, package);
+	if (sack->priv->index_info != NULL)
+		pk_package_sack_index_info_remove (sack, package);
 	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
 	return g_ptr_array_remove (sack->priv->array, package);
 }
@@ -436,21 +662,15 @@ pk_package_sack_remove_package_by_id (PkPackageSack *sack,
 				      const gchar *package_id)
 {
 	PkPackage *package;
-	guint i;
-	GPtrArray *array;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (package_id != NULL, FALSE);
 
-	array = sack->priv->array;
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		if (g_strcmp0 (package_id, pk_package_get_id (package)) == 0) {
-			pk_package_sack_remove_package (sack, package);
-			return TRUE;
-		}
-	}
-	return FALSE;
+	package = g_hash_table_lookup (sack->priv->table, package_id);
+	if (package == NULL)
+		return FALSE;
+	pk_package_sack_remove_package (sack, package);
+	return TRUE;
 }
 
 /**
@@ -471,26 +691,35 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 				  PkPackageSackFilterFunc filter_cb,
 				  gpointer user_data)
 {
-	gboolean ret = FALSE;
 	PkPackage *package;
-	gint i;
+	guint i;
+	guint len = 0;
 	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (filter_cb != NULL, FALSE);
 
-	/* add each that matches the info enum */
-	for (i = 0; i < (gint) priv->array->len; i++) {
+	/* compact the array in one pass rather than removing each package
+	 * with a linear search, and rebuild the indexes lazily afterwards */
+	for (i = 0; i < priv->array->len; i++) {
 		package = g_ptr_array_index (priv->array, i);
-		if (!filter_cb (package, user_data)) {
-			ret = TRUE;
-			pk_package_sack_remove_package (sack, package);
-
-			/* ensure we pick up subsequent matches */
-			i--;
+		if (filter_cb (package, user_data)) {
+			priv->array->pdata[len++] = package;
+			continue;
 		}
+		if (priv->index_name_arch != NULL || priv->index_info != NULL)
+			pk_package_sack_index_drop (sack);
+		g_hash_table_remove (priv->table, pk_package_get_id (package));
+		g_object_unref (package);
 	}
-	return ret;
+	if (len == priv->array->len)
+		return FALSE;
+
+	/* the removed packages have already been unreffed */
+	g_ptr_array_set_free_func (priv->array, NULL);
+	g_ptr_array_set_size (priv->array, len);
+	g_ptr_array_set_free_func (priv->array, g_object_unref);
+	return TRUE;
 }
 
 /**
@@ -535,8 +764,8 @@ pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 PkPackage *
 pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_id)
 {
-	PkPackage *pkg_tmp;
-	guint i;
+	GPtrArray *bucket;
+	g_autofree gchar *key = NULL;
 	g_auto(GStrv) split = NULL;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
@@ -546,75 +775,43 @@ pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_
 	split = pk_package_id_split (package_id);
 	if (split == NULL)
 		return NULL;
-	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg_tmp = g_ptr_array_index (sack->priv->array, i);
-		if (g_strcmp0 (pk_package_get_name (pkg_tmp),
-			       split[PK_PACKAGE_ID_NAME]) == 0 &&
-		    g_strcmp0 (pk_package_get_arch (pkg_tmp),
-			       split[PK_PACKAGE_ID_ARCH]) == 0) {
-			return g_object_ref (pkg_tmp);
-		}
-	}
-	return NULL;
-}
-
-/*
- * pk_package_sack_sort_compare_name_func:
- **/
-static gint
-pk_package_sack_sort_compare_name_func (PkPackage **a, PkPackage **b)
-{
-	const gchar *package_id1;
-	const gchar *package_id2;
-	g_auto(GStrv) split1 = NULL;
-	g_auto(GStrv) split2 = NULL;
-
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	split1 = pk_package_id_split (package_id1);
-	split2 = pk_package_id_split (package_id2);
-	return g_strcmp0 (split1[PK_PACKAGE_ID_NAME], split2[PK_PACKAGE_ID_NAME]);
+	pk_package_sack_index_name_arch_ensure (sack);
+	key = g_strjoin (";", split[PK_PACKAGE_ID_NAME], split[PK_PACKAGE_ID_ARCH], NULL);
+	bucket = g_hash_table_lookup (sack->priv->index_name_arch, key);
+	if (bucket == NULL)
+		return NULL;
+	return g_object_ref (g_ptr_array_index (bucket, 0));
 }
 
-/*
- * pk_package_sack_sort_compare_package_id_func:
- **/
-static gint
-pk_package_sack_sort_compare_package_id_func (PkPackage **a, PkPackage **b)
-{
-	const gchar *package_id1;
-	const gchar *package_id2;
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	return g_strcmp0 (package_id1, package_id2);
-}
+/* the sort key is looked up once per package rather than once per compare */
+typedef struct {
+	const gchar		*key;
+	PkInfoEnum		 info;
+	PkPackage		*package;
+} PkPackageSackSortItem;
 
 /*
- * pk_package_sack_sort_compare_summary_func:
+ * pk_package_sack_sort_compare_key_func:
  **/
 static gint
-pk_package_sack_sort_compare_summary_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_key_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	const gchar *summary1;
-	const gchar *summary2;
-	summary1 = pk_package_get_summary (*a);
-	summary2 = pk_package_get_summary (*b);
-	return g_strcmp0 (summary1, summary2);
+	const PkPackageSackSortItem *item1 = a;
+	const PkPackageSackSortItem *item2 = b;
+	return g_strcmp0 (item1->key, item2->key);
 }
 
 /*
  * pk_package_sack_sort_compare_info_func:
  **/
 static gint
-pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_info_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	PkInfoEnum info1;
-	PkInfoEnum info2;
-	info1 = pk_package_get_info (*a);
-	info2 = pk_package_get_info (*b);
-	if (info1 == info2)
+	const PkPackageSackSortItem *item1 = a;
+	const PkPackageSackSortItem *item2 = b;
+	if (item1->info == item2->info)
 		return 0;
-	else if (info1 > info2)
+	else if (item1->info > item2->info)
 		return -1;
 	return 1;
 }
@@ -631,15 +828,49 @@ pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
 void
 pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 {
+	GCompareDataFunc compare_func;
+	GPtrArray *array;
+	PkPackage *package;
+	PkPackageSackSortItem *item;
+	guint i;
+	g_autofree PkPackageSackSortItem *items = NULL;
+
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
-	if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_name_func);
-	else if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_package_id_func);
-	else if (type == PK_PACKAGE_SACK_SORT_TYPE_SUMMARY)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_summary_func);
-	else if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_info_func);
+
+	if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
+		compare_func = pk_package_sack_sort_compare_info_func;
+	else if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME ||
+		 type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID ||
+		 type == PK_PACKAGE_SACK_SORT_TYPE_SUMMARY)
+		compare_func = pk_package_sack_sort_compare_key_func;
+	else
+		return;
+
+	array = sack->priv->array;
+	if (array->len < 2)
+		return;
+	items = g_new (PkPackageSackSortItem, array->len);
+	for (i = 0; i < array->len; i++) {
+		package = g_ptr_array_index (array, i);
+		item = &items[i];
+		item->package = package;
+		item->info = pk_package_get_info (package);
+		if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME)
+			item->key = pk_package_get_name (package);
+		else if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
+			item->key = pk_package_get_id (package);
+		else
+			item->key = pk_package_get_summary (package);
+	}
+
+	/* this is a stable merge sort, like g_ptr_array_sort() */
+	pk_sort_array (items, array->len, sizeof (PkPackageSackSortItem),
+		       compare_func, NULL);
+	for (i = 0; i < array->len; i++)
+		array->pdata[i] = items[i].package;
+
+	/* the index buckets have to follow the new order */
+	pk_package_sack_index_drop (sack);
 }
 
 /**
@@ -1143,6 +1374,8 @@ pk_package_sack_init (PkPackageSack *sack)
 
 	priv->table = g_hash_table_new (g_str_hash, g_str_equal);
 	priv->array = g_ptr_array_new_with_free_func (g_object_unref);
+	priv->index_name_arch = NULL;
+	priv->index_info = NULL;
 	priv->client = pk_client_new ();
 }
 
@@ -1155,6 +1388,7 @@ pk_package_sack_finalize (GObject *object)
 	PkPackageSack *sack = PK_PACKAGE_SACK (object);
 	PkPackageSackPrivate *priv = sack->priv;
 
+	pk_package_sack_index_drop (sack);
 	g_ptr_array_unref (priv->array);
 	g_hash_table_unref (priv->table);
 	g_object_unref (priv->client);
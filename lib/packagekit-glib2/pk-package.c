@@ -30,6 +30,7 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib-object.h>
 
 #include <packagekit-glib2/pk-package.h>
@@ -43,17 +44,13 @@ static void     pk_package_finalize	(GObject     *object);
 #define PK_PACKAGE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_PACKAGE, PkPackagePrivate))
 
 /**
- * PkPackagePrivate:
+ * PkPackageExtra:
  *
- * Private #PkPackage data
+ * The details and update details of a #PkPackage, which most packages
+ * never have set, so they are only allocated on first use.
  **/
-struct _PkPackagePrivate
+typedef struct
 {
-	PkInfoEnum		 info;
-	gchar			*package_id;
-	gchar			*package_id_data;
-	const gchar		*package_id_split[4];
-	gchar			*summary;
 	gchar			*license;
 	PkGroupEnum		 group;
 	gchar			*description;
@@ -70,7 +67,29 @@ struct _PkPackagePrivate
 	PkUpdateStateEnum	 update_state;
 	gchar			*update_issued;
 	gchar			*update_updated;
+} PkPackageExtra;
+
+/* used for reading when nothing was set */
+static const PkPackageExtra pk_package_extra_empty = { NULL };
+
+/**
+ * PkPackagePrivate:
+ *
+ * Private #PkPackage data
+ *
+ * The package-id is only split when one of its sections is requested: the
+ * name and the version share one allocation, the arch and the data are
+ * interned as there are only a few distinct values of them.
+ **/
+struct _PkPackagePrivate
+{
+	PkInfoEnum		 info;
 	PkInfoEnum	 	 update_severity;
+	gchar			*package_id;
+	gchar			*package_id_data;
+	const gchar		*package_id_split[4];
+	gchar			*summary;
+	PkPackageExtra		*extra;
 };
 
 enum {
@@ -104,6 +123,7 @@ enum {
 };
 
 static guint signals [SIGNAL_LAST] = { 0 };
+static GParamSpec *obj_properties [PROP_LAST] = { NULL, };
 
 G_DEFINE_TYPE (PkPackage, pk_package, PK_TYPE_SOURCE)
 
@@ -147,6 +167,68 @@ pk_package_equal_id (PkPackage *package1, PkPackage *package2)
 	return (g_strcmp0 (package1->priv->package_id, package2->priv->package_id) == 0);
 }
 
+/*
+ * pk_package_intern_section:
+ **/
+static const gchar *
+pk_package_intern_section (const gchar *section, gsize len)
+{
+	gchar buf[128];
+	g_autofree gchar *tmp = NULL;
+
+	if (len < sizeof (buf)) {
+		memcpy (buf, section, len);
+		buf[len] = '\0';
+		return g_intern_string (buf);
+	}
+	tmp = g_strndup (section, len);
+	return g_intern_string (tmp);
+}
+
+/*
+ * pk_package_split_id:
+ *
+ * Splits the package-id into its sections.
+ **/
+static void
+pk_package_split_id (PkPackage *package)
+{
+	PkPackagePrivate *priv = package->priv;
+	const gchar *sep[3] = { NULL, NULL, NULL };
+	const gchar *end;
+	guint cnt = 0;
+	guint i;
+
+	/* find the first three separators, anything after the third one is
+	 * the data section */
+	for (i = 0; priv->package_id[i] != '\0' && cnt < 3; i++) {
+		if (priv->package_id[i] == ';')
+			sep[cnt++] = &priv->package_id[i];
+	}
+	end = priv->package_id + strlen (priv->package_id);
+
+	/* name and version */
+	priv->package_id_data = g_strndup (priv->package_id,
+					   (sep[1] != NULL ? sep[1] : end) - priv->package_id);
+	priv->package_id_split[PK_PACKAGE_ID_NAME] = priv->package_id_data;
+	if (sep[0] != NULL) {
+		priv->package_id_data[sep[0] - priv->package_id] = '\0';
+		priv->package_id_split[PK_PACKAGE_ID_VERSION] =
+			&priv->package_id_data[sep[0] - priv->package_id + 1];
+	}
+
+	/* arch and data */
+	if (sep[1] != NULL) {
+		priv->package_id_split[PK_PACKAGE_ID_ARCH] =
+			pk_package_intern_section (sep[1] + 1,
+						   (sep[2] != NULL ? sep[2] : end) - sep[1] - 1);
+	}
+	if (sep[2] != NULL) {
+		priv->package_id_split[PK_PACKAGE_ID_DATA] =
+			pk_package_intern_section (sep[2] + 1, end - sep[2] - 1);
+	}
+}
+
 /**
  * pk_package_set_id:
  * @package: a valid #PkPackage instance
@@ -163,44 +245,63 @@ gboolean
 pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 {
 	PkPackagePrivate *priv = package->priv;
-	gboolean ret;
 	guint cnt = 0;
 	guint i;
 
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-	/* free old data */
+	/* free old data, and split the new id once here so the getters
+	 * never have to modify the object */
 	g_free (priv->package_id);
-	g_free (priv->package_id_data);
-
-	/* copy the package-id into package_id_data, change the ';' into '\0'
-	 * and reference the pointers in the const gchar * array */
+	g_clear_pointer (&priv->package_id_data, g_free);
+	memset (priv->package_id_split, 0, sizeof (priv->package_id_split));
 	priv->package_id = g_strdup (package_id);
-	priv->package_id_data = g_strdup (package_id);
-	priv->package_id_split[0] = priv->package_id_data;
-	for (i = 0; priv->package_id_data[i] != '\0'; i++) {
-		if (package_id[i] == ';') {
-			if (++cnt > 3)
-				continue;
-			priv->package_id_split[cnt] = &priv->package_id_data[i+1];
-			priv->package_id_data[i] = '\0';
-		}
+	pk_package_split_id (package);
+
+	/* only validate here */
+	for (i = 0; package_id[i] != '\0'; i++) {
+		if (package_id[i] == ';')
+			cnt++;
 	}
 	if (cnt != 3) {
-		ret = FALSE;
 		g_set_error (error, 1, 0, "invalid number of sections %i", cnt);
-		goto out;
+		return FALSE;
 	}
 
 	/* name has to be valid */
-	ret = (priv->package_id_split[0][0] != '\0');
-	if (!ret) {
+	if (package_id[0] == ';') {
 		g_set_error_literal (error, 1, 0, "name invalid");
-		goto out;
+		return FALSE;
 	}
-out:
-	return ret;
+	return TRUE;
+}
+
+
+/*
+ * pk_package_get_extra:
+ *
+ * Gets the details and update details for writing.
+ **/
+static PkPackageExtra *
+pk_package_get_extra (PkPackage *package)
+{
+	if (package->priv->extra == NULL)
+		package->priv->extra = g_new0 (PkPackageExtra, 1);
+	return package->priv->extra;
+}
+
+/*
+ * pk_package_peek_extra:
+ *
+ * Gets the details and update details for reading.
+ **/
+static const PkPackageExtra *
+pk_package_peek_extra (PkPackage *package)
+{
+	if (package->priv->extra == NULL)
+		return &pk_package_extra_empty;
+	return package->priv->extra;
 }
 
 /**
@@ -269,7 +370,10 @@ void
 pk_package_set_info (PkPackage *package, PkInfoEnum info)
 {
 	g_return_if_fail (PK_IS_PACKAGE (package));
+	if (package->priv->info == info)
+		return;
 	package->priv->info = info;
+	g_object_notify_by_pspec (G_OBJECT (package), obj_properties[PROP_INFO]);
 }
 
 /**
@@ -422,6 +526,7 @@ pk_package_get_property (GObject *object, guint prop_id, GValue *value, GParamSp
 {
 	PkPackage *package = PK_PACKAGE (object);
 	PkPackagePrivate *priv = package->priv;
+	const PkPackageExtra *extra = pk_package_peek_extra (package);
 
 	switch (prop_id) {
 	case PROP_PACKAGE_ID:
@@ -434,52 +539,52 @@ pk_package_get_property (GObject *object, guint prop_id, GValue *value, GParamSp
 		g_value_set_enum (value, priv->info);
 		break;
 	case PROP_LICENSE:
-		g_value_set_string (value, priv->license);
+		g_value_set_string (value, extra->license);
 		break;
 	case PROP_GROUP:
-		g_value_set_enum (value, priv->group);
+		g_value_set_enum (value, extra->group);
 		break;
 	case PROP_DESCRIPTION:
-		g_value_set_string (value, priv->description);
+		g_value_set_string (value, extra->description);
 		break;
 	case PROP_URL:
-		g_value_set_string (value, priv->url);
+		g_value_set_string (value, extra->url);
 		break;
 	case PROP_SIZE:
-		g_value_set_uint64 (value, priv->size);
+		g_value_set_uint64 (value, extra->size);
 		break;
 	case PROP_UPDATE_UPDATES:
-		g_value_set_string (value, priv->update_updates);
+		g_value_set_string (value, extra->update_updates);
 		break;
 	case PROP_UPDATE_OBSOLETES:
-		g_value_set_string (value, priv->update_obsoletes);
+		g_value_set_string (value, extra->update_obsoletes);
 		break;
 	case PROP_UPDATE_VENDOR_URLS:
-		g_value_set_boxed (value, priv->update_vendor_urls);
+		g_value_set_boxed (value, extra->update_vendor_urls);
 		break;
 	case PROP_UPDATE_BUGZILLA_URLS:
-		g_value_set_boxed (value, priv->update_bugzilla_urls);
+		g_value_set_boxed (value, extra->update_bugzilla_urls);
 		break;
 	case PROP_UPDATE_CVE_URLS:
-		g_value_set_boxed (value, priv->update_cve_urls);
+		g_value_set_boxed (value, extra->update_cve_urls);
 		break;
 	case PROP_UPDATE_RESTART:
-		g_value_set_enum (value, priv->update_restart);
+		g_value_set_enum (value, extra->update_restart);
 		break;
 	case PROP_UPDATE_UPDATE_TEXT:
-		g_value_set_string (value, priv->update_text);
+		g_value_set_string (value, extra->update_text);
 		break;
 	case PROP_UPDATE_CHANGELOG:
-		g_value_set_string (value, priv->update_changelog);
+		g_value_set_string (value, extra->update_changelog);
 		break;
 	case PROP_UPDATE_STATE:
-		g_value_set_enum (value, priv->update_state);
+		g_value_set_enum (value, extra->update_state);
 		break;
 	case PROP_UPDATE_ISSUED:
-		g_value_set_string (value, priv->update_issued);
+		g_value_set_string (value, extra->update_issued);
 		break;
 	case PROP_UPDATE_UPDATED:
-		g_value_set_string (value, priv->update_updated);
+		g_value_set_string (value, extra->update_updated);
 		break;
 	case PROP_UPDATE_SEVERITY:
 		g_value_set_enum (value, priv->update_severity);
@@ -497,7 +602,13 @@ static void
 pk_package_set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
 {
 	PkPackage *package = PK_PACKAGE (object);
-	PkPackagePrivate *priv = package->priv;
+	PkPackageExtra *extra = NULL;
+
+	/* everything but the basic properties lives in the extra data */
+	if (prop_id != PROP_INFO &&
+	    prop_id != PROP_SUMMARY &&
+	    prop_id != PROP_UPDATE_SEVERITY)
+		extra = pk_package_get_extra (package);
 
 	switch (prop_id) {
 	case PROP_INFO:
@@ -507,64 +618,64 @@ pk_package_set_property (GObject *object, guint prop_id, const GValue *value, GP
 		pk_package_set_summary (package, g_value_get_string (value));
 		break;
 	case PROP_LICENSE:
-		g_free (priv->license);
-		priv->license = g_strdup (g_value_get_string (value));
+		g_free (extra->license);
+		extra->license = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_GROUP:
-		priv->group = g_value_get_enum (value);
+		extra->group = g_value_get_enum (value);
 		break;
 	case PROP_DESCRIPTION:
-		g_free (priv->description);
-		priv->description = g_strdup (g_value_get_string (value));
+		g_free (extra->description);
+		extra->description = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_URL:
-		g_free (priv->url);
-		priv->url = g_strdup (g_value_get_string (value));
+		g_free (extra->url);
+		extra->url = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_SIZE:
-		priv->size = g_value_get_uint64 (value);
+		extra->size = g_value_get_uint64 (value);
 		break;
 	case PROP_UPDATE_UPDATES:
-		g_free (priv->update_updates);
-		priv->update_updates = g_strdup (g_value_get_string (value));
+		g_free (extra->update_updates);
+		extra->update_updates = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_UPDATE_OBSOLETES:
-		g_free (priv->update_obsoletes);
-		priv->update_obsoletes = g_strdup (g_value_get_string (value));
+		g_free (extra->update_obsoletes);
+		extra->update_obsoletes = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_UPDATE_VENDOR_URLS:
-		g_strfreev (priv->update_vendor_urls);
-		priv->update_vendor_urls = g_strdupv (g_value_get_boxed (value));
+		g_strfreev (extra->update_vendor_urls);
+		extra->update_vendor_urls = g_strdupv (g_value_get_boxed (value));
 		break;
 	case PROP_UPDATE_BUGZILLA_URLS:
-		g_strfreev (priv->update_bugzilla_urls);
-		priv->update_bugzilla_urls = g_strdupv (g_value_get_boxed (value));
+		g_strfreev (extra->update_bugzilla_urls);
+		extra->update_bugzilla_urls = g_strdupv (g_value_get_boxed (value));
 		break;
 	case PROP_UPDATE_CVE_URLS:
-		g_strfreev (priv->update_cve_urls);
-		priv->update_cve_urls = g_strdupv (g_value_get_boxed (value));
+		g_strfreev (extra->update_cve_urls);
+		extra->update_cve_urls = g_strdupv (g_value_get_boxed (value));
 		break;
 	case PROP_UPDATE_RESTART:
-		priv->update_restart = g_value_get_enum (value);
+		extra->update_restart = g_value_get_enum (value);
 		break;
 	case PROP_UPDATE_UPDATE_TEXT:
-		g_free (priv->update_text);
-		priv->update_text = g_strdup (g_value_get_string (value));
+		g_free (extra->update_text);
+		extra->update_text = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_UPDATE_CHANGELOG:
-		g_free (priv->update_changelog);
-		priv->update_changelog = g_strdup (g_value_get_string (value));
+		g_free (extra->update_changelog);
+		extra->update_changelog = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_UPDATE_STATE:
-		priv->update_state = g_value_get_enum (value);
+		extra->update_state = g_value_get_enum (value);
 		break;
 	case PROP_UPDATE_ISSUED:
-		g_free (priv->update_issued);
-		priv->update_issued = g_strdup (g_value_get_string (value));
+		g_free (extra->update_issued);
+		extra->update_issued = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_UPDATE_UPDATED:
-		g_free (priv->update_updated);
-		priv->update_updated = g_strdup (g_value_get_string (value));
+		g_free (extra->update_updated);
+		extra->update_updated = g_strdup (g_value_get_string (value));
 		break;
 	case PROP_UPDATE_SEVERITY:
 		pk_package_set_update_severity (package, g_value_get_enum (value));
@@ -595,7 +706,8 @@ pk_package_class_init (PkPackageClass *klass)
 	pspec = g_param_spec_enum ("info", NULL,
 				   "The PkInfoEnum package type, e.g. PK_INFO_ENUM_NORMAL",
 				   PK_TYPE_INFO_ENUM, PK_INFO_ENUM_UNKNOWN,
-				   G_PARAM_READWRITE);
+				   G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+	obj_properties[PROP_INFO] = pspec;
 	g_object_class_install_property (object_class, PROP_INFO, pspec);
 
 	/**
@@ -834,10 +946,6 @@ static void
 pk_package_init (PkPackage *package)
 {
 	package->priv = PK_PACKAGE_GET_PRIVATE (package);
-	package->priv->package_id_split[PK_PACKAGE_ID_NAME] = NULL;
-	package->priv->package_id_split[PK_PACKAGE_ID_VERSION] = NULL;
-	package->priv->package_id_split[PK_PACKAGE_ID_ARCH] = NULL;
-	package->priv->package_id_split[PK_PACKAGE_ID_DATA] = NULL;
 }
 
 /*
@@ -849,22 +957,26 @@ pk_package_finalize (GObject *object)
 {
 	PkPackage *package = PK_PACKAGE (object);
 	PkPackagePrivate *priv = package->priv;
+	PkPackageExtra *extra = priv->extra;
 
 	g_free (priv->package_id);
 	g_free (priv->summary);
-	g_free (priv->license);
-	g_free (priv->description);
-	g_free (priv->url);
-	g_free (priv->update_updates);
-	g_free (priv->update_obsoletes);
-	g_strfreev (priv->update_vendor_urls);
-	g_strfreev (priv->update_bugzilla_urls);
-	g_strfreev (priv->update_cve_urls);
-	g_free (priv->update_text);
-	g_free (priv->update_changelog);
-	g_free (priv->update_issued);
-	g_free (priv->update_updated);
 	g_free (priv->package_id_data);
+	if (extra != NULL) {
+		g_free (extra->license);
+		g_free (extra->description);
+		g_free (extra->url);
+		g_free (extra->update_updates);
+		g_free (extra->update_obsoletes);
+		g_strfreev (extra->update_vendor_urls);
+		g_strfreev (extra->update_bugzilla_urls);
+		g_strfreev (extra->update_cve_urls);
+		g_free (extra->update_text);
+		g_free (extra->update_changelog);
+		g_free (extra->update_issued);
+		g_free (extra->update_updated);
+		g_free (extra);
+	}
 
 	G_OBJECT_CLASS (pk_package_parent_class)->finalize (object);
 }
@@ -32,6 +32,7 @@
 #include <glib-object.h>
 
 #include <packagekit-glib2/pk-source.h>
+#include <packagekit-glib2/pk-source-private.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
 
@@ -47,7 +48,7 @@ static void     pk_source_finalize	(GObject     *object);
 struct _PkSourcePrivate
 {
 	PkRoleEnum			 role;
-	gchar				*transaction_id;
+	GRefString			*transaction_id;
 };
 
 enum {
@@ -59,6 +60,37 @@ enum {
 
 G_DEFINE_TYPE (PkSource, pk_source, G_TYPE_OBJECT)
 
+/*
+ * pk_source_set_role:
+ * @source: a valid #PkSource instance
+ * @role: the #PkRoleEnum
+ *
+ * Sets the role without going through the GObject property machinery.
+ **/
+void
+pk_source_set_role (PkSource *source, PkRoleEnum role)
+{
+	g_return_if_fail (PK_IS_SOURCE (source));
+	source->priv->role = role;
+}
+
+/*
+ * pk_source_set_transaction_id:
+ * @source: a valid #PkSource instance
+ * @transaction_id: the transaction ID, or %NULL
+ *
+ * Sets the transaction ID. Every object of a transaction has the same ID,
+ * so the string is shared between all of them.
+ **/
+void
+pk_source_set_transaction_id (PkSource *source, const gchar *transaction_id)
+{
+	g_return_if_fail (PK_IS_SOURCE (source));
+	g_clear_pointer (&source->priv->transaction_id, g_ref_string_release);
+	if (transaction_id != NULL)
+		source->priv->transaction_id = g_ref_string_new_intern (transaction_id);
+}
+
 /*
  * pk_source_get_property:
  **/
@@ -88,15 +120,13 @@ static void
 pk_source_set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
 {
 	PkSource *source = PK_SOURCE (object);
-	PkSourcePrivate *priv = source->priv;
 
 	switch (prop_id) {
 	case PROP_ROLE:
-		priv->role = g_value_get_enum (value);
+		pk_source_set_role (source, g_value_get_enum (value));
 		break;
 	case PROP_TRANSACTION_ID:
-		g_free (priv->transaction_id);
-		priv->transaction_id = g_strdup (g_value_get_string (value));
+		pk_source_set_transaction_id (source, g_value_get_string (value));
 		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -157,7 +187,7 @@ pk_source_finalize (GObject *object)
 	PkSource *source = PK_SOURCE (object);
 	PkSourcePrivate *priv = source->priv;
 
-	g_free (priv->transaction_id);
+	g_clear_pointer (&priv->transaction_id, g_ref_string_release);
 
 	G_OBJECT_CLASS (pk_source_parent_class)->finalize (object);
 }
@@ -30,6 +30,7 @@
 #include <gio/gio.h>
 
 #include <packagekit-glib2/pk-task.h>
+#include <packagekit-glib2/pk-client-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
@@ -102,6 +103,7 @@ typedef struct {
 	PkBitfield			 filters;
 	PkUpgradeKindEnum		 upgrade_kind;
 	guint				 retry_id;
+	gchar				*plan_token;
 } PkTaskState;
 
 G_DEFINE_TYPE (PkTask, pk_task, PK_TYPE_CLIENT)
@@ -175,6 +177,7 @@ pk_task_generic_state_finish (PkTaskState *state, const GError *error)
 	g_free (state->distro_id);
 	g_free (state->repo_id);
 	g_free (state->transaction_id);
+	g_free (state->plan_token);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
 	g_strfreev (state->packages);
@@ -210,6 +213,9 @@ pk_task_do_async_action (PkTaskState *state)
 				PK_TRANSACTION_FLAG_ENUM_ALLOW_DOWNGRADE);
 	}
 
+	/* let the backend reuse the dependency solution of the simulate */
+	pk_client_set_plan_token (PK_CLIENT (state->task), state->plan_token);
+
 	/* do the correct action */
 	if (state->role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
 		pk_client_install_packages_async (PK_CLIENT(state->task), transaction_flags, state->package_ids,
@@ -316,6 +322,9 @@ pk_task_do_async_action (PkTaskState *state)
 	} else {
 		g_assert_not_reached ();
 	}
+
+	/* the token is only for this request */
+	pk_client_set_plan_token (PK_CLIENT (state->task), NULL);
 }
 
 /*
@@ -433,6 +442,12 @@ pk_task_do_async_simulate_action (PkTaskState *state)
 	pk_bitfield_add (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
 	state->simulate = TRUE;
 
+	/* the backend keeps the solution under this token so that the real
+	 * transaction does not have to resolve the dependencies again */
+	if (state->plan_token == NULL)
+		state->plan_token = g_uuid_string_random ();
+	pk_client_set_plan_token (PK_CLIENT (state->task), state->plan_token);
+
 	/* do the correct action */
 	if (state->role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
 		/* simulate install async */
@@ -505,6 +520,9 @@ pk_task_do_async_simulate_action (PkTaskState *state)
 	} else {
 		g_assert_not_reached ();
 	}
+
+	/* the token is only for this request */
+	pk_client_set_plan_token (PK_CLIENT (state->task), NULL);
 }
 
 /*
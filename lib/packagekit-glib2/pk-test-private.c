@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 
 #include "pk-common.h"
 #include "pk-debug.h"
@@ -31,8 +32,10 @@
 #include "pk-package.h"
 #include "pk-package-id.h"
 #include "pk-package-ids.h"
+#include "pk-package-sack.h"
 #include "pk-progress-bar.h"
 #include "pk-results.h"
+#include "pk-source-private.h"
 
 static void
 pk_test_bitfield_func (void)
@@ -199,12 +202,43 @@ pk_test_common_func (void)
 	g_date_free (date);
 }
 
+typedef struct {
+	const gchar	*(*to_string)	(guint		 value);
+	guint		 (*from_string)	(const gchar	*string);
+	guint		 last;
+} PkTestEnumFuncs;
+
+#define PK_TEST_ENUM_FUNCS(prefix, last) \
+	{ (const gchar *(*)(guint)) prefix##_to_string, \
+	  (guint (*)(const gchar *)) prefix##_from_string, last }
+
+static const PkTestEnumFuncs pk_test_enum_funcs[] = {
+	PK_TEST_ENUM_FUNCS (pk_role_enum, PK_ROLE_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_status_enum, PK_STATUS_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_exit_enum, PK_EXIT_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_network_enum, PK_NETWORK_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_filter_enum, PK_FILTER_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_restart_enum, PK_RESTART_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_error_enum, PK_ERROR_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_group_enum, PK_GROUP_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_update_state_enum, PK_UPDATE_STATE_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_info_enum, PK_INFO_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_distro_upgrade_enum, PK_DISTRO_UPGRADE_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_sig_type_enum, PK_SIGTYPE_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_media_type_enum, PK_MEDIA_TYPE_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_authorize_type_enum, PK_AUTHORIZE_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_upgrade_kind_enum, PK_UPGRADE_KIND_ENUM_LAST),
+	PK_TEST_ENUM_FUNCS (pk_transaction_flag_enum, PK_TRANSACTION_FLAG_ENUM_LAST),
+	{ NULL, NULL, 0 }
+};
+
 static void
 pk_test_enum_func (void)
 {
 	const gchar *string;
 	PkRoleEnum role_value;
 	guint i;
+	guint j;
 
 	/* find value */
 	role_value = pk_role_enum_from_string ("search-file");
@@ -323,6 +357,53 @@ pk_test_enum_func (void)
 			break;
 		}
 	}
+
+	/* every value of every enum survives a round trip */
+	for (j = 0; pk_test_enum_funcs[j].to_string != NULL; j++) {
+		const PkTestEnumFuncs *funcs = &pk_test_enum_funcs[j];
+		for (i = 0; i < funcs->last; i++) {
+			string = funcs->to_string (i);
+			g_assert (string != NULL);
+			g_assert_cmpint (funcs->from_string (string), ==, i);
+		}
+
+		/* unknown strings and values fall back to the first entry */
+		g_assert_cmpint (funcs->from_string ("xxx-not-found"), ==, funcs->from_string (NULL));
+		g_assert_cmpstr (funcs->to_string (funcs->last + 1000), ==, funcs->to_string (0));
+	}
+	g_assert_cmpint (pk_transaction_flag_enum_from_string ("download-size"), ==,
+			 PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE);
+	g_assert_cmpstr (pk_transaction_flag_enum_to_string (PK_TRANSACTION_FLAG_ENUM_EXT_DOWNLOAD_SIZE), ==,
+			 "download-size");
+	g_assert_cmpstr (pk_transaction_flag_enum_to_string (PK_TRANSACTION_FLAG_ENUM_LAST), ==, "none");
+}
+
+static void
+pk_test_enum_perf_func (void)
+{
+	const guint n_loops = 200000;
+	const gchar *strings[] = { "available", "installed", "untrusted", "finished", NULL };
+	gdouble elapsed;
+	guint i;
+	guint j;
+	g_autoptr(GTimer) timer = NULL;
+
+	timer = g_timer_new ();
+	for (i = 0; i < n_loops; i++) {
+		for (j = 0; strings[j] != NULL; j++)
+			g_assert_cmpint (pk_info_enum_from_string (strings[j]), !=, PK_INFO_ENUM_UNKNOWN);
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed, "looked up %u info strings in %.3fs", n_loops * 4, elapsed);
+
+	g_timer_reset (timer);
+	for (i = 0; i < n_loops; i++) {
+		for (j = 1; j < PK_INFO_ENUM_LAST; j++)
+			g_assert (pk_info_enum_to_string (j) != NULL);
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed, "looked up %u info values in %.3fs",
+				 n_loops * (PK_INFO_ENUM_LAST - 1), elapsed);
 }
 
 static void
@@ -595,9 +676,234 @@ pk_test_package_func (void)
 	g_assert_cmpstr (text, ==, "gnome-power-manager;0.1.2;i386;fedora");
 	g_free (text);
 
+	/* get the sections of set package */
+	g_assert_cmpstr (pk_package_get_name (package), ==, "gnome-power-manager");
+	g_assert_cmpstr (pk_package_get_version (package), ==, "0.1.2");
+	g_assert_cmpstr (pk_package_get_arch (package), ==, "i386");
+	g_assert_cmpstr (pk_package_get_data (package), ==, "fedora");
+	g_assert (pk_package_get_arch (package) == g_intern_static_string ("i386"));
+
+	/* sections change with the id */
+	ret = pk_package_set_id (package, "powertop;0.1.3;x86_64;installed:fedora", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (pk_package_get_name (package), ==, "powertop");
+	g_assert_cmpstr (pk_package_get_version (package), ==, "0.1.3");
+	g_assert_cmpstr (pk_package_get_arch (package), ==, "x86_64");
+	g_assert_cmpstr (pk_package_get_data (package), ==, "installed:fedora");
+
+	/* details are unset until written */
+	g_object_get (package, "license", &text, NULL);
+	g_assert_cmpstr (text, ==, NULL);
+	g_object_set (package, "license", "GPLv2+", NULL);
+	g_object_get (package, "license", &text, NULL);
+	g_assert_cmpstr (text, ==, "GPLv2+");
+	g_free (text);
+
 	g_object_unref (package);
 }
 
+static void
+pk_test_package_perf_func (void)
+{
+	const guint n_packages = 40000;
+	gdouble elapsed;
+	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GTimer) timer = NULL;
+
+	/* build the packages the same way a Package signal does, which
+	 * includes splitting the package-id */
+	array = g_ptr_array_new_with_free_func (g_object_unref);
+	timer = g_timer_new ();
+	for (i = 0; i < n_packages; i++) {
+		PkPackage *package = pk_package_new ();
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("package%05u;1.%u-1.fc36;x86_64;fedora", i, i);
+		g_assert (pk_package_set_id (package, package_id, NULL));
+		pk_package_set_info (package, PK_INFO_ENUM_AVAILABLE);
+		pk_package_set_summary (package, "A package with a summary");
+		pk_package_set_update_severity (package, PK_INFO_ENUM_UNKNOWN);
+		pk_source_set_role (PK_SOURCE (package), PK_ROLE_ENUM_GET_PACKAGES);
+		pk_source_set_transaction_id (PK_SOURCE (package), "/1234_abcdefgh");
+		g_ptr_array_add (array, package);
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed, "created %u packages in %.3fs", n_packages, elapsed);
+
+	/* the getters only return the sections stored by set_id */
+	g_timer_reset (timer);
+	for (i = 0; i < array->len; i++) {
+		PkPackage *package = g_ptr_array_index (array, i);
+		g_assert (pk_package_get_arch (package) != NULL);
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed, "read %u package arches in %.3fs", n_packages, elapsed);
+}
+
+static void
+pk_test_package_sack_add (PkPackageSack *sack, const gchar *package_id,
+			  PkInfoEnum info, const gchar *summary)
+{
+	g_autoptr(PkPackage) package = pk_package_new ();
+	g_assert (pk_package_set_id (package, package_id, NULL));
+	pk_package_set_info (package, info);
+	pk_package_set_summary (package, summary);
+	g_assert (pk_package_sack_add_package (sack, package));
+}
+
+static gboolean
+pk_test_package_sack_filter_cb (PkPackage *package, gpointer user_data)
+{
+	return g_strcmp0 (pk_package_get_name (package), "powertop") != 0;
+}
+
+static void
+pk_test_package_sack_func (void)
+{
+	PkPackage *package;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(PkPackageSack) sack_tmp = NULL;
+
+	sack = pk_package_sack_new ();
+	pk_test_package_sack_add (sack, "powertop;0.1.3;i386;fedora",
+				  PK_INFO_ENUM_INSTALLED, "Power consumption monitor");
+	pk_test_package_sack_add (sack, "kernel;5.1;x86_64;fedora",
+				  PK_INFO_ENUM_AVAILABLE, "The Linux kernel");
+	pk_test_package_sack_add (sack, "kernel;5.2;x86_64;updates",
+				  PK_INFO_ENUM_AVAILABLE, "A newer Linux kernel");
+
+	/* first match in array order, which builds the name+arch index */
+	package = pk_package_sack_find_by_id_name_arch (sack, "kernel;6.0;x86_64;foo");
+	g_assert (package != NULL);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "kernel;5.1;x86_64;fedora");
+	g_object_unref (package);
+	package = pk_package_sack_find_by_id_name_arch (sack, "kernel;6.0;i686;foo");
+	g_assert (package == NULL);
+
+	/* build the info index */
+	sack_tmp = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpint (pk_package_sack_get_size (sack_tmp), ==, 2);
+	g_clear_object (&sack_tmp);
+
+	/* the indexes follow removals and additions */
+	g_assert (pk_package_sack_remove_package_by_id (sack, "kernel;5.1;x86_64;fedora"));
+	g_assert (!pk_package_sack_remove_package_by_id (sack, "kernel;5.1;x86_64;fedora"));
+	pk_test_package_sack_add (sack, "kernel;5.3;i686;updates",
+				  PK_INFO_ENUM_AVAILABLE, "An i686 Linux kernel");
+	package = pk_package_sack_find_by_id_name_arch (sack, "kernel;;x86_64;");
+	g_assert (package != NULL);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "kernel;5.2;x86_64;updates");
+	g_object_unref (package);
+	package = pk_package_sack_find_by_id_name_arch (sack, "kernel;;i686;");
+	g_assert (package != NULL);
+	g_object_unref (package);
+	sack_tmp = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpint (pk_package_sack_get_size (sack_tmp), ==, 2);
+	g_clear_object (&sack_tmp);
+
+	/* changing the info of a package in the sack is noticed */
+	package = pk_package_sack_find_by_id (sack, "kernel;5.3;i686;updates");
+	g_assert (package != NULL);
+	pk_package_set_info (package, PK_INFO_ENUM_INSTALLED);
+	g_object_unref (package);
+	sack_tmp = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (sack_tmp), ==, 2);
+	g_clear_object (&sack_tmp);
+
+	/* sort uses the cached keys */
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_NAME);
+	array = pk_package_sack_get_array (sack);
+	g_assert_cmpint (array->len, ==, 3);
+	g_assert_cmpstr (pk_package_get_name (g_ptr_array_index (array, 0)), ==, "kernel");
+	g_assert_cmpstr (pk_package_get_name (g_ptr_array_index (array, 2)), ==, "powertop");
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_SUMMARY);
+	g_assert_cmpstr (pk_package_get_summary (g_ptr_array_index (array, 0)), ==, "A newer Linux kernel");
+	g_assert_cmpstr (pk_package_get_summary (g_ptr_array_index (array, 2)), ==, "Power consumption monitor");
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_INFO);
+	g_assert_cmpint (pk_package_get_info (g_ptr_array_index (array, 2)), ==, PK_INFO_ENUM_INSTALLED);
+
+	/* remove in one pass */
+	g_assert (pk_package_sack_remove_by_filter (sack, pk_test_package_sack_filter_cb, NULL));
+	g_assert (!pk_package_sack_remove_by_filter (sack, pk_test_package_sack_filter_cb, NULL));
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 2);
+	package = pk_package_sack_find_by_id (sack, "powertop;0.1.3;i386;fedora");
+	g_assert (package == NULL);
+	package = pk_package_sack_find_by_id_name_arch (sack, "powertop;;i386;");
+	g_assert (package == NULL);
+
+	pk_package_sack_clear (sack);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 0);
+	package = pk_package_sack_find_by_id_name_arch (sack, "kernel;;x86_64;");
+	g_assert (package == NULL);
+}
+
+static void
+pk_test_package_sack_file_func (void)
+{
+	GPtrArray *array;
+	PkPackage *package;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *filename_bad = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFile) file_bad = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(PkPackageSack) sack_tmp = NULL;
+	g_autoptr(PkPackageSack) sack_bad = NULL;
+
+	tmpdir = g_dir_make_tmp ("pk-self-test-sack-XXXXXX", &error);
+	g_assert_no_error (error);
+	g_assert (tmpdir != NULL);
+
+	sack = pk_package_sack_new ();
+	pk_test_package_sack_add (sack, "powertop;0.1.3;i386;fedora",
+				  PK_INFO_ENUM_INSTALLED, "Power consumption monitor");
+	pk_test_package_sack_add (sack, "kernel;5.1;x86_64;fedora",
+				  PK_INFO_ENUM_AVAILABLE, "The Linux kernel");
+	pk_test_package_sack_add (sack, "kernel;5.2;x86_64;updates",
+				  PK_INFO_ENUM_AVAILABLE, "The Linux kernel");
+
+	/* write and read back */
+	filename = g_build_filename (tmpdir, "sack.txt", NULL);
+	file = g_file_new_for_path (filename);
+	ret = pk_package_sack_to_file (sack, file, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	sack_tmp = pk_package_sack_new ();
+	ret = pk_package_sack_add_packages_from_file (sack_tmp, file, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (pk_package_sack_get_size (sack_tmp), ==, 3);
+	array = pk_package_sack_get_array (sack_tmp);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "powertop;0.1.3;i386;fedora");
+	g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_package_get_summary (package), ==, "Power consumption monitor");
+	package = g_ptr_array_index (array, 2);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "kernel;5.2;x86_64;updates");
+	g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpstr (pk_package_get_summary (package), ==, "The Linux kernel");
+	g_ptr_array_unref (array);
+	g_unlink (filename);
+
+	/* a line without a summary is rejected */
+	filename_bad = g_build_filename (tmpdir, "bad.txt", NULL);
+	ret = g_file_set_contents (filename_bad, "installed\tpowertop;0.1.3;i386;fedora\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	file_bad = g_file_new_for_path (filename_bad);
+	sack_bad = pk_package_sack_new ();
+	ret = pk_package_sack_add_packages_from_file (sack_bad, file_bad, &error);
+	g_assert (error != NULL);
+	g_assert (!ret);
+	g_unlink (filename_bad);
+	g_rmdir (tmpdir);
+}
+
 static void
 pk_test_offline_func (void)
 {
@@ -929,6 +1235,12 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
 	g_test_add_func ("/packagekit-glib2/results", pk_test_results_func);
 	g_test_add_func ("/packagekit-glib2/package", pk_test_package_func);
+	if (g_test_perf ())
+		g_test_add_func ("/packagekit-glib2/package-perf", pk_test_package_perf_func);
+	if (g_test_perf ())
+		g_test_add_func ("/packagekit-glib2/enum-perf", pk_test_enum_perf_func);
+	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
+	g_test_add_func ("/packagekit-glib2/package-sack-file", pk_test_package_sack_file_func);
 	g_test_add_func ("/packagekit-glib2/progress-bar", pk_test_progress_bar);
 	g_test_add_func ("/packagekit-glib2/offline", pk_test_offline_func);
 	g_test_add_func ("/packagekit-glib2/offline-upgrade", pk_test_offline_upgrade_func);
@@ -24,7 +24,10 @@
 # imports
 from __future__ import print_function
 
+import atexit
 import sys
+import threading
+import time
 import traceback
 import os.path
 
@@ -53,13 +56,79 @@ class PkError(Exception):
     def __str__(self):
         return repr("%s: %s" % (self.code, self.details))
 
+class BufferedOutput:
+    '''
+    Collects the lines for the daemon and writes them out in batches, so
+    that large results don't cost a write and a wakeup of the daemon per
+    line. Pending lines are written once max_size characters are queued,
+    max_delay seconds after the first of them was queued, or on flush().
+    A max_size of 0 writes every line immediately.
+    '''
+
+    def __init__(self, stream, max_size=16384, max_delay=0.02):
+        self.stream = stream
+        self.max_size = max_size
+        self.max_delay = max_delay
+        self._lines = []
+        self._size = 0
+        self._deadline = 0
+        self._cond = threading.Condition()
+        self._timer = None
+
+    def write(self, line):
+        with self._cond:
+            self._lines.append(line)
+            self._size += len(line)
+            if self._size >= self.max_size:
+                self._flush()
+            elif len(self._lines) == 1:
+                self._deadline = time.monotonic() + self.max_delay
+                if self._timer is None:
+                    self._timer = threading.Thread(target=self._run, daemon=True)
+                    self._timer.start()
+                self._cond.notify()
+
+    def flush(self):
+        with self._cond:
+            self._flush()
+
+    def _flush(self):
+        if self._lines:
+            self.stream.write(''.join(self._lines))
+            self._lines = []
+            self._size = 0
+        self.stream.flush()
+
+    def _run(self):
+        # writes the lines which are left waiting for max_delay
+        with self._cond:
+            while True:
+                if not self._lines:
+                    self._cond.wait()
+                    continue
+                remaining = self._deadline - time.monotonic()
+                if remaining > 0:
+                    self._cond.wait(remaining)
+                else:
+                    self._flush()
+
 class PackageKitBaseBackend:
 
     def __init__(self, cmds):
+        # Everything for the daemon goes through this, the exception
+        # handler needs it as well
+        self._output = BufferedOutput(sys.stdout)
+        atexit.register(self._output.flush)
+        self._percentage_sent = None
+        self._item_progress_sent = {}
+
         # Setup a custom exception handler
         installExceptionHandler(self)
         self.cmds = cmds
         self._locked = False
+        self._read_environment()
+
+    def _read_environment(self):
         self.lang = "C"
         self.has_network = False
         self.uid = 0
@@ -118,34 +187,48 @@ class PackageKitBaseBackend:
     def isLocked(self):
         return self._locked
 
+    def reset(self, environ):
+        '''
+        Prepare the dispatcher for the next transaction, overide and extend
+        in child class to drop state that must not be carried over
+        @param environ: The environment of the next transaction, replacing
+        the current one
+        '''
+        os.environ.clear()
+        os.environ.update(environ)
+        self._read_environment()
+        self._percentage_sent = None
+        self._item_progress_sent = {}
+
     def percentage(self, percent=None):
         '''
-        Write progress percentage
+        Write progress percentage, unless it is the same as the last one
         @param percent: Progress percentage (int preferred)
         '''
         if percent == None:
-            sys.stdout.write(_to_utf8("no-percentage-updates\n"))
-        elif percent == 0 or percent > self.percentage_old:
-            sys.stdout.write(_to_utf8("percentage\t%i\n" % percent))
+            self._output.write(_to_utf8("no-percentage-updates\n"))
+        elif percent != self._percentage_sent and (percent == 0 or percent > self.percentage_old):
+            self._output.write(_to_utf8("percentage\t%i\n" % percent))
             self.percentage_old = percent
-        sys.stdout.flush()
+            self._percentage_sent = percent
 
     def speed(self, bps=0):
         '''
         Write progress speed
         @param bps: Progress speed (int, bytes per second)
         '''
-        sys.stdout.write(_to_utf8("speed\t%i\n" % bps))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("speed\t%i\n" % bps))
 
     def item_progress(self, package_id, status, percent=None):
         '''
-        send 'itemprogress' signal
+        send 'itemprogress' signal, unless nothing changed for the package
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param percent: percentage of the current item (int preferred)
         '''
-        sys.stdout.write(_to_utf8("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent)))
-        sys.stdout.flush()
+        if self._item_progress_sent.get(package_id) == (status, percent):
+            return
+        self._item_progress_sent[package_id] = (status, percent)
+        self._output.write(_to_utf8("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent)))
 
     def error(self, err, description, exit=True):
         '''
@@ -159,8 +242,8 @@ class PackageKitBaseBackend:
             self.unLock()
 
         # this should be fast now
-        sys.stdout.write(_to_utf8("error\t%s\t%s\n" % (err, description)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("error\t%s\t%s\n" % (err, description)))
+        self._output.flush()
         if exit:
             # Paradoxically, we don't want to print "finished" to stdout here.
             # Python takes an _enormous_ amount of time to exit, and leaves a
@@ -174,8 +257,7 @@ class PackageKitBaseBackend:
         send 'message' signal
         @param typ: MESSAGE_BROKEN_MIRROR
         '''
-        sys.stdout.write(_to_utf8("message\t%s\t%s\n" % (typ, msg)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("message\t%s\t%s\n" % (typ, msg)))
 
     def package(self, package_id, status, summary):
         '''
@@ -184,8 +266,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param summary: The package Summary
         '''
-        sys.stdout.write(_to_utf8("package\t%s\t%s\t%s\n" % (status, package_id, summary)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("package\t%s\t%s\t%s\n" % (status, package_id, summary)))
 
     def media_change_required(self, mtype, id, text):
         '''
@@ -194,8 +275,8 @@ class PackageKitBaseBackend:
         @param id: the localised label of the media
         @param text: the localised text describing the media
         '''
-        sys.stdout.write(_to_utf8("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text)))
+        self._output.flush()
 
     def distro_upgrade(self, dtype, name, summary):
         '''
@@ -204,16 +285,15 @@ class PackageKitBaseBackend:
         @param name: The distro name, e.g. "fedora-9"
         @param summary: The localised distribution name and description
         '''
-        sys.stdout.write(_to_utf8("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary)))
 
     def status(self, state):
         '''
         send 'status' signal
         @param state: STATUS_DOWNLOAD, STATUS_INSTALL, STATUS_UPDATE, STATUS_REMOVE, STATUS_WAIT
         '''
-        sys.stdout.write(_to_utf8("status\t%s\n" % state))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("status\t%s\n" % state))
+        self._output.flush()
 
     def repo_detail(self, repoid, name, state):
         '''
@@ -221,16 +301,14 @@ class PackageKitBaseBackend:
         @param repoid: The repo id tag
         @param state: false is repo is disabled else true.
         '''
-        sys.stdout.write(_to_utf8("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state))))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state))))
 
     def data(self, data):
         '''
         send 'data' signal:
         @param data:  The current worked on package
         '''
-        sys.stdout.write(_to_utf8("data\t%s\n" % data))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("data\t%s\n" % data))
 
     def details(self, package_id, summary, package_license, group, desc, url, bytes):
         '''
@@ -243,16 +321,14 @@ class PackageKitBaseBackend:
         @param url: The upstream project homepage
         @param bytes: The size of the package, in bytes
         '''
-        sys.stdout.write(_to_utf8("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes)))
 
     def files(self, package_id, file_list):
         '''
         Send 'files' signal
         @param file_list: List of the files in the package, separated by ';'
         '''
-        sys.stdout.write(_to_utf8("files\t%s\t%s\n" % (package_id, file_list)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("files\t%s\t%s\n" % (package_id, file_list)))
 
     def category(self, parent_id, cat_id, name, summary, icon):
         '''
@@ -263,15 +339,14 @@ class PackageKitBaseBackend:
         summery   : a summary of the category in current locale.
         icon      : an icon name to represent the category
         '''
-        sys.stdout.write(_to_utf8("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon)))
 
     def finished(self):
         '''
         Send 'finished' signal
         '''
-        sys.stdout.write(_to_utf8("finished\n"))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("finished\n"))
+        self._output.flush()
 
     def update_detail(self, package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated):
         '''
@@ -289,8 +364,7 @@ class PackageKitBaseBackend:
         @param issued:
         @param updated:
         '''
-        sys.stdout.write(_to_utf8("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)))
 
     def require_restart(self, restart_type, details):
         '''
@@ -298,8 +372,7 @@ class PackageKitBaseBackend:
         @param restart_type: RESTART_SYSTEM, RESTART_APPLICATION, RESTART_SESSION
         @param details: Optional details about the restart
         '''
-        sys.stdout.write(_to_utf8("requirerestart\t%s\t%s\n" % (restart_type, details)))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("requirerestart\t%s\t%s\n" % (restart_type, details)))
 
     def allow_cancel(self, allow):
         '''
@@ -310,8 +383,7 @@ class PackageKitBaseBackend:
             data = 'true'
         else:
             data = 'false'
-        sys.stdout.write(_to_utf8("allow-cancel\t%s\n" % data))
-        sys.stdout.flush()
+        self._output.write(_to_utf8("allow-cancel\t%s\n" % data))
 
     def repo_signature_required(self, package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type):
         '''
@@ -325,10 +397,10 @@ class PackageKitBaseBackend:
         @param key_timestamp:   Key timestamp
         @param sig_type:        Key type (GPG)
         '''
-        sys.stdout.write(_to_utf8("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
+        self._output.write(_to_utf8("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
             package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type
             )))
-        sys.stdout.flush()
+        self._output.flush()
 
     def eula_required(self, eula_id, package_id, vendor_name, license_agreement):
         '''
@@ -338,10 +410,10 @@ class PackageKitBaseBackend:
         @param vendor_name:     Name of the vendor that wrote the EULA
         @param license_agreement: The license text
         '''
-        sys.stdout.write(_to_utf8("eula-required\t%s\t%s\t%s\t%s\n" % (
+        self._output.write(_to_utf8("eula-required\t%s\t%s\t%s\t%s\n" % (
             eula_id, package_id, vendor_name, license_agreement
             )))
-        sys.stdout.flush()
+        self._output.flush()
 
 #
 # Backend Action Methods
@@ -719,6 +791,12 @@ class PackageKitBaseBackend:
         elif cmd == 'repair-system':
             self.repair_system(args[0])
             self.finished()
+        elif cmd == 'reset':
+            environ = dict(arg.split('=', 1) for arg in args if '=' in arg)
+            self.reset(environ)
+        elif cmd == 'ping':
+            self._output.write("pong\n")
+            self._output.flush()
         else:
             errmsg = "command '%s' is not known" % cmd
             self.error(ERROR_INTERNAL_ERROR, errmsg, exit=False)
@@ -21,9 +21,8 @@
 # imports
 from .enums import *
 from .package import PackagekitPackage
-import collections
 
-class PackagekitFilter(object, PackagekitPackage):
+class PackagekitFilter(PackagekitPackage):
 
     def __init__(self, fltlist="none"):
         ''' save state '''
@@ -33,93 +32,121 @@ class PackagekitFilter(object, PackagekitPackage):
 
     def add_installed(self, pkgs):
         ''' add a list of packages that are already installed '''
-        for pkg in pkgs:
-            self.package_list.append((pkg, INFO_INSTALLED))
+        self.package_list.extend((pkg, INFO_INSTALLED) for pkg in pkgs)
 
     def add_available(self, pkgs):
         ''' add a list of packages that are available '''
-        for pkg in pkgs:
-            self.package_list.append((pkg, INFO_AVAILABLE))
+        self.package_list.extend((pkg, INFO_AVAILABLE) for pkg in pkgs)
 
     def add_custom(self, pkg, info):
         ''' add a custom packages indervidually '''
         self.package_list.append((pkg, info))
 
-    def _filter_base(self, pkg):
-        ''' do extra filtering (gui, devel etc) '''
+    def _get_checks(self, filters):
+        '''
+        Returns a list of (predicate, wanted) for the filters in fltlist
+        that are in filters, with each predicate only listed once.
+        wanted is None if the filter list asks for both values.
+        '''
+        checks = []
+        wants = {}
         for flt in self.fltlist:
-            if flt in (FILTER_GUI, FILTER_NOT_GUI):
-                if not self._do_gui_filtering(flt, pkg):
-                    return False
-            elif flt in (FILTER_DEVELOPMENT, FILTER_NOT_DEVELOPMENT):
-                if not self._do_devel_filtering(flt, pkg):
-                    return False
-            elif flt in (FILTER_FREE, FILTER_NOT_FREE):
-                if not self._do_free_filtering(flt, pkg):
-                    return False
-            elif flt in (FILTER_ARCH, FILTER_NOT_ARCH):
-                if not self._do_arch_filtering(flt, pkg):
-                    return False
+            if flt not in filters:
+                continue
+            predicate, want = filters[flt]
+            if predicate not in wants:
+                wants[predicate] = want
+                checks.append(predicate)
+            elif wants[predicate] != want:
+                wants[predicate] = None
+        return [(predicate, wants[predicate]) for predicate in checks]
+
+    def _get_base_checks(self):
+        ''' the checks for the extra filters (gui, devel etc) '''
+        return self._get_checks({
+            FILTER_GUI: (self._pkg_is_gui, True),
+            FILTER_NOT_GUI: (self._pkg_is_gui, False),
+            FILTER_DEVELOPMENT: (self._pkg_is_devel, True),
+            FILTER_NOT_DEVELOPMENT: (self._pkg_is_devel, False),
+            FILTER_FREE: (self._pkg_is_free, True),
+            FILTER_NOT_FREE: (self._pkg_is_free, False),
+            FILTER_ARCH: (self._pkg_is_arch, True),
+            FILTER_NOT_ARCH: (self._pkg_is_arch, False),
+        })
+
+    def _get_installed_checks(self):
+        ''' the checks for the installed state '''
+        return self._get_checks({
+            FILTER_INSTALLED: (self._pkg_is_installed, True),
+            FILTER_NOT_INSTALLED: (self._pkg_is_installed, False),
+        })
+
+    def _check(self, checks, pkg):
+        for predicate, want in checks:
+            if want is None or predicate(pkg) != want:
+                return False
         return True
 
+    def _filter_base(self, pkg):
+        ''' do extra filtering (gui, devel etc) '''
+        return self._check(self._get_base_checks(), pkg)
+
     def _filter_installed(self, pkg):
         ''' do extra filtering (gui, devel etc) '''
-        for flt in self.fltlist:
-            if flt in (FILTER_INSTALLED, FILTER_NOT_INSTALLED):
-                if not self._do_installed_filtering(flt, pkg):
-                    return False
-        return True
+        return self._check(self._get_installed_checks(), pkg)
 
     def get_package_list(self):
         '''
         do filtering we couldn't do when generating the list
         '''
+        base_checks = self._get_base_checks()
+        installed_checks = self._get_installed_checks()
+        check = self._check
 
         # filter common things here like architecture
         # NOTE: we can't do installed and ~installed here as we need
         # this data for the newest and downgrade checks below
-        package_list = self.package_list
-        self.package_list = []
-        for pkg, state in package_list:
-            if self._filter_base(pkg):
-                self.package_list.append((pkg, state))
-
-        # prepare lookup table of installed packages
-        installed_dict = collections.defaultdict(list)
-        for pkg, state in self.package_list:
-            if state is INFO_INSTALLED:
-                installed_dict[self._pkg_get_name(pkg)].append(pkg)
+        if base_checks:
+            package_list = [(pkg, state) for pkg, state in self.package_list
+                            if check(base_checks, pkg)]
+        else:
+            package_list = self.package_list
 
-        # check there are not available versions in the package list
-        # that are older than the installed version
-        package_list = self.package_list
-        self.package_list = []
+        # prepare lookup table of installed packages, only the names of
+        # available packages that have an installed version are compared
+        installed_dict = {}
         for pkg, state in package_list:
+            if state == INFO_INSTALLED:
+                installed_dict.setdefault(self._pkg_get_name(pkg), []).append(pkg)
 
-            add = True
-            if state is INFO_AVAILABLE:
-                for pkg_tmp in installed_dict[self._pkg_get_name(pkg)]:
-                    rc = self._pkg_compare(pkg, pkg_tmp)
-
-                    # don't add if the same as the installed package
-                    # or a downgrade to the existing installed package
-                    if rc == 0 or rc == -1:
-                        add = False
-                        break
-
-            if add:
-                self.package_list.append((pkg, state))
-
-        # filter installed state last
-        package_list = self.package_list
+        # check there are not available versions in the package list
+        # that are older than the installed version, and filter the
+        # installed state in the same pass
         self.package_list = []
+        append = self.package_list.append
         for pkg, state in package_list:
-            if self._filter_installed(pkg):
-                self.package_list.append((pkg, state))
+            if installed_dict and state == INFO_AVAILABLE:
+                installed = installed_dict.get(self._pkg_get_name(pkg))
+                if installed and self._is_downgrade(pkg, installed):
+                    continue
+            if installed_checks and not check(installed_checks, pkg):
+                continue
+            append((pkg, state))
 
         # do the backend specific filtering
         return self.post_process()
 
+    def _is_downgrade(self, pkg, installed):
+        '''
+        Return if pkg is the same as or older than one of the installed
+        packages of the same name
+        '''
+        for pkg_tmp in installed:
+            rc = self._pkg_compare(pkg, pkg_tmp)
+            if rc == 0 or rc == -1:
+                return True
+        return False
+
     def post_process(self):
         '''
         do filtering we couldn't do when generating the list
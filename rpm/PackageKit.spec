@@ -23,6 +23,7 @@ BuildRequires: polkit-devel >= 0.98
 BuildRequires: meson
 BuildRequires: gettext
 BuildRequires: libzypp-devel >= 5.20.0
+BuildRequires: pkgconfig(libcurl)
 BuildRequires: bzip2-devel
 BuildRequires: pkgconfig(systemd)
 BuildRequires: pkgconfig(mce)
@@ -21,6 +21,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib/gprintf.h>
 
@@ -78,6 +80,7 @@ struct PkBackendJobPrivate
 	gchar			*locale;
 	gchar			*no_proxy;
 	gchar			*pac;
+	gchar			*plan_token;
 	gchar			*proxy_ftp;
 	gchar			*proxy_http;
 	gchar			*proxy_https;
@@ -100,8 +103,10 @@ struct PkBackendJobPrivate
 	gboolean		 allow_cancel;
 	gboolean		 background;
 	gboolean		 interactive;
+	gboolean		 stream_results;
 	gboolean		 locked;
 	GHashTable		*emitted;
+	GHashTable		*emitted_installed;
 	PkErrorEnum		 last_error_code;
 	PkRoleEnum		 role;
 	PkStatusEnum		 status;
@@ -447,6 +452,34 @@ pk_backend_job_set_cache_age (PkBackendJob *job, guint cache_age)
 	job->priv->cache_age = cache_age;
 }
 
+/**
+ * pk_backend_job_get_plan_token:
+ *
+ * Gets the opaque token the client uses to tie a simulated transaction
+ * to the real one that follows it.
+ *
+ * Return value: the plan token, or %NULL for unset
+ **/
+const gchar *
+pk_backend_job_get_plan_token (PkBackendJob *job)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), NULL);
+	return job->priv->plan_token;
+}
+
+void
+pk_backend_job_set_plan_token (PkBackendJob *job, const gchar *plan_token)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+
+	if (g_strcmp0 (job->priv->plan_token, plan_token) == 0)
+		return;
+
+	g_debug ("plan-token changed to %s", plan_token);
+	g_free (job->priv->plan_token);
+	job->priv->plan_token = g_strdup (plan_token);
+}
+
 void
 pk_backend_job_set_user_data (PkBackendJob *job, gpointer user_data)
 {
@@ -482,6 +515,29 @@ pk_backend_job_set_interactive (PkBackendJob *job, gboolean interactive)
 	job->priv->interactive = interactive;
 }
 
+/**
+ * pk_backend_job_get_stream_results:
+ *
+ * Gets if the client accepts query results in any order. Backends can then
+ * emit each package as soon as they find it instead of collecting them
+ * first to emit the installed packages ahead of the available ones.
+ *
+ * Return value: %TRUE if results can be streamed
+ **/
+gboolean
+pk_backend_job_get_stream_results (PkBackendJob *job)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), FALSE);
+	return job->priv->stream_results;
+}
+
+void
+pk_backend_job_set_stream_results (PkBackendJob *job, gboolean stream_results)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	job->priv->stream_results = stream_results;
+}
+
 PkRoleEnum
 pk_backend_job_get_role (PkBackendJob *job)
 {
@@ -1001,6 +1057,24 @@ pk_backend_job_package_full (PkBackendJob *job,
 	                     g_strdup (pk_package_get_id (item)),
 	                     g_object_ref (item));
 
+	/* streamed results are not sorted by the backend, so drop the
+	 * available copy of a package that is already listed as installed */
+	if (job->priv->stream_results) {
+		gchar *nevra = g_strdup (package_id);
+		gchar *data = strrchr (nevra, ';');
+		if (data != NULL)
+			*data = '\0';
+		if (info == PK_INFO_ENUM_INSTALLED) {
+			g_hash_table_add (job->priv->emitted_installed, nevra);
+		} else {
+			gboolean installed = info == PK_INFO_ENUM_AVAILABLE &&
+					     g_hash_table_contains (job->priv->emitted_installed, nevra);
+			g_free (nevra);
+			if (installed)
+				return;
+		}
+	}
+
 	/* have we already set an error? */
 	if (job->priv->set_error) {
 		g_warning ("already set error: package %s", package_id);
@@ -1690,7 +1764,9 @@ pk_backend_job_finalize (GObject *object)
 	g_free (job->priv->cmdline);
 	g_free (job->priv->locale);
 	g_free (job->priv->frontend_socket);
+	g_free (job->priv->plan_token);
 	g_hash_table_unref (job->priv->emitted);
+	g_hash_table_unref (job->priv->emitted_installed);
 	if (job->priv->params != NULL)
 		g_variant_unref (job->priv->params);
 	g_timer_destroy (job->priv->timer);
@@ -1723,6 +1799,8 @@ pk_backend_job_init (PkBackendJob *job)
 	job->priv->status = PK_STATUS_ENUM_UNKNOWN;
 	job->priv->emitted = g_hash_table_new_full (g_str_hash, g_str_equal,
 	                                            g_free, (GDestroyNotify) g_object_unref);
+	job->priv->emitted_installed = g_hash_table_new_full (g_str_hash, g_str_equal,
+							      g_free, NULL);
 }
 
 /**
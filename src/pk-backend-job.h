@@ -102,6 +102,9 @@ void		 pk_backend_job_set_background		(PkBackendJob	*job,
 gboolean	 pk_backend_job_get_interactive		(PkBackendJob	*job);
 void		 pk_backend_job_set_interactive		(PkBackendJob	*job,
 							 gboolean	 interactive);
+gboolean	 pk_backend_job_get_stream_results	(PkBackendJob	*job);
+void		 pk_backend_job_set_stream_results	(PkBackendJob	*job,
+							 gboolean	 stream_results);
 void		 pk_backend_job_set_locked		(PkBackendJob	*job,
 							 gboolean	 locked);
 gboolean	 pk_backend_job_get_locked		(PkBackendJob	*job);
@@ -135,6 +138,8 @@ void		 pk_backend_job_set_frontend_socket	(PkBackendJob	*job,
 							 const gchar	*frontend_socket);
 void		 pk_backend_job_set_cache_age		(PkBackendJob	*job,
 							 guint		 cache_age);
+void		 pk_backend_job_set_plan_token		(PkBackendJob	*job,
+							 const gchar	*plan_token);
 const gchar	*pk_backend_job_get_proxy_ftp		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_proxy_http		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_proxy_https		(PkBackendJob	*job);
@@ -144,6 +149,7 @@ const gchar	*pk_backend_job_get_pac			(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_locale		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_frontend_socket	(PkBackendJob	*job);
 guint		 pk_backend_job_get_cache_age		(PkBackendJob	*job);
+const gchar	*pk_backend_job_get_plan_token		(PkBackendJob	*job);
 
 /* transaction vfuncs */
 typedef void	 (*PkBackendJobVFunc)			(PkBackendJob	*job,
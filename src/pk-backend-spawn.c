@@ -49,6 +49,8 @@
 
 #define PK_BACKEND_SPAWN_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_BACKEND_SPAWN, PkBackendSpawnPrivate))
 #define PK_BACKEND_SPAWN_PERCENTAGE_INVALID	101
+#define PK_BACKEND_SPAWN_WORKER_IDLE_TIMEOUT	60	/* s */
+#define PK_BACKEND_SPAWN_WORKER_MAX_MEMORY	512	/* MiB */
 
 #define	PK_UNSAFE_DELIMITERS	"\\\f\r\t"
 
@@ -63,6 +65,7 @@ struct PkBackendSpawnPrivate
 	gboolean		 finished;
 	gboolean		 allow_sigkill;
 	gboolean		 is_busy;
+	gboolean		 persistent;
 	PkBackendSpawnFilterFunc stdout_func;
 	PkBackendSpawnFilterFunc stderr_func;
 };
@@ -112,11 +115,32 @@ pk_backend_spawn_start_kill_timer (PkBackendSpawn *backend_spawn)
 	if (priv->kill_id > 0)
 		g_source_remove (priv->kill_id);
 
-	/* get policy timeout */
-	timeout = g_key_file_get_integer (priv->conf, "Daemon", "BackendShutdownTimeout", NULL);
-	if (timeout == 0) {
-		g_warning ("using built in default value");
-		timeout = 5;
+	/* a persistent worker is kept for longer, unless it grew too large */
+	if (priv->persistent) {
+		guint64 max_memory = PK_BACKEND_SPAWN_WORKER_MAX_MEMORY;
+		guint64 resident;
+
+		if (g_key_file_has_key (priv->conf, "Daemon", "BackendWorkerMaxMemory", NULL))
+			max_memory = g_key_file_get_uint64 (priv->conf, "Daemon", "BackendWorkerMaxMemory", NULL);
+		resident = pk_spawn_get_resident_size (priv->spawn);
+		if (max_memory > 0 && resident > max_memory * 1024 * 1024) {
+			g_debug ("dispatcher uses %" G_GUINT64_FORMAT " MiB, closing it",
+				 resident / 1024 / 1024);
+			priv->kill_id = g_idle_add ((GSourceFunc) pk_backend_spawn_exit_timeout_cb, backend_spawn);
+			g_source_set_name_by_id (priv->kill_id, "[PkBackendSpawn] exit");
+			return;
+		}
+
+		timeout = g_key_file_get_integer (priv->conf, "Daemon", "BackendWorkerIdleTimeout", NULL);
+		if (timeout <= 0)
+			timeout = PK_BACKEND_SPAWN_WORKER_IDLE_TIMEOUT;
+	} else {
+		/* get policy timeout */
+		timeout = g_key_file_get_integer (priv->conf, "Daemon", "BackendShutdownTimeout", NULL);
+		if (timeout == 0) {
+			g_warning ("using built in default value");
+			timeout = 5;
+		}
 	}
 
 	/* close down the dispatcher if it is still open after this much time */
@@ -901,6 +925,10 @@ pk_backend_spawn_helper_va_list (PkBackendSpawn *backend_spawn,
 	flags |= PK_SPAWN_ARGV_FLAGS_NEVER_REUSE;
 #endif
 
+	/* keep the warm dispatcher even if the environment changed */
+	if (priv->persistent)
+		flags |= PK_SPAWN_ARGV_FLAGS_RESET_ENVIRONMENT;
+
 	priv->finished = FALSE;
 	envp = pk_backend_spawn_get_envp (backend_spawn);
 	if (!pk_spawn_argv (priv->spawn, argv, envp, flags, &error)) {
@@ -1001,6 +1029,21 @@ pk_backend_spawn_set_allow_sigkill (PkBackendSpawn *backend_spawn, gboolean allo
 		      NULL);
 }
 
+/**
+ * pk_backend_spawn_set_persistent:
+ *
+ * Keep the dispatcher running across transactions, which is only possible
+ * if it implements the reset command. It is then closed after being idle
+ * for BackendWorkerIdleTimeout, or at once if it uses more memory than
+ * BackendWorkerMaxMemory.
+ **/
+void
+pk_backend_spawn_set_persistent (PkBackendSpawn *backend_spawn, gboolean persistent)
+{
+	g_return_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn));
+	backend_spawn->priv->persistent = persistent;
+}
+
 static void
 pk_backend_spawn_finalize (GObject *object)
 {
@@ -64,6 +64,8 @@ gboolean	 pk_backend_spawn_set_name		(PkBackendSpawn	*backend_spawn,
 							 const gchar	*name);
 void		 pk_backend_spawn_set_allow_sigkill	(PkBackendSpawn	*backend_spawn,
 							 gboolean	 allow_sigkill);
+void		 pk_backend_spawn_set_persistent	(PkBackendSpawn	*backend_spawn,
+							 gboolean	 persistent);
 gboolean	 pk_backend_spawn_inject_data		(PkBackendSpawn *backend_spawn,
 							 PkBackendJob	*job,
 							 const gchar	*line,
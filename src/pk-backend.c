@@ -46,6 +46,9 @@
  */
 #define PK_BACKEND_PERCENTAGE_DEFAULT		102
 
+/* drop cached update lists after this many seconds if nothing else has */
+#define PK_BACKEND_UPDATES_CACHE_MAX_AGE_DEFAULT	3600
+
 typedef struct {
 	const gchar	*description;
 	const gchar	*author;
@@ -58,6 +61,11 @@ typedef struct {
 	PkBitfield	(*get_provides)			(PkBackend	*backend);
 	gchar		**(*get_mime_types)		(PkBackend	*backend);
 	gboolean	(*supports_parallelization)	(PkBackend	*backend);
+	gchar		*(*get_updates_generation)	(PkBackend	*backend);
+	void		(*save_state)			(PkBackend	*backend,
+							 GKeyFile	*state);
+	void		(*restore_state)		(PkBackend	*backend,
+							 GKeyFile	*state);
 	void		(*job_start)			(PkBackend	*backend,
 							 PkBackendJob	*job);
 	void		(*job_stop)			(PkBackend	*backend,
@@ -209,8 +217,19 @@ struct PkBackendPrivate
 	guint			 repo_list_changed_id;
 	guint			 installed_db_changed_id;
 	guint			 updates_changed_id;
+	GHashTable		*updates_cache;		/* key : PkBackendUpdatesCacheItem */
+	guint			 updates_cache_serial;
+	guint			 updates_cache_hits;
+	guint			 updates_cache_misses;
+	guint			 updates_cache_max_age;
+	gchar			*updates_cache_generation;
 };
 
+typedef struct {
+	GPtrArray		*packages;
+	gint64			 created;		/* monotonic, in us */
+} PkBackendUpdatesCacheItem;
+
 G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
 
 enum {
@@ -258,6 +277,47 @@ pk_backend_supports_parallelization (PkBackend	*backend)
 	return backend->priv->desc->supports_parallelization (backend);
 }
 
+/**
+ * pk_backend_save_state:
+ * @backend: a loaded #PkBackend
+ * @state: the #GKeyFile written out when the daemon exits
+ *
+ * Lets the backend record anything worth carrying over to the next
+ * daemon start, e.g. whether its caches were warm. Backends should keep
+ * their keys in a group named after the backend.
+ **/
+void
+pk_backend_save_state (PkBackend *backend, GKeyFile *state)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (backend->priv->loaded);
+
+	/* not compulsory */
+	if (backend->priv->desc->save_state == NULL)
+		return;
+	backend->priv->desc->save_state (backend, state);
+}
+
+/**
+ * pk_backend_restore_state:
+ * @backend: a loaded #PkBackend
+ * @state: the #GKeyFile saved by the previous daemon instance
+ *
+ * Hands the state saved by pk_backend_save_state() back to the backend
+ * right after it has been initialized.
+ **/
+void
+pk_backend_restore_state (PkBackend *backend, GKeyFile *state)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (backend->priv->loaded);
+
+	/* not compulsory */
+	if (backend->priv->desc->restore_state == NULL)
+		return;
+	backend->priv->desc->restore_state (backend, state);
+}
+
 void
 pk_backend_thread_start (PkBackend *backend, PkBackendJob *job, gpointer func)
 {
@@ -522,6 +582,9 @@ pk_backend_load (PkBackend *backend, GError **error)
 		g_module_symbol (handle, "pk_backend_get_groups", (gpointer *)&desc->get_groups);
 		g_module_symbol (handle, "pk_backend_get_mime_types", (gpointer *)&desc->get_mime_types);
 		g_module_symbol (handle, "pk_backend_supports_parallelization", (gpointer *)&desc->supports_parallelization);
+		g_module_symbol (handle, "pk_backend_get_updates_generation", (gpointer *)&desc->get_updates_generation);
+		g_module_symbol (handle, "pk_backend_save_state", (gpointer *)&desc->save_state);
+		g_module_symbol (handle, "pk_backend_restore_state", (gpointer *)&desc->restore_state);
 		g_module_symbol (handle, "pk_backend_get_packages", (gpointer *)&desc->get_packages);
 		g_module_symbol (handle, "pk_backend_get_repo_list", (gpointer *)&desc->get_repo_list);
 		g_module_symbol (handle, "pk_backend_required_by", (gpointer *)&desc->required_by);
@@ -620,6 +683,7 @@ pk_backend_repo_list_changed_cb (gpointer user_data)
 {
 	PkBackend *backend = PK_BACKEND (user_data);
 
+	pk_backend_invalidate_updates_cache (backend);
 	g_debug ("emitting repo-list-changed");
 	g_signal_emit (backend, signals [SIGNAL_REPO_LIST_CHANGED], 0);
 	backend->priv->repo_list_changed_id = 0;
@@ -647,6 +711,7 @@ pk_backend_updates_changed (PkBackend *backend)
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
 	g_return_val_if_fail (pk_is_thread_default (), FALSE);
 
+	pk_backend_invalidate_updates_cache (backend);
 	g_debug ("emitting updates-changed");
 	g_signal_emit (backend, signals [SIGNAL_UPDATES_CHANGED], 0);
 	return TRUE;
@@ -680,12 +745,220 @@ pk_backend_updates_changed_delay (PkBackend *backend, guint timeout)
 	return TRUE;
 }
 
+static void
+pk_backend_updates_cache_item_free (PkBackendUpdatesCacheItem *item)
+{
+	g_ptr_array_unref (item->packages);
+	g_free (item);
+}
+
+static gchar *
+pk_backend_updates_cache_key (PkBitfield filters, const gchar *locale)
+{
+	return g_strdup_printf ("%" G_GUINT64_FORMAT ";%s",
+				filters, locale != NULL ? locale : "");
+}
+
+/**
+ * pk_backend_invalidate_updates_cache:
+ * @backend: a #PkBackend
+ *
+ * Drops all the cached GetUpdates results. Results that are still being
+ * calculated will not be added to the cache when they finish.
+ **/
+void
+pk_backend_invalidate_updates_cache (PkBackend *backend)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+
+	backend->priv->updates_cache_serial++;
+	if (g_hash_table_size (backend->priv->updates_cache) == 0)
+		return;
+	g_debug ("invalidating cached update lists");
+	g_hash_table_remove_all (backend->priv->updates_cache);
+}
+
+/**
+ * pk_backend_get_updates_cache_serial:
+ * @backend: a #PkBackend
+ *
+ * Gets the cache serial, which has to be saved before asking the backend
+ * for updates and passed to pk_backend_set_updates_cache() afterwards.
+ *
+ * Return value: the serial number
+ **/
+guint
+pk_backend_get_updates_cache_serial (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), 0);
+	return backend->priv->updates_cache_serial;
+}
+
+/**
+ * pk_backend_get_updates_generation:
+ * @backend: a #PkBackend
+ *
+ * Asks the backend for a string that changes whenever the installed
+ * packages or the repository metadata change, including changes made
+ * outside PackageKit.
+ *
+ * Return value: the generation, or %NULL if the backend cannot tell
+ **/
+gchar *
+pk_backend_get_updates_generation (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+
+	if (backend->priv->desc->get_updates_generation == NULL)
+		return NULL;
+	return backend->priv->desc->get_updates_generation (backend);
+}
+
+/**
+ * pk_backend_get_updates_cache:
+ * @backend: a #PkBackend
+ * @filters: the filters used for GetUpdates
+ * @locale: the locale of the transaction, or %NULL
+ * @max_age: the maximum age of the result in seconds, or %G_MAXUINT
+ *
+ * Looks up a cached GetUpdates result. Only backends that report a
+ * generation use the cache, and all entries are dropped when it changes.
+ *
+ * Return value: (transfer container): an array of #PkPackage, or %NULL
+ **/
+GPtrArray *
+pk_backend_get_updates_cache (PkBackend *backend,
+			      PkBitfield filters,
+			      const gchar *locale,
+			      guint max_age)
+{
+	PkBackendUpdatesCacheItem *item;
+	guint age;
+	g_autofree gchar *generation = NULL;
+	g_autofree gchar *key = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	g_return_val_if_fail (pk_is_thread_default (), NULL);
+
+	/* changes made outside PackageKit would go unnoticed */
+	generation = pk_backend_get_updates_generation (backend);
+	if (generation == NULL)
+		return NULL;
+	if (g_strcmp0 (generation, backend->priv->updates_cache_generation) != 0) {
+		g_debug ("updates generation changed to %s", generation);
+		pk_backend_invalidate_updates_cache (backend);
+		g_free (backend->priv->updates_cache_generation);
+		backend->priv->updates_cache_generation = g_steal_pointer (&generation);
+	}
+
+	key = pk_backend_updates_cache_key (filters, locale);
+	item = g_hash_table_lookup (backend->priv->updates_cache, key);
+	if (item == NULL) {
+		backend->priv->updates_cache_misses++;
+		return NULL;
+	}
+
+	/* too old for the backend or for the caller */
+	age = (g_get_monotonic_time () - item->created) / G_USEC_PER_SEC;
+	if (age >= backend->priv->updates_cache_max_age || age > max_age) {
+		if (age >= backend->priv->updates_cache_max_age)
+			g_hash_table_remove (backend->priv->updates_cache, key);
+		backend->priv->updates_cache_misses++;
+		return NULL;
+	}
+	backend->priv->updates_cache_hits++;
+	g_debug ("using cached update list for %s, %u seconds old", key, age);
+	return g_ptr_array_ref (item->packages);
+}
+
+/**
+ * pk_backend_set_updates_cache:
+ * @backend: a #PkBackend
+ * @serial: the value of pk_backend_get_updates_cache_serial() before the
+ *          backend was asked for updates
+ * @filters: the filters used for GetUpdates
+ * @locale: the locale of the transaction, or %NULL
+ * @packages: (element-type PkPackage): the packages the backend returned
+ *
+ * Saves a GetUpdates result so that identical requests can be answered
+ * without asking the backend again.
+ **/
+void
+pk_backend_set_updates_cache (PkBackend *backend,
+			      guint serial,
+			      PkBitfield filters,
+			      const gchar *locale,
+			      GPtrArray *packages)
+{
+	PkBackendUpdatesCacheItem *item;
+
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+
+	/* disabled, or something changed while the backend was busy */
+	if (backend->priv->updates_cache_max_age == 0)
+		return;
+	if (backend->priv->updates_cache_generation == NULL)
+		return;
+	if (serial != backend->priv->updates_cache_serial) {
+		g_debug ("not caching stale update list");
+		return;
+	}
+	item = g_new0 (PkBackendUpdatesCacheItem, 1);
+	item->packages = g_ptr_array_ref (packages);
+	item->created = g_get_monotonic_time ();
+	g_hash_table_insert (backend->priv->updates_cache,
+			     pk_backend_updates_cache_key (filters, locale),
+			     item);
+}
+
+/**
+ * pk_backend_get_updates_cache_info:
+ * @backend: a #PkBackend
+ *
+ * Gets statistics about the GetUpdates cache.
+ *
+ * Return value: a floating #GVariant of type a{sv}
+ **/
+GVariant *
+pk_backend_get_updates_cache_info (PkBackend *backend)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder;
+	PkBackendUpdatesCacheItem *item;
+	gint64 oldest = 0;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_hash_table_iter_init (&iter, backend->priv->updates_cache);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &item)) {
+		if (oldest == 0 || item->created < oldest)
+			oldest = item->created;
+	}
+	if (oldest != 0) {
+		g_variant_builder_add (&builder, "{sv}", "age",
+				       g_variant_new_uint32 ((g_get_monotonic_time () - oldest) / G_USEC_PER_SEC));
+	}
+	g_variant_builder_add (&builder, "{sv}", "entries",
+			       g_variant_new_uint32 (g_hash_table_size (backend->priv->updates_cache)));
+	g_variant_builder_add (&builder, "{sv}", "hits",
+			       g_variant_new_uint32 (backend->priv->updates_cache_hits));
+	g_variant_builder_add (&builder, "{sv}", "misses",
+			       g_variant_new_uint32 (backend->priv->updates_cache_misses));
+	return g_variant_builder_end (&builder);
+}
+
 static gboolean
 pk_backend_installed_db_changed_cb (gpointer user_data)
 {
 	PkBackend *backend = PK_BACKEND (user_data);
 	g_autoptr(GError) error = NULL;
 
+	/* the update list depends on what is installed */
+	pk_backend_invalidate_updates_cache (backend);
+
 	if (!backend->priv->transaction_in_progress) {
 		g_debug ("invalidating offline updates");
 		if (!pk_offline_auth_invalidate (&error))
@@ -1094,6 +1367,8 @@ pk_backend_finalize (GObject *object)
 		g_source_remove (backend->priv->transaction_inhibit_end_idle_id);
 	if (backend->priv->updates_changed_id != 0)
 		g_source_remove (backend->priv->updates_changed_id);
+	g_hash_table_unref (backend->priv->updates_cache);
+	g_free (backend->priv->updates_cache_generation);
 	if (backend->priv->handle != NULL)
 		g_module_close (backend->priv->handle);
 
@@ -1763,6 +2038,10 @@ pk_backend_init (PkBackend *backend)
 							    g_direct_equal,
 							    NULL,
 							    g_free);
+	backend->priv->updates_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							      (GDestroyNotify) pk_backend_updates_cache_item_free);
+	backend->priv->updates_cache_serial = 1;
+	backend->priv->updates_cache_max_age = PK_BACKEND_UPDATES_CACHE_MAX_AGE_DEFAULT;
 	g_mutex_init (&backend->priv->eulas_mutex);
 	g_mutex_init (&backend->priv->thread_hash_mutex);
 }
@@ -1773,6 +2052,17 @@ pk_backend_new (GKeyFile *conf)
 	PkBackend *backend;
 	backend = g_object_new (PK_TYPE_BACKEND, NULL);
 	backend->priv->conf = g_key_file_ref (conf);
+
+	/* zero disables the GetUpdates cache */
+	if (g_key_file_has_key (conf, "Daemon", "UpdatesCacheMaxAge", NULL)) {
+		gint max_age = g_key_file_get_integer (conf, "Daemon", "UpdatesCacheMaxAge", NULL);
+		if (max_age < 0) {
+			g_warning ("UpdatesCacheMaxAge=%i is invalid, disabling the updates cache",
+				   max_age);
+			max_age = 0;
+		}
+		backend->priv->updates_cache_max_age = max_age;
+	}
 	return PK_BACKEND (backend);
 }
 
@@ -90,6 +90,19 @@ void		 pk_backend_installed_db_changed	(PkBackend      *backend);
 gboolean	 pk_backend_updates_changed		(PkBackend	*backend);
 gboolean	 pk_backend_updates_changed_delay	(PkBackend	*backend,
 							 guint		 timeout);
+void		 pk_backend_invalidate_updates_cache	(PkBackend	*backend);
+gchar		*pk_backend_get_updates_generation	(PkBackend	*backend);
+guint		 pk_backend_get_updates_cache_serial	(PkBackend	*backend);
+GPtrArray	*pk_backend_get_updates_cache		(PkBackend	*backend,
+							 PkBitfield	 filters,
+							 const gchar	*locale,
+							 guint		 max_age);
+void		 pk_backend_set_updates_cache		(PkBackend	*backend,
+							 guint		 serial,
+							 PkBitfield	 filters,
+							 const gchar	*locale,
+							 GPtrArray	*packages);
+GVariant	*pk_backend_get_updates_cache_info	(PkBackend	*backend);
 
 void		 pk_backend_transaction_inhibit_start	(PkBackend      *backend);
 void		 pk_backend_transaction_inhibit_end	(PkBackend      *backend);
@@ -119,6 +132,10 @@ PkBitfield	 pk_backend_get_filters			(PkBackend	*backend);
 PkBitfield	 pk_backend_get_roles			(PkBackend	*backend);
 gchar		**pk_backend_get_mime_types		(PkBackend	*backend);
 gboolean	 pk_backend_supports_parallelization	(PkBackend	*backend);
+void		 pk_backend_save_state			(PkBackend	*backend,
+							 GKeyFile	*state);
+void		 pk_backend_restore_state		(PkBackend	*backend,
+							 GKeyFile	*state);
 void		 pk_backend_initialize			(GKeyFile		*conf,
 							 PkBackend	*backend);
 void		 pk_backend_destroy			(PkBackend	*backend);
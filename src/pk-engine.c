@@ -71,9 +71,19 @@ static void	pk_engine_set_locked (PkEngine *engine, gboolean is_locked);
 /* how long to wait after the computer has been resumed or any system event */
 #define PK_ENGINE_STATE_CHANGED_TIMEOUT_NORMAL		600 /* s */
 
+/* requests closer together than this count as one burst of activity */
+#define PK_ENGINE_ACTIVITY_BURST			30 /* s */
+
+/* how many bursts of activity to keep when adapting the exit timeout */
+#define PK_ENGINE_ACTIVITY_HISTORY			16
+
+/* state carried over from the previous daemon instance */
+#define PK_ENGINE_STATE_FILE				PK_DB_DIR "/daemon-state"
+
 struct PkEnginePrivate
 {
 	GTimer			*timer;
+	GArray			*activity;
 	gboolean		 notify_clients_of_upgrade;
 	gboolean		 shutdown_as_soon_as_possible;
 	PkScheduler		*scheduler;
@@ -656,6 +666,135 @@ pk_engine_get_seconds_idle (PkEngine *engine)
 	return idle;
 }
 
+static void
+pk_engine_record_activity (PkEngine *engine)
+{
+	GArray *activity = engine->priv->activity;
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+
+	/* only the start of each burst is interesting */
+	if (activity->len > 0 &&
+	    now - g_array_index (activity, gint64, activity->len - 1) < PK_ENGINE_ACTIVITY_BURST)
+		return;
+	g_array_append_val (activity, now);
+	if (activity->len > PK_ENGINE_ACTIVITY_HISTORY)
+		g_array_remove_index (activity, 0);
+}
+
+static gint
+pk_engine_gap_cmp (gconstpointer a, gconstpointer b)
+{
+	gint64 gap_a = *((const gint64 *) a);
+	gint64 gap_b = *((const gint64 *) b);
+	return (gap_a > gap_b) - (gap_a < gap_b);
+}
+
+/**
+ * pk_engine_get_exit_idle_time:
+ *
+ * Returns how long the daemon should stay idle before exiting. This is
+ * ShutdownTimeout, stretched up to ShutdownTimeoutMax when clients have
+ * recently been coming back at a steady interval that would otherwise
+ * just miss the running daemon and pay for a cold start every time.
+ **/
+guint
+pk_engine_get_exit_idle_time (PkEngine *engine)
+{
+	GArray *activity;
+	gint64 median;
+	guint timeout;
+	guint timeout_max;
+	g_autoptr(GArray) gaps = NULL;
+
+	g_return_val_if_fail (PK_IS_ENGINE (engine), 0);
+
+	timeout = MAX (g_key_file_get_integer (engine->priv->conf, "Daemon",
+					       "ShutdownTimeout", NULL), 0);
+	timeout_max = MAX (g_key_file_get_integer (engine->priv->conf, "Daemon",
+						   "ShutdownTimeoutMax", NULL), 0);
+	activity = engine->priv->activity;
+	if (timeout == 0 || timeout_max <= timeout || activity->len < 3)
+		return timeout;
+
+	/* the typical time between two bursts of requests */
+	gaps = g_array_sized_new (FALSE, FALSE, sizeof (gint64), activity->len - 1);
+	for (guint i = 1; i < activity->len; i++) {
+		gint64 gap = g_array_index (activity, gint64, i) -
+			     g_array_index (activity, gint64, i - 1);
+		g_array_append_val (gaps, gap);
+	}
+	g_array_sort (gaps, pk_engine_gap_cmp);
+	median = g_array_index (gaps, gint64, gaps->len / 2);
+
+	/* clients don't come back before we would shut down anyway, or
+	 * come back so rarely that staying around is not worth it */
+	if (median <= timeout || median > timeout_max)
+		return timeout;
+
+	/* leave some slack for jitter in the interval */
+	return (guint) MIN (median + median / 2, (gint64) timeout_max);
+}
+
+/**
+ * pk_engine_save_state:
+ *
+ * Writes the request history and whatever the backend wants to keep so
+ * that the next daemon instance can pick up where this one left off.
+ **/
+void
+pk_engine_save_state (PkEngine *engine)
+{
+	GArray *activity;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) state = g_key_file_new ();
+	g_autofree gint *times = NULL;
+
+	g_return_if_fail (PK_IS_ENGINE (engine));
+
+	/* keyfiles have no 64 bit integer lists, store relative to now */
+	activity = engine->priv->activity;
+	if (activity->len > 0) {
+		gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+		times = g_new0 (gint, activity->len);
+		for (guint i = 0; i < activity->len; i++)
+			times[i] = (gint) (now - g_array_index (activity, gint64, i));
+		g_key_file_set_integer_list (state, "Daemon", "Activity",
+					     times, activity->len);
+	}
+	pk_backend_save_state (engine->priv->backend, state);
+
+	if (!g_key_file_save_to_file (state, PK_ENGINE_STATE_FILE, &error))
+		g_warning ("failed to save daemon state: %s", error->message);
+}
+
+static void
+pk_engine_restore_state (PkEngine *engine)
+{
+	gsize len = 0;
+	gint64 now;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) state = g_key_file_new ();
+	g_autofree gint *times = NULL;
+
+	if (!g_key_file_load_from_file (state, PK_ENGINE_STATE_FILE,
+					G_KEY_FILE_NONE, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_warning ("failed to load daemon state: %s", error->message);
+		return;
+	}
+
+	/* a crashed instance must not hand over stale state */
+	g_unlink (PK_ENGINE_STATE_FILE);
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	times = g_key_file_get_integer_list (state, "Daemon", "Activity", &len, NULL);
+	for (gsize i = 0; i < len && i < PK_ENGINE_ACTIVITY_HISTORY; i++) {
+		gint64 time = now - times[i];
+		g_array_append_val (engine->priv->activity, time);
+	}
+	pk_backend_restore_state (engine->priv->backend, state);
+}
+
 static gboolean
 pk_engine_set_proxy_internal (PkEngine *engine, const gchar *sender,
 			      const gchar *proxy_http,
@@ -1202,6 +1341,9 @@ pk_engine_load_backend (PkEngine *engine, GError **error)
 	engine->priv->backend_name = pk_backend_get_name (engine->priv->backend);
 	engine->priv->backend_description = pk_backend_get_description (engine->priv->backend);
 	engine->priv->backend_author = pk_backend_get_author (engine->priv->backend);
+
+	/* pick up what the last instance left behind */
+	pk_engine_restore_state (engine);
 	return TRUE;
 }
 
@@ -1309,6 +1451,8 @@ pk_engine_daemon_get_property (GDBusConnection *connection_, const gchar *sender
 		return g_variant_new_uint32 (engine->priv->network_state);
 	if (g_strcmp0 (property_name, "DistroId") == 0)
 		return _g_variant_new_maybe_string (engine->priv->distro_id);
+	if (g_strcmp0 (property_name, "UpdatesCache") == 0)
+		return pk_backend_get_updates_cache_info (engine->priv->backend);
 
 	/* return an error */
 	g_set_error (error,
@@ -1513,6 +1657,7 @@ pk_engine_daemon_method_call (GDBusConnection *connection_, const gchar *sender,
 
 	/* reset the timer */
 	pk_engine_reset_timer (engine);
+	pk_engine_record_activity (engine);
 
 	if (g_strcmp0 (method_name, "GetTimeSinceAction") == 0) {
 		g_variant_get (parameters, "(u)", &role);
@@ -2054,6 +2199,7 @@ pk_engine_init (PkEngine *engine)
 	engine->priv->distro_id = pk_get_distro_id ();
 
 	engine->priv->timer = g_timer_new ();
+	engine->priv->activity = g_array_new (FALSE, FALSE, sizeof (gint64));
 
 	/* we need the uid and the session for the proxy setting mechanism */
 	engine->priv->dbus = pk_dbus_new ();
@@ -2137,6 +2283,7 @@ pk_engine_finalize (GObject *object)
 
 	/* compulsory gobjects */
 	g_timer_destroy (engine->priv->timer);
+	g_array_unref (engine->priv->activity);
 	g_object_unref (engine->priv->monitor_conf);
 	g_object_unref (engine->priv->monitor_binary);
 	g_object_unref (engine->priv->monitor_offline);
@@ -75,6 +75,8 @@ GType		 pk_engine_get_type		  	(void);
 PkEngine	*pk_engine_new				(GKeyFile		*conf);
 
 guint		 pk_engine_get_seconds_idle		(PkEngine	*engine);
+guint		 pk_engine_get_exit_idle_time		(PkEngine	*engine);
+void		 pk_engine_save_state			(PkEngine	*engine);
 gboolean	 pk_engine_load_backend			(PkEngine	*engine,
 							 GError		**error);
 
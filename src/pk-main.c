@@ -65,9 +65,17 @@ timed_exit_cb (GMainLoop *mainloop)
 static gboolean
 pk_main_timeout_check_cb (PkMainHelper *helper)
 {
+	guint exit_idle_time;
 	guint idle;
 	idle = pk_engine_get_seconds_idle (helper->engine);
 	g_debug ("idle is %i", idle);
+
+	/* this follows how often clients have been coming back */
+	exit_idle_time = pk_engine_get_exit_idle_time (helper->engine);
+	if (exit_idle_time != helper->exit_idle_time) {
+		g_debug ("daemon shutdown now set to %u seconds", exit_idle_time);
+		helper->exit_idle_time = exit_idle_time;
+	}
 	if (idle > helper->exit_idle_time) {
 		g_main_loop_quit (helper->loop);
 		helper->timer_id = 0;
@@ -97,7 +105,7 @@ main (int argc, char *argv[])
 {
 	GMainLoop *loop = NULL;
 	GOptionContext *context;
-	PkMainHelper helper;
+	PkMainHelper helper = { 0 };
 	gboolean ret = TRUE;
 	gboolean disable_timer = FALSE;
 	gboolean version = FALSE;
@@ -243,6 +251,9 @@ main (int argc, char *argv[])
 
 	/* run until quit */
 	g_main_loop_run (loop);
+
+	/* let the next instance start warm */
+	pk_engine_save_state (engine);
 out:
 	/* log the shutdown */
 	syslog (LOG_DAEMON | LOG_DEBUG, "daemon quit");
@@ -285,6 +285,113 @@ pk_test_backend_func (void)
 		         PK_EXIT_ENUM_NEED_UNTRUSTED);
 }
 
+static void
+pk_test_backend_updates_cache_func (void)
+{
+	guint serial;
+	guint value;
+	g_autofree gchar *generation = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) array_tmp = NULL;
+	g_autoptr(GVariant) info = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	/* the dummy backend can tell when its packages change */
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
+	backend = pk_backend_new (conf);
+	g_assert (pk_backend_load (backend, NULL));
+	generation = pk_backend_get_updates_generation (backend);
+	g_assert_cmpstr (generation, ==, "dummy");
+
+	package = pk_package_new ();
+	g_assert (pk_package_set_id (package, "powertop;1.8-1.fc8;i386;fedora", NULL));
+	pk_package_set_info (package, PK_INFO_ENUM_SECURITY);
+	array = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (array, g_object_ref (package));
+
+	/* nothing cached yet, the serial is taken after the lookup like
+	 * pk_transaction_replay_updates() does */
+	g_assert (pk_backend_get_updates_cache (backend, 0, "en_GB", G_MAXUINT) == NULL);
+	serial = pk_backend_get_updates_cache_serial (backend);
+
+	/* a matching request is replayed */
+	pk_backend_set_updates_cache (backend, serial, 0, "en_GB", array);
+	array_tmp = pk_backend_get_updates_cache (backend, 0, "en_GB", G_MAXUINT);
+	g_assert (array_tmp != NULL);
+	g_assert_cmpint (array_tmp->len, ==, 1);
+	g_clear_pointer (&array_tmp, g_ptr_array_unref);
+
+	/* different filters or locale are not */
+	g_assert (pk_backend_get_updates_cache (backend, 1, "en_GB", G_MAXUINT) == NULL);
+	g_assert (pk_backend_get_updates_cache (backend, 0, "de_DE", G_MAXUINT) == NULL);
+
+	/* results calculated before an invalidation are dropped */
+	serial = pk_backend_get_updates_cache_serial (backend);
+	pk_backend_invalidate_updates_cache (backend);
+	g_assert (pk_backend_get_updates_cache (backend, 0, "en_GB", G_MAXUINT) == NULL);
+	pk_backend_set_updates_cache (backend, serial, 0, "en_GB", array);
+	g_assert (pk_backend_get_updates_cache (backend, 0, "en_GB", G_MAXUINT) == NULL);
+
+	/* check the counters */
+	info = g_variant_ref_sink (pk_backend_get_updates_cache_info (backend));
+	g_assert (g_variant_is_of_type (info, G_VARIANT_TYPE ("a{sv}")));
+	g_assert (!g_variant_lookup (info, "age", "u", &value));
+	g_assert (g_variant_lookup (info, "hits", "u", &value));
+	g_assert_cmpint (value, ==, 1);
+	g_assert (g_variant_lookup (info, "misses", "u", &value));
+	g_assert_cmpint (value, ==, 5);
+}
+
+static void
+pk_test_backend_stream_results_package_cb (PkBackendJob *job, PkPackage *package, gpointer user_data)
+{
+	GPtrArray *array = (GPtrArray *) user_data;
+	g_ptr_array_add (array, g_strdup (pk_package_get_id (package)));
+}
+
+static void
+pk_test_backend_stream_results_func (void)
+{
+	g_autoptr(GKeyFile) conf = g_key_file_new ();
+	g_autoptr(GPtrArray) array = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(PkBackendJob) job = NULL;
+
+	job = pk_backend_job_new (conf);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_PACKAGE,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_stream_results_package_cb),
+				  array);
+	pk_backend_job_set_stream_results (job, TRUE);
+	g_assert (pk_backend_job_get_stream_results (job));
+
+	/* the available copy of an installed package is dropped */
+	pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
+				"powertop;1.8-1.fc8;i386;installed", "Power consumption monitor");
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"powertop;1.8-1.fc8;i386;fedora", "Power consumption monitor");
+
+	/* other versions and arches are not */
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"powertop;1.9-1.fc8;i386;fedora", "Power consumption monitor");
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"powertop;1.8-1.fc8;x86_64;fedora", "Power consumption monitor");
+
+	/* an installed package found later is still emitted */
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"vips-doc;7.12.4-2.fc8;noarch;fedora", "The vips documentation package.");
+	pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
+				"vips-doc;7.12.4-2.fc8;noarch;installed", "The vips documentation package.");
+
+	_g_test_loop_wait (100);
+	g_assert_cmpint (array->len, ==, 5);
+	g_assert_cmpstr (g_ptr_array_index (array, 0), ==, "powertop;1.8-1.fc8;i386;installed");
+	g_assert_cmpstr (g_ptr_array_index (array, 1), ==, "powertop;1.9-1.fc8;i386;fedora");
+	g_assert_cmpstr (g_ptr_array_index (array, 4), ==, "vips-doc;7.12.4-2.fc8;noarch;installed");
+}
+
 static guint _backend_spawn_number_packages = 0;
 
 static void
@@ -670,6 +777,18 @@ pk_test_spawn_func (void)
 	/* we got another package (and finished) */
 	g_assert_cmpint (stdout_count, ==, 4);
 
+	/* reset the dispatcher to a different environment, a new instance
+	 * would take 2 seconds to start */
+	g_strfreev (envp);
+	envp = g_strsplit ("NETWORK=FALSE LANG=C BACKGROUND=TRUE INTERACTIVE=TRUE UID=501", " ", 0);
+	ret = pk_spawn_argv (spawn, argv, envp, PK_SPAWN_ARGV_FLAGS_RESET_ENVIRONMENT, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	_g_test_loop_wait (100);
+	g_assert_cmpint (stdout_count, ==, 6);
+	g_assert (pk_spawn_is_running (spawn));
+	g_assert_cmpint (pk_spawn_get_resident_size (spawn), >, 0);
+
 	/* see if pk_spawn_exit blocks (required) */
 	g_idle_add (idle_cb, NULL);
 
@@ -1420,6 +1539,8 @@ main (int argc, char **argv)
 
 	/* backend stuff */
 	g_test_add_func ("/packagekit/backend", pk_test_backend_func);
+	g_test_add_func ("/packagekit/backend-updates-cache", pk_test_backend_updates_cache_func);
+	g_test_add_func ("/packagekit/backend-stream-results", pk_test_backend_stream_results_func);
 	g_test_add_func ("/packagekit/backend_spawn", pk_test_backend_spawn_func);
 
 	return g_test_run ();
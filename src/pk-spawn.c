@@ -48,6 +48,7 @@ static void     pk_spawn_finalize	(GObject       *object);
 #define PK_SPAWN_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SPAWN, PkSpawnPrivate))
 #define PK_SPAWN_POLL_DELAY	50 /* ms */
 #define PK_SPAWN_SIGKILL_DELAY	2500 /* ms */
+#define PK_SPAWN_PING_TIMEOUT	1000 /* ms */
 
 struct PkSpawnPrivate
 {
@@ -67,6 +68,10 @@ struct PkSpawnPrivate
 	GString			*stderr_buf;
 	gchar			*last_argv0;
 	gchar			**last_envp;
+	guint			 ping_id;
+	gchar			**ping_argv;
+	gchar			**ping_envp;
+	PkSpawnArgvFlags	 ping_flags;
 	GKeyFile		*conf;
 };
 
@@ -154,6 +159,46 @@ pk_spawn_exit_type_enum_to_string (PkSpawnExitType type)
 	return "unknown";
 }
 
+/**
+ * pk_spawn_clear_ping:
+ *
+ * Stop waiting for the answer to pk_spawn_ping()
+ **/
+static void
+pk_spawn_clear_ping (PkSpawn *spawn)
+{
+	if (spawn->priv->ping_id != 0) {
+		g_source_remove (spawn->priv->ping_id);
+		spawn->priv->ping_id = 0;
+	}
+	g_clear_pointer (&spawn->priv->ping_argv, g_strfreev);
+	g_clear_pointer (&spawn->priv->ping_envp, g_strfreev);
+}
+
+/**
+ * pk_spawn_take_pong:
+ *
+ * Remove the "pong" line from the output of the dispatcher, so that it is
+ * never emitted
+ *
+ * Return value: %TRUE if there was one
+ **/
+static gboolean
+pk_spawn_take_pong (GString *string)
+{
+	gchar *pong;
+
+	if (g_str_has_prefix (string->str, "pong\n")) {
+		g_string_erase (string, 0, 5);
+		return TRUE;
+	}
+	pong = strstr (string->str, "\npong\n");
+	if (pong == NULL)
+		return FALSE;
+	g_string_erase (string, pong - string->str + 1, 5);
+	return TRUE;
+}
+
 static gboolean
 pk_spawn_check_child (PkSpawn *spawn)
 {
@@ -179,6 +224,13 @@ pk_spawn_check_child (PkSpawn *spawn)
 		g_string_set_size (spawn->priv->stderr_buf, 0);
 	}
 
+	/* the answer to pk_spawn_ping() is not part of the transaction */
+	if (spawn->priv->ping_id != 0 &&
+	    pk_spawn_take_pong (spawn->priv->stdout_buf)) {
+		g_debug ("dispatcher answered the ping");
+		pk_spawn_clear_ping (spawn);
+	}
+
 	/* all usual output goes on standard out, only bad libraries bitch to stderr */
 	pk_spawn_emit_whole_lines (spawn, spawn->priv->stdout_buf);
 
@@ -262,6 +314,9 @@ pk_spawn_check_child (PkSpawn *spawn)
 		spawn->priv->kill_id = 0;
 	}
 
+	/* there is nobody left to answer the ping */
+	pk_spawn_clear_ping (spawn);
+
 	/* are we doing pk_spawn_exit for a good reason? */
 	if (spawn->priv->is_changing_dispatcher)
 		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_DISPATCHER_CHANGED;
@@ -459,6 +514,141 @@ out:
 	return ret;
 }
 
+/**
+ * pk_spawn_send_reset:
+ *
+ * Ask a persistent dispatcher to drop the state of the last transaction and
+ * switch to the environment of the next one, rather than starting a new
+ * instance for it
+ **/
+static gboolean
+pk_spawn_send_reset (PkSpawn *spawn, gchar **envp)
+{
+	guint i;
+	g_autofree gchar *command = NULL;
+	g_autofree gchar *envp_text = NULL;
+
+	/* the values have to fit into one tab separated line */
+	for (i = 0; envp != NULL && envp[i] != NULL; i++) {
+		if (strpbrk (envp[i], "\t\n") != NULL) {
+			g_debug ("envp[%i] cannot be sent to the dispatcher", i);
+			return FALSE;
+		}
+	}
+
+	if (envp != NULL && envp[0] != NULL) {
+		envp_text = g_strjoinv ("\t", envp);
+		command = g_strdup_printf ("reset\t%s", envp_text);
+	} else {
+		command = g_strdup ("reset");
+	}
+	if (!pk_spawn_send_stdin (spawn, command))
+		return FALSE;
+
+	g_strfreev (spawn->priv->last_envp);
+	spawn->priv->last_envp = g_strdupv (envp);
+	return TRUE;
+}
+
+/**
+ * pk_spawn_kill_unresponsive:
+ *
+ * Kill a dispatcher that stopped answering and wait until it is reaped
+ **/
+static void
+pk_spawn_kill_unresponsive (PkSpawn *spawn)
+{
+	guint count = 0;
+
+	kill (spawn->priv->child_pid, SIGKILL);
+	while (pk_spawn_check_child (spawn) && count++ < 500)
+		g_usleep (10*1000); /* 10 ms */
+}
+
+/**
+ * pk_spawn_ping_timeout_cb:
+ *
+ * The dispatcher did not answer the ping, so it never saw the transaction
+ * either; start a new instance and give it the transaction again
+ **/
+static gboolean
+pk_spawn_ping_timeout_cb (PkSpawn *spawn)
+{
+	g_auto(GStrv) argv = g_steal_pointer (&spawn->priv->ping_argv);
+	g_auto(GStrv) envp = g_steal_pointer (&spawn->priv->ping_envp);
+	g_autoptr(GError) error = NULL;
+
+	/* never repeat */
+	spawn->priv->ping_id = 0;
+
+	g_warning ("persistent dispatcher did not answer within %ims, restarting it",
+		   PK_SPAWN_PING_TIMEOUT);
+	spawn->priv->is_changing_dispatcher = TRUE;
+	pk_spawn_kill_unresponsive (spawn);
+	spawn->priv->is_changing_dispatcher = FALSE;
+
+	if (!pk_spawn_argv (spawn, argv, envp,
+			    spawn->priv->ping_flags | PK_SPAWN_ARGV_FLAGS_NEVER_REUSE,
+			    &error)) {
+		g_warning ("failed to restart dispatcher: %s", error->message);
+		g_signal_emit (spawn, signals [SIGNAL_EXIT], 0, PK_SPAWN_EXIT_TYPE_FAILED);
+	}
+	return FALSE;
+}
+
+/**
+ * pk_spawn_ping:
+ *
+ * Check that a persistent dispatcher kept from an earlier transaction still
+ * answers. This does not wait for the "pong", which is picked up by the
+ * usual stdout poll; the transaction is sent right after the ping, and is
+ * started again in a new instance if the answer does not arrive in time.
+ **/
+static gboolean
+pk_spawn_ping (PkSpawn *spawn, gchar **argv, gchar **envp, PkSpawnArgvFlags flags)
+{
+	pk_spawn_clear_ping (spawn);
+	if (!pk_spawn_send_stdin (spawn, "ping"))
+		return FALSE;
+
+	spawn->priv->ping_argv = g_strdupv (argv);
+	spawn->priv->ping_envp = g_strdupv (envp);
+	spawn->priv->ping_flags = flags;
+	spawn->priv->ping_id = g_timeout_add (PK_SPAWN_PING_TIMEOUT, (GSourceFunc) pk_spawn_ping_timeout_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->ping_id, "[PkSpawn] ping");
+	return TRUE;
+}
+
+/**
+ * pk_spawn_get_resident_size:
+ *
+ * Return value: the resident memory of the running dispatcher in bytes,
+ * or 0 if it is not known
+ **/
+guint64
+pk_spawn_get_resident_size (PkSpawn *spawn)
+{
+	guint64 resident = 0;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *contents = NULL;
+	g_auto(GStrv) pages = NULL;
+
+	g_return_val_if_fail (PK_IS_SPAWN (spawn), 0);
+
+	if (spawn->priv->child_pid == -1 || spawn->priv->finished)
+		return 0;
+
+	/* the second field is the resident set in pages */
+	filename = g_strdup_printf ("/proc/%i/statm", spawn->priv->child_pid);
+	if (!g_file_get_contents (filename, &contents, NULL, NULL))
+		return 0;
+	pages = g_strsplit (contents, " ", 3);
+	if (g_strv_length (pages) < 2)
+		return 0;
+	resident = g_ascii_strtoull (pages[1], NULL, 10);
+	return resident * sysconf (_SC_PAGESIZE);
+}
+
 static gboolean
 pk_strvequal (gchar **id1, gchar **id2)
 {
@@ -531,14 +721,23 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 	/* we can reuse the dispatcher if:
 	 *  - it's still running
 	 *  - argv[0] (executable name is the same)
-	 *  - all of envp are the same (proxy and locale settings) */
+	 *  - a persistent dispatcher still answers a ping
+	 *  - all of envp are the same (proxy and locale settings), or the
+	 *    dispatcher is persistent and gets reset for every transaction */
 	if (spawn->priv->stdin_fd != -1) {
 		if (g_strcmp0 (spawn->priv->last_argv0, argv[0]) != 0) {
 			g_debug ("argv did not match, not reusing");
-		} else if (!pk_strvequal (spawn->priv->last_envp, envp)) {
-			g_debug ("envp did not match, not reusing");
 		} else if ((flags & PK_SPAWN_ARGV_FLAGS_NEVER_REUSE) > 0) {
 			g_debug ("not re-using instance due to policy");
+		} else if ((flags & PK_SPAWN_ARGV_FLAGS_RESET_ENVIRONMENT) > 0 &&
+			   !pk_spawn_ping (spawn, argv, envp, flags)) {
+			g_debug ("failed to ping dispatcher, not reusing");
+		} else if ((flags & PK_SPAWN_ARGV_FLAGS_RESET_ENVIRONMENT) > 0 &&
+			   !pk_spawn_send_reset (spawn, envp)) {
+			g_debug ("failed to reset dispatcher, not reusing");
+		} else if ((flags & PK_SPAWN_ARGV_FLAGS_RESET_ENVIRONMENT) == 0 &&
+			   !pk_strvequal (spawn->priv->last_envp, envp)) {
+			g_debug ("envp did not match, not reusing");
 		} else {
 			/* join with tabs, as spaces could be in file name */
 			g_autofree gchar *command = g_strjoinv ("\t", &argv[1]);
@@ -553,19 +752,24 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 			g_warning ("failed to write, so trying to kill and respawn");
 		}
 
-		/* kill off existing instance */
-		g_debug ("changing dispatcher (exit old instance)");
-		spawn->priv->is_changing_dispatcher = TRUE;
-		ret = pk_spawn_exit (spawn);
-		if (!ret) {
-			g_warning ("failed to exit previous instance");
-			/* remove poll, as we can't reply on pk_spawn_check_child() */
-			if (spawn->priv->poll_id != 0) {
-				g_source_remove (spawn->priv->poll_id);
-				spawn->priv->poll_id = 0;
+		/* the new instance is not answering the ping of the old one */
+		pk_spawn_clear_ping (spawn);
+
+		/* kill off existing instance, unless it is already gone */
+		if (spawn->priv->stdin_fd != -1) {
+			g_debug ("changing dispatcher (exit old instance)");
+			spawn->priv->is_changing_dispatcher = TRUE;
+			ret = pk_spawn_exit (spawn);
+			if (!ret) {
+				g_warning ("failed to exit previous instance");
+				/* remove poll, as we can't reply on pk_spawn_check_child() */
+				if (spawn->priv->poll_id != 0) {
+					g_source_remove (spawn->priv->poll_id);
+					spawn->priv->poll_id = 0;
+				}
 			}
+			spawn->priv->is_changing_dispatcher = FALSE;
 		}
-		spawn->priv->is_changing_dispatcher = FALSE;
 	}
 
 	/* create spawned object for tracking */
@@ -740,6 +944,9 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->allow_sigkill = TRUE;
 	spawn->priv->last_argv0 = NULL;
 	spawn->priv->last_envp = NULL;
+	spawn->priv->ping_id = 0;
+	spawn->priv->ping_argv = NULL;
+	spawn->priv->ping_envp = NULL;
 	spawn->priv->background = FALSE;
 	spawn->priv->exit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
 
@@ -771,6 +978,9 @@ pk_spawn_finalize (GObject *object)
 		spawn->priv->kill_id = 0;
 	}
 
+	/* nobody is waiting for the ping anymore */
+	pk_spawn_clear_ping (spawn);
+
 	/* still running? */
 	if (spawn->priv->stdin_fd != -1) {
 		g_debug ("killing as still running in finalize");
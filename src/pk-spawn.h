@@ -68,8 +68,9 @@ typedef enum {
 } PkSpawnExitType;
 
 typedef enum {
-	PK_SPAWN_ARGV_FLAGS_NONE,
-	PK_SPAWN_ARGV_FLAGS_NEVER_REUSE,
+	PK_SPAWN_ARGV_FLAGS_NONE		= 0,
+	PK_SPAWN_ARGV_FLAGS_NEVER_REUSE		= 1 << 0,
+	PK_SPAWN_ARGV_FLAGS_RESET_ENVIRONMENT	= 1 << 1,	/* dispatcher understands "reset" */
 	PK_SPAWN_ARGV_FLAGS_LAST
 } PkSpawnArgvFlags;
 
@@ -85,6 +86,7 @@ gboolean	 pk_spawn_argv				(PkSpawn	*spawn,
 gboolean	 pk_spawn_is_running			(PkSpawn	*spawn);
 gboolean	 pk_spawn_kill				(PkSpawn	*spawn);
 gboolean	 pk_spawn_exit				(PkSpawn	*spawn);
+guint64		 pk_spawn_get_resident_size		(PkSpawn	*spawn);
 
 G_END_DECLS
 
@@ -112,6 +112,8 @@ struct PkTransactionPrivate
 	gchar			*cmdline;
 	PkResults		*results;
 	PkTransactionDb		*transaction_db;
+	guint			 updates_cache_serial;
+	gboolean		 updates_cache_replayed;
 
 	/* cached */
 	gboolean		 cached_force;
@@ -266,6 +268,39 @@ pk_transaction_get_background (PkTransaction *transaction)
 	return pk_backend_job_get_background (transaction->priv->job);
 }
 
+/*
+ * pk_transaction_role_changes_updates:
+ *
+ * Whether running the transaction can change the list of updates.
+ **/
+static gboolean
+pk_transaction_role_changes_updates (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_SIMULATE))
+		return FALSE;
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD))
+		return FALSE;
+	switch (priv->role) {
+	case PK_ROLE_ENUM_UPDATE_PACKAGES:
+	case PK_ROLE_ENUM_INSTALL_PACKAGES:
+	case PK_ROLE_ENUM_INSTALL_FILES:
+	case PK_ROLE_ENUM_REMOVE_PACKAGES:
+	case PK_ROLE_ENUM_REPO_ENABLE:
+	case PK_ROLE_ENUM_REPO_SET_DATA:
+	case PK_ROLE_ENUM_REPO_REMOVE:
+	case PK_ROLE_ENUM_REFRESH_CACHE:
+	case PK_ROLE_ENUM_UPGRADE_SYSTEM:
+	case PK_ROLE_ENUM_REPAIR_SYSTEM:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 static gboolean
 pk_transaction_finish_invalidate_caches (PkTransaction *transaction)
 {
@@ -1060,6 +1095,24 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
 		pk_transaction_finish_invalidate_caches (transaction);
 
+	/* even a failed transaction may have changed the update list */
+	if (pk_transaction_role_changes_updates (transaction))
+		pk_backend_invalidate_updates_cache (transaction->priv->backend);
+
+	/* save the update list so the next identical request is quicker */
+	if (transaction->priv->role == PK_ROLE_ENUM_GET_UPDATES &&
+	    exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    !transaction->priv->updates_cache_replayed &&
+	    !pk_backend_job_get_is_error_set (job)) {
+		g_autoptr(GPtrArray) array = NULL;
+		array = pk_results_get_package_array (transaction->priv->results);
+		pk_backend_set_updates_cache (transaction->priv->backend,
+					      transaction->priv->updates_cache_serial,
+					      transaction->priv->cached_filters,
+					      pk_backend_job_get_locale (job),
+					      array);
+	}
+
 	/* find the length of time we have been running */
 	time_ms = pk_transaction_get_runtime (transaction);
 	g_debug ("backend was running for %i ms", time_ms);
@@ -1637,6 +1690,43 @@ pk_transaction_percentage_cb (PkBackendJob *job,
 					      g_variant_new_uint32 (percentage));
 }
 
+/*
+ * pk_transaction_replay_updates:
+ *
+ * Answers GetUpdates from the backend cache if possible.
+ **/
+static gboolean
+pk_transaction_replay_updates (PkTransaction *transaction)
+{
+	PkPackage *item;
+	PkTransactionPrivate *priv = transaction->priv;
+	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+
+	array = pk_backend_get_updates_cache (priv->backend,
+					      priv->cached_filters,
+					      pk_backend_job_get_locale (priv->job),
+					      pk_backend_job_get_cache_age (priv->job));
+	if (array == NULL) {
+		priv->updates_cache_serial = pk_backend_get_updates_cache_serial (priv->backend);
+		return FALSE;
+	}
+
+	/* emit exactly what the backend did last time */
+	priv->updates_cache_replayed = TRUE;
+	pk_backend_job_set_status (priv->job, PK_STATUS_ENUM_QUERY);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		pk_backend_job_package_full (priv->job,
+					     pk_package_get_info (item),
+					     pk_package_get_id (item),
+					     pk_package_get_summary (item),
+					     pk_package_get_update_severity (item));
+	}
+	pk_backend_job_finished (priv->job);
+	return TRUE;
+}
+
 gboolean
 pk_transaction_run (PkTransaction *transaction)
 {
@@ -1665,6 +1755,10 @@ pk_transaction_run (PkTransaction *transaction)
 		return TRUE;
 	}
 
+	/* anything calculated from now on may already be out of date */
+	if (pk_transaction_role_changes_updates (transaction))
+		pk_backend_invalidate_updates_cache (priv->backend);
+
 	/* run the job */
 	pk_backend_start_job (priv->backend, priv->job);
 
@@ -1836,6 +1930,8 @@ pk_transaction_run (PkTransaction *transaction)
 					  priv->cached_values);
 		break;
 	case PK_ROLE_ENUM_GET_UPDATES:
+		if (pk_transaction_replay_updates (transaction))
+			break;
 		pk_backend_get_updates (priv->backend,
 					priv->job,
 					priv->cached_filters);
@@ -4503,6 +4599,22 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* stream-results=true */
+	if (g_strcmp0 (key, "stream-results") == 0) {
+		if (g_strcmp0 (value, "true") == 0) {
+			pk_backend_job_set_stream_results (priv->job, TRUE);
+		} else if (g_strcmp0 (value, "false") == 0) {
+			pk_backend_job_set_stream_results (priv->job, FALSE);
+		} else {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				      "stream-results hint expects true or false, not %s", value);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
 	/* cache-age=<time-in-seconds> */
 	if (g_strcmp0 (key, "cache-age") == 0) {
 		guint cache_age;
@@ -4524,6 +4636,19 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* plan-token=<opaque-string> */
+	if (g_strcmp0 (key, "plan-token") == 0) {
+		if (value == NULL || value[0] == '\0') {
+			g_set_error_literal (error,
+					     PK_TRANSACTION_ERROR,
+					     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+					     "Could not set plan-token to nothing");
+			return FALSE;
+		}
+		pk_backend_job_set_plan_token (priv->job, value);
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);